@@ -0,0 +1,172 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// Host microbenchmark: JsonWriter against the former stringstream serialization
+//   g++ -std=c++17 -O2 -I../main json_writer_bench.cpp ../main/json_writer.cpp -o json_writer_bench && ./json_writer_bench
+
+// Include ----------------------
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <sstream>
+#include <string>
+
+#include "json_writer.h"
+
+namespace {
+
+/// Heap allocations of the whole process
+std::size_t s_AllocationCount = 0;
+
+constexpr int ITERATION_COUNT = 200000;
+
+struct ScheduleItem
+{
+    const char* Name;
+    int Hour;
+    int Minute;
+    const char* Status;
+};
+
+constexpr ScheduleItem SCHEDULE_LIST[] = {
+    {"Watering Morning", 6, 30, "Executed"},
+    {"Watering Evening", 17, 0, "Waiting"},
+    {"Adjust", 23, 50, "Waiting"},
+    {"Dummy \"quoted\"", 0, 0, "Disabled"},
+};
+
+/// Sink of the measurement (the size is checked so the work is not optimized out)
+volatile std::size_t s_Size = 0;
+
+// Former serialization --------
+void VoltageStream(const float voltage)
+{
+    std::stringstream responseBody;
+    responseBody << "{\"voltage\":" << std::setfill('0') << std::fixed << std::setprecision(2) << voltage
+                 << ",\"age_ms\":" << 1234 << ",\"stale\":" << "false" << "}";
+    s_Size = responseBody.str().length();
+}
+
+void ScheduleEventStream(const ScheduleItem& item)
+{
+    std::stringstream data;
+    data << "{\"name\":\"" << item.Name << "\""
+         << ",\"hour\":" << item.Hour
+         << ",\"minute\":" << item.Minute
+         << ",\"status\":\"" << item.Status << "\"}";
+    s_Size = data.str().length();
+}
+
+void ScheduleListStream()
+{
+    std::stringstream data;
+    data << "{\"items\":[";
+    bool isFirst = true;
+    for (const ScheduleItem& item : SCHEDULE_LIST) {
+        data << (isFirst ? "" : ",") << "{\"name\":\"" << item.Name << "\""
+             << ",\"hour\":" << item.Hour << ",\"minute\":" << item.Minute
+             << ",\"status\":\"" << item.Status << "\"}";
+        isFirst = false;
+    }
+    data << "],\"voltage\":" << std::fixed << std::setprecision(2) << 12.345f << "}";
+    s_Size = data.str().length();
+}
+
+// JsonWriter -------------------
+void VoltageWriter(const float voltage)
+{
+    char body[64];
+    IrrigationSystem::JsonBufferSink sink(body, sizeof(body));
+    IrrigationSystem::JsonWriter json(sink);
+    json.BeginObject().Key("voltage").Fixed(voltage, 2).Key("age_ms").Int(1234).Key("stale").Bool(false).EndObject();
+    json.Finish();
+    s_Size = sink.GetLength();
+}
+
+void ScheduleEventWriter(const ScheduleItem& item)
+{
+    char data[128];
+    IrrigationSystem::JsonBufferSink sink(data, sizeof(data));
+    IrrigationSystem::JsonWriter writer(sink);
+    writer.BeginObject()
+        .Key("name").String(item.Name)
+        .Key("hour").Int(item.Hour)
+        .Key("minute").Int(item.Minute)
+        .Key("status").String(item.Status)
+    .EndObject();
+    writer.Finish();
+    s_Size = sink.GetLength();
+}
+
+void ScheduleListWriter()
+{
+    char data[512];
+    IrrigationSystem::JsonBufferSink sink(data, sizeof(data));
+    IrrigationSystem::JsonWriter writer(sink);
+    writer.BeginObject().Key("items").BeginArray();
+    for (const ScheduleItem& item : SCHEDULE_LIST) {
+        writer.BeginObject()
+            .Key("name").String(item.Name)
+            .Key("hour").Int(item.Hour)
+            .Key("minute").Int(item.Minute)
+            .Key("status").String(item.Status)
+        .EndObject();
+    }
+    writer.EndArray().Key("voltage").Fixed(12.345f, 2).EndObject();
+    writer.Finish();
+    s_Size = sink.GetLength();
+}
+
+template<typename FUNCTION>
+void Measure(const char *const name, FUNCTION function)
+{
+    // Warm up
+    for (int i = 0; i < ITERATION_COUNT / 10; ++i) {
+        function(i);
+    }
+    const std::size_t allocationCount = s_AllocationCount;
+    const auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATION_COUNT; ++i) {
+        function(i);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const double nanosecond = std::chrono::duration<double, std::nano>(end - begin).count() / ITERATION_COUNT;
+    std::printf("%-28s %9.1f ns/op %6.2f alloc/op %4u bytes\n", name, nanosecond,
+        static_cast<double>(s_AllocationCount - allocationCount) / ITERATION_COUNT, static_cast<unsigned int>(s_Size));
+}
+
+} // namespace
+
+void* operator new(const std::size_t size)
+{
+    ++s_AllocationCount;
+    if (void *const pMemory = std::malloc(size ? size : 1)) {
+        return pMemory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *const pMemory) noexcept
+{
+    std::free(pMemory);
+}
+
+void operator delete(void *const pMemory, const std::size_t) noexcept
+{
+    std::free(pMemory);
+}
+
+int main()
+{
+    constexpr std::size_t ITEM_COUNT = sizeof(SCHEDULE_LIST) / sizeof(SCHEDULE_LIST[0]);
+    Measure("voltage stringstream", [](const int i) { VoltageStream(12.0f + i * 0.001f); });
+    Measure("voltage JsonWriter", [](const int i) { VoltageWriter(12.0f + i * 0.001f); });
+    Measure("schedule event stringstream", [](const int i) { ScheduleEventStream(SCHEDULE_LIST[i % ITEM_COUNT]); });
+    Measure("schedule event JsonWriter", [](const int i) { ScheduleEventWriter(SCHEDULE_LIST[i % ITEM_COUNT]); });
+    Measure("schedule list stringstream", [](const int) { ScheduleListStream(); });
+    Measure("schedule list JsonWriter", [](const int) { ScheduleListWriter(); });
+    return 0;
+}
+
+// EOF
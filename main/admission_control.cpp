@@ -0,0 +1,162 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include "admission_control.h"
+
+#include <esp_timer.h>
+#include "lwip/sockets.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "metrics.h"
+
+namespace IrrigationSystem {
+
+namespace {
+
+/// Token bucket of a route class (rate 0: unlimited)
+struct ClassLimit
+{
+    std::int32_t RatePerSecond;
+    std::int32_t Burst;
+};
+
+constexpr ClassLimit CLASS_LIMIT_LIST[AdmissionControl::ROUTE_CLASS_MAX] = {
+    {0, 0},
+    {CONFIG_HTTPD_ADMISSION_LIGHT_RATE, CONFIG_HTTPD_ADMISSION_LIGHT_BURST},
+    {CONFIG_HTTPD_ADMISSION_EXPENSIVE_RATE, CONFIG_HTTPD_ADMISSION_EXPENSIVE_BURST},
+};
+
+constexpr std::int32_t MILLI_TOKEN = 1000;
+constexpr std::int64_t SECOND_TO_MICRO = 1000 * 1000;
+
+Metric s_ThrottledLightMetric("irrigation_http_throttled_total", "Requests answered 429 by the client rate limit", Metric::TYPE_COUNTER, "class=\"light\"");
+Metric s_ThrottledExpensiveMetric("irrigation_http_throttled_total", "Requests answered 429 by the client rate limit", Metric::TYPE_COUNTER, "class=\"expensive\"");
+Metric s_ExpensiveBusyMetric("irrigation_http_expensive_busy_total", "Requests answered 503 because of the expensive requests in flight", Metric::TYPE_COUNTER);
+Metric s_ExpensiveInFlightMetric("irrigation_http_expensive_in_flight", "Expensive requests admitted and not finished", Metric::TYPE_GAUGE);
+Metric s_ClientEvictMetric("irrigation_http_admission_client_evict_total", "Clients replaced in the rate limit table", Metric::TYPE_COUNTER);
+
+} // namespace
+
+AdmissionControl::AdmissionControl()
+    :m_pClientList(std::make_unique<Client[]>(CLIENT_COUNT))
+    ,m_ExpensiveCount(0)
+{}
+
+AdmissionControl::Result AdmissionControl::Admit(const std::uint32_t clientAddress, const RouteClass routeClass, std::uint32_t& retryAfterSecond)
+{
+    retryAfterSecond = 0;
+    if (routeClass == ROUTE_CLASS_CONTROL) {
+        return RESULT_ADMITTED;
+    }
+
+    // Only this task adds to the count, so the check and the add do not race with Release
+    const bool isExpensive = (routeClass == ROUTE_CLASS_EXPENSIVE);
+    if (isExpensive && MAX_EXPENSIVE_COUNT <= m_ExpensiveCount.load(std::memory_order_acquire)) {
+        s_ExpensiveBusyMetric.Add();
+        retryAfterSecond = 1;
+        return RESULT_BUSY;
+    }
+
+    const std::int64_t nowTime = esp_timer_get_time();
+    Client& client = FindClient(clientAddress, nowTime);
+    if (!TakeToken(client.BucketList[routeClass], routeClass, nowTime, retryAfterSecond)) {
+        (isExpensive ? s_ThrottledExpensiveMetric : s_ThrottledLightMetric).Add();
+        return RESULT_RATE_LIMITED;
+    }
+
+    if (isExpensive) {
+        s_ExpensiveInFlightMetric.Set(m_ExpensiveCount.fetch_add(1, std::memory_order_acq_rel) + 1);
+    }
+    return RESULT_ADMITTED;
+}
+
+void AdmissionControl::Release(const RouteClass routeClass)
+{
+    if (routeClass == ROUTE_CLASS_EXPENSIVE) {
+        s_ExpensiveInFlightMetric.Set(m_ExpensiveCount.fetch_sub(1, std::memory_order_acq_rel) - 1);
+    }
+}
+
+std::uint32_t AdmissionControl::GetClientAddress(httpd_req_t *pHttpRequestData)
+{
+    sockaddr_storage address = {};
+    socklen_t addressLength = sizeof(address);
+    if (getpeername(httpd_req_to_sockfd(pHttpRequestData), reinterpret_cast<sockaddr*>(&address), &addressLength) != 0) {
+        return 0;
+    }
+    if (address.ss_family == AF_INET) {
+        return reinterpret_cast<const sockaddr_in*>(&address)->sin_addr.s_addr;
+    }
+#if CONFIG_LWIP_IPV6
+    if (address.ss_family == AF_INET6) {
+        // IPv4-mapped is the last word. Others are folded
+        std::uint32_t wordList[4] = {};
+        std::memcpy(wordList, reinterpret_cast<const sockaddr_in6*>(&address)->sin6_addr.s6_addr, sizeof(wordList));
+        const bool isMapped = (wordList[0] == 0 && wordList[1] == 0 && wordList[2] == htonl(0x0000FFFF));
+        return isMapped ? wordList[3] : (wordList[0] ^ wordList[1] ^ wordList[2] ^ wordList[3]);
+    }
+#endif
+    return 0;
+}
+
+AdmissionControl::Client& AdmissionControl::FindClient(const std::uint32_t clientAddress, const std::int64_t nowTime)
+{
+    Client* pOldest = &m_pClientList[0];
+    for (std::size_t i = 0; i < CLIENT_COUNT; ++i) {
+        Client& client = m_pClientList[i];
+        if (client.IsUsed && client.Address == clientAddress) {
+            client.LastTime = nowTime;
+            return client;
+        }
+        if (!client.IsUsed) {
+            pOldest = &client;
+        } else if (pOldest->IsUsed && client.LastTime < pOldest->LastTime) {
+            pOldest = &client;
+        }
+    }
+
+    // A new client starts with full buckets
+    if (pOldest->IsUsed) {
+        s_ClientEvictMetric.Add();
+    }
+    pOldest->IsUsed = true;
+    pOldest->Address = clientAddress;
+    pOldest->LastTime = nowTime;
+    for (int routeClass = 0; routeClass < ROUTE_CLASS_MAX; ++routeClass) {
+        pOldest->BucketList[routeClass].MilliToken = CLASS_LIMIT_LIST[routeClass].Burst * MILLI_TOKEN;
+        pOldest->BucketList[routeClass].RefillTime = nowTime;
+    }
+    return *pOldest;
+}
+
+bool AdmissionControl::TakeToken(Bucket& bucket, const RouteClass routeClass, const std::int64_t nowTime, std::uint32_t& retryAfterSecond)
+{
+    const ClassLimit& limit = CLASS_LIMIT_LIST[routeClass];
+    if (limit.RatePerSecond <= 0) {
+        return true;
+    }
+
+    // rate tokens per second is rate milli tokens per millisecond
+    const std::int64_t elapsedMillisecond = (nowTime - bucket.RefillTime) / 1000;
+    if (0 < elapsedMillisecond) {
+        const std::int64_t refilled = bucket.MilliToken + elapsedMillisecond * limit.RatePerSecond;
+        bucket.MilliToken = static_cast<std::int32_t>(std::min<std::int64_t>(refilled, static_cast<std::int64_t>(limit.Burst) * MILLI_TOKEN));
+        bucket.RefillTime += elapsedMillisecond * 1000;
+    }
+    if (MILLI_TOKEN <= bucket.MilliToken) {
+        bucket.MilliToken -= MILLI_TOKEN;
+        return true;
+    }
+
+    // Until a whole token is refilled (rounded up)
+    const std::int64_t waitMicrosecond = static_cast<std::int64_t>(MILLI_TOKEN - bucket.MilliToken) * 1000 / limit.RatePerSecond;
+    retryAfterSecond = static_cast<std::uint32_t>((waitMicrosecond + SECOND_TO_MICRO - 1) / SECOND_TO_MICRO);
+    return false;
+}
+
+} // IrrigationSystem
+
+// EOF
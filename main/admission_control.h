@@ -0,0 +1,88 @@
+#ifndef ADMISSION_CONTROL_H_
+#define ADMISSION_CONTROL_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include <esp_http_server.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace IrrigationSystem {
+
+/// Admission of the httpd requests before their handlers run
+/// A token bucket per client address and route class, and a limit of the expensive requests in flight.
+/// A refused request is answered without touching the IrrigationInterface.
+class AdmissionControl final
+{
+public:
+    enum RouteClass : int {
+        /// Valve control (never refused)
+        ROUTE_CLASS_CONTROL,
+        /// Handlers on the server task (status, assets, events)
+        ROUTE_CLASS_LIGHT,
+        /// Handlers on the workers (flash, ADC, page render)
+        ROUTE_CLASS_EXPENSIVE,
+        ROUTE_CLASS_MAX,
+    };
+
+    enum Result : int {
+        RESULT_ADMITTED,
+        /// The client exceeded the rate of the route class (429)
+        RESULT_RATE_LIMITED,
+        /// Too many expensive requests in flight (503)
+        RESULT_BUSY,
+    };
+
+    /// Clients tracked at once (the least recently seen one is replaced)
+    static constexpr std::size_t CLIENT_COUNT = CONFIG_HTTPD_ADMISSION_CLIENT_COUNT;
+    static constexpr std::uint32_t MAX_EXPENSIVE_COUNT = CONFIG_HTTPD_ADMISSION_MAX_EXPENSIVE;
+
+private:
+    /// Tokens in 1/1000
+    struct Bucket
+    {
+        std::int32_t MilliToken;
+        std::int64_t RefillTime;
+    };
+
+    struct Client
+    {
+        bool IsUsed;
+        std::uint32_t Address;
+        std::int64_t LastTime;
+        Bucket BucketList[ROUTE_CLASS_MAX];
+    };
+
+public:
+    AdmissionControl();
+
+    /// Server task only. An admitted expensive request holds a slot until Release.
+    /// retryAfterSecond is set when the request is refused
+    Result Admit(const std::uint32_t clientAddress, const RouteClass routeClass, std::uint32_t& retryAfterSecond);
+
+    /// End of an admitted request. Any task
+    void Release(const RouteClass routeClass);
+
+    /// Client key of the request (IPv4 address. IPv6 is folded)
+    static std::uint32_t GetClientAddress(httpd_req_t *pHttpRequestData);
+
+private:
+    Client& FindClient(const std::uint32_t clientAddress, const std::int64_t nowTime);
+
+    /// Refill by the elapsed time and take a token
+    static bool TakeToken(Bucket& bucket, const RouteClass routeClass, const std::int64_t nowTime, std::uint32_t& retryAfterSecond);
+
+private:
+    /// Heap (the server task object is on the stack of the main task)
+    std::unique_ptr<Client[]> m_pClientList;
+    std::atomic<std::uint32_t> m_ExpensiveCount;
+};
+
+} // IrrigationSystem
+
+#endif // ADMISSION_CONTROL_H_
+// EOF
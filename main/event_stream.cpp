@@ -0,0 +1,170 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include "event_stream.h"
+
+#include <cstdio>
+
+#include "logger.h"
+
+namespace IrrigationSystem {
+
+namespace {
+
+constexpr int INVALID_SOCKET = -1;
+
+/// Reconnect delay of the browser (millisecond)
+constexpr char STREAM_HEADER[] = "retry: 3000\n\n";
+constexpr char KEEP_ALIVE[] = ":\n\n";
+
+/// Chunk size line and the trailing CRLF
+constexpr std::size_t CHUNK_FRAME_SIZE = 12;
+
+} // namespace
+
+EventStream::EventStream()
+    :m_Mutex()
+    ,m_HttpdHandle(nullptr)
+    ,m_ClientSocket()
+{
+    for (int& sockfd : m_ClientSocket) {
+        sockfd = INVALID_SOCKET;
+    }
+}
+
+void EventStream::SetServer(const httpd_handle_t httpdHandle)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_HttpdHandle = httpdHandle;
+    for (int& sockfd : m_ClientSocket) {
+        sockfd = INVALID_SOCKET;
+    }
+}
+
+esp_err_t EventStream::Subscribe(httpd_req_t *const pHttpRequestData)
+{
+    const int requestSockfd = httpd_req_to_sockfd(pHttpRequestData);
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        int *pFreeSocket = nullptr;
+        for (int& sockfd : m_ClientSocket) {
+            if (sockfd == requestSockfd) {
+                pFreeSocket = &sockfd;
+                break;
+            }
+            if (!pFreeSocket && sockfd == INVALID_SOCKET) {
+                pFreeSocket = &sockfd;
+            }
+        }
+        if (!pFreeSocket) {
+            ESP_LOGW(TAG, "EventStream client is full. max:%u", MAX_CLIENT);
+            return httpd_resp_send_custom_err(pHttpRequestData, "503 Service Unavailable", "Too many event stream clients");
+        }
+        *pFreeSocket = requestSockfd;
+    }
+
+    // The response is left open. Each event is sent as a chunk by SendWork
+    httpd_resp_set_type(pHttpRequestData, "text/event-stream");
+    httpd_resp_set_hdr(pHttpRequestData, "Cache-Control", "no-cache");
+    if (httpd_resp_send_chunk(pHttpRequestData, STREAM_HEADER, sizeof(STREAM_HEADER) - 1) != ESP_OK) {
+        Unsubscribe(requestSockfd);
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "EventStream subscribe. socket:%d", requestSockfd);
+    return ESP_OK;
+}
+
+void EventStream::Unsubscribe(const int sockfd)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (int& clientSockfd : m_ClientSocket) {
+        if (clientSockfd == sockfd) {
+            clientSockfd = INVALID_SOCKET;
+            ESP_LOGI(TAG, "EventStream unsubscribe. socket:%d", sockfd);
+        }
+    }
+}
+
+void EventStream::Publish(const char *const event, const std::string_view data)
+{
+    std::string payload;
+    payload.reserve(data.length() + 32);
+    payload.append("event: ").append(event).append("\ndata: ").append(data).append("\n\n");
+    Queue(payload.data(), payload.length());
+}
+
+void EventStream::KeepAlive()
+{
+    Queue(KEEP_ALIVE, sizeof(KEEP_ALIVE) - 1);
+}
+
+void EventStream::Queue(const char *const pPayload, const std::size_t length)
+{
+    httpd_handle_t httpdHandle = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (!m_HttpdHandle || CountClient() == 0) {
+            return;
+        }
+        httpdHandle = m_HttpdHandle;
+    }
+
+    // Chunked transfer framing
+    Message *const pMessage = new Message{this, std::string()};
+    pMessage->Chunk.reserve(length + CHUNK_FRAME_SIZE);
+    char sizeLine[CHUNK_FRAME_SIZE];
+    const int sizeLineLength = std::snprintf(sizeLine, sizeof(sizeLine), "%x\r\n", length);
+    pMessage->Chunk.append(sizeLine, sizeLineLength).append(pPayload, length).append("\r\n");
+
+    if (httpd_queue_work(httpdHandle, SendWork, pMessage) != ESP_OK) {
+        ESP_LOGW(TAG, "EventStream failed to queue an event");
+        delete pMessage;
+    }
+}
+
+void EventStream::SendWork(void *pArg)
+{
+    Message *const pMessage = static_cast<Message*>(pArg);
+    EventStream *const pEventStream = pMessage->pEventStream;
+
+    int clientSocket[MAX_CLIENT];
+    httpd_handle_t httpdHandle = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(pEventStream->m_Mutex);
+        httpdHandle = pEventStream->m_HttpdHandle;
+        for (std::size_t i = 0; i < MAX_CLIENT; ++i) {
+            clientSocket[i] = pEventStream->m_ClientSocket[i];
+        }
+    }
+
+    for (const int sockfd : clientSocket) {
+        if (!httpdHandle || sockfd == INVALID_SOCKET) {
+            continue;
+        }
+        const int sendLength = httpd_socket_send(httpdHandle, sockfd, pMessage->Chunk.data(), pMessage->Chunk.length(), 0);
+        if (sendLength != static_cast<int>(pMessage->Chunk.length())) {
+            // A partial chunk breaks the stream. (close_fn unsubscribes)
+            ESP_LOGI(TAG, "EventStream send failed. socket:%d", sockfd);
+            pEventStream->Unsubscribe(sockfd);
+            httpd_sess_trigger_close(httpdHandle, sockfd);
+        }
+    }
+
+    delete pMessage;
+}
+
+std::size_t EventStream::CountClient() const
+{
+    std::size_t count = 0;
+    for (const int sockfd : m_ClientSocket) {
+        if (sockfd != INVALID_SOCKET) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+} // IrrigationSystem
+
+// EOF
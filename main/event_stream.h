@@ -0,0 +1,77 @@
+#ifndef EVENT_STREAM_H_
+#define EVENT_STREAM_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// Server-Sent Events (/api/events)
+
+// Include ----------------------
+#include <esp_http_server.h>
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace IrrigationSystem {
+
+/// Server-Sent Events publisher
+/// A subscribed connection is kept open after its handler returns.
+/// Events are queued to the httpd task (httpd_queue_work) and written to the sockets there,
+/// so neither the publishing task nor a handler waits on a client.
+class EventStream final
+{
+public:
+    static constexpr std::size_t MAX_CLIENT = CONFIG_HTTPD_EVENT_STREAM_MAX_CLIENT;
+
+    static constexpr char *const EVENT_VALVE = (char*)"valve";
+    static constexpr char *const EVENT_SCHEDULE = (char*)"schedule";
+    static constexpr char *const EVENT_RELOAD = (char*)"reload";
+    static constexpr char *const EVENT_VOLTAGE = (char*)"voltage";
+    static constexpr char *const EVENT_WATER_LEVEL = (char*)"water_level";
+
+private:
+    /// Queued chunk
+    struct Message
+    {
+        EventStream *pEventStream;
+        std::string Chunk;
+    };
+
+public:
+    EventStream();
+
+    /// Server to send on. (nullptr when it stops. The clients are dropped)
+    void SetServer(const httpd_handle_t httpdHandle);
+
+    /// Take over the connection of the request (Called by the handler)
+    esp_err_t Subscribe(httpd_req_t *const pHttpRequestData);
+
+    /// The session is closed (httpd close_fn)
+    void Unsubscribe(const int sockfd);
+
+    /// Send an event to every client. data is a json object. Any task
+    void Publish(const char *const event, const std::string_view data);
+
+    /// Comment line to keep the connections open and to find the closed ones
+    void KeepAlive();
+
+private:
+    /// Queue a chunk to the httpd task
+    void Queue(const char *const pPayload, const std::size_t length);
+
+    /// (httpd_work_fn_t) Send a message to the clients
+    static void SendWork(void *pArg);
+
+    /// Number of the connected clients (m_Mutex locked)
+    std::size_t CountClient() const;
+
+private:
+    std::mutex m_Mutex;
+    httpd_handle_t m_HttpdHandle;
+    int m_ClientSocket[MAX_CLIENT];
+};
+
+} // IrrigationSystem
+
+#endif // EVENT_STREAM_H_
+// EOF
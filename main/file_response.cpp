@@ -0,0 +1,151 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include "file_response.h"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include <esp_rom_crc.h>
+
+#include "logger.h"
+
+namespace IrrigationSystem {
+
+namespace {
+    constexpr std::size_t HEADER_LENGTH = 256;
+    constexpr std::size_t IF_NONE_MATCH_LENGTH = 128;
+}
+
+std::mutex FileResponse::s_Mutex;
+FileResponse::ETagEntry FileResponse::s_CacheList[MAX_CACHE_ENTRY] = {};
+std::size_t FileResponse::s_NextCacheIndex = 0;
+
+esp_err_t FileResponse::Send(httpd_req_t *const pHttpRequestData, const char *const filePath, const char *const contentType)
+{
+    FileSystem::FileStatus status = {};
+    if (!FileSystem::Stat(filePath, status)) {
+        httpd_resp_send_err(pHttpRequestData, HTTPD_404_NOT_FOUND, "Not Found");
+        return ESP_OK;
+    }
+    std::uint32_t crc = 0;
+    if (!GetCrc(filePath, status, crc)) {
+        httpd_resp_send_err(pHttpRequestData, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to read");
+        return ESP_FAIL;
+    }
+    char eTag[ETAG_LENGTH] = {};
+    std::snprintf(eTag, sizeof(eTag), "\"%08x%04x\"", static_cast<unsigned int>(crc), static_cast<unsigned int>(status.Size & 0xFFFF));
+
+    if (IsNotModified(pHttpRequestData, eTag)) {
+        httpd_resp_set_status(pHttpRequestData, "304 Not Modified");
+        httpd_resp_set_hdr(pHttpRequestData, "ETag", eTag);
+        return httpd_resp_send(pHttpRequestData, nullptr, 0);
+    }
+
+    FileSystem::File file;
+    if (!file.Open(filePath, "rb")) {
+        httpd_resp_send_err(pHttpRequestData, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to open");
+        return ESP_FAIL;
+    }
+
+    // httpd_resp_send_chunk can not be used with Content-Length, so the response is written as is
+    char header[HEADER_LENGTH];
+    const int headerLength = std::snprintf(header, sizeof(header),
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: %s\r\n"
+        "Content-Length: %u\r\n"
+        "ETag: %s\r\n"
+        "Cache-Control: no-cache\r\n"
+        "\r\n",
+        contentType, static_cast<unsigned int>(status.Size), eTag);
+    if (headerLength <= 0 || sizeof(header) <= static_cast<std::size_t>(headerLength)) {
+        ESP_LOGE(TAG, "Response header is too long. %s", filePath);
+        return ESP_FAIL;
+    }
+    if (!SendAll(pHttpRequestData, header, headerLength)) {
+        return ESP_FAIL;
+    }
+
+    char block[BLOCK_SIZE];
+    std::size_t remainSize = status.Size;
+    while (0 < remainSize) {
+        const std::size_t readSize = file.Read(block, std::min(remainSize, sizeof(block)));
+        if (readSize == 0 || !SendAll(pHttpRequestData, block, readSize)) {
+            break;
+        }
+        remainSize -= readSize;
+    }
+    if (0 < remainSize) {
+        // Content-Length can not be kept. The session is closed
+        ESP_LOGE(TAG, "Failed to send %s. %u bytes left", filePath, static_cast<unsigned int>(remainSize));
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+bool FileResponse::GetCrc(const char *const filePath, const FileSystem::FileStatus& status, std::uint32_t& crc)
+{
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    const std::uint32_t writeGeneration = FileSystem::GetWriteGeneration();
+    for (const ETagEntry& entry : s_CacheList) {
+        if (std::strcmp(entry.FilePath, filePath) == 0 && entry.Size == status.Size
+            && entry.ModifiedEpoch == status.ModifiedEpoch && entry.WriteGeneration == writeGeneration) {
+            crc = entry.Crc;
+            return true;
+        }
+    }
+
+    FileSystem::File file;
+    if (!file.Open(filePath, "rb")) {
+        return false;
+    }
+    char block[BLOCK_SIZE];
+    crc = 0;
+    std::size_t readSize = 0;
+    while ((readSize = file.Read(block, sizeof(block))) != 0) {
+        crc = esp_rom_crc32_le(crc, reinterpret_cast<const std::uint8_t*>(block), readSize);
+    }
+
+    if (std::strlen(filePath) < MAX_PATH_LENGTH) {
+        ETagEntry& entry = s_CacheList[s_NextCacheIndex];
+        s_NextCacheIndex = (s_NextCacheIndex + 1) % MAX_CACHE_ENTRY;
+        std::strcpy(entry.FilePath, filePath);
+        entry.Size = status.Size;
+        entry.ModifiedEpoch = status.ModifiedEpoch;
+        entry.WriteGeneration = writeGeneration;
+        entry.Crc = crc;
+    }
+    return true;
+}
+
+bool FileResponse::IsNotModified(httpd_req_t *const pHttpRequestData, const char *const eTag)
+{
+    char ifNoneMatch[IF_NONE_MATCH_LENGTH] = {};
+    if (httpd_req_get_hdr_value_str(pHttpRequestData, "If-None-Match", ifNoneMatch, sizeof(ifNoneMatch)) != ESP_OK) {
+        return false;
+    }
+    return std::strstr(ifNoneMatch, eTag) != nullptr || std::strcmp(ifNoneMatch, "*") == 0;
+}
+
+bool FileResponse::SendAll(httpd_req_t *const pHttpRequestData, const char *const pData, const std::size_t length)
+{
+    std::size_t sentLength = 0;
+    while (sentLength < length) {
+        const int sent = httpd_send(pHttpRequestData, pData + sentLength, length - sentLength);
+        if (sent == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (sent <= 0) {
+            ESP_LOGW(TAG, "Failed to send the file response.");
+            return false;
+        }
+        sentLength += sent;
+    }
+    return true;
+}
+
+} // IrrigationSystem
+
+// EOF
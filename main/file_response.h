@@ -0,0 +1,62 @@
+#ifndef FILE_RESPONSE_H_
+#define FILE_RESPONSE_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// File download response
+
+// Include ----------------------
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+
+#include <esp_http_server.h>
+
+#include "file_system.h"
+
+namespace IrrigationSystem {
+
+/// Sends a file of the FAT volume in fixed size blocks
+/// Content-Length comes from stat and the ETag from the CRC of the content (cached until the file system is written)
+class FileResponse final
+{
+public:
+    static constexpr std::size_t BLOCK_SIZE = 1024;
+
+private:
+    static constexpr std::size_t MAX_CACHE_ENTRY = 4;
+    static constexpr std::size_t MAX_PATH_LENGTH = 32;
+    static constexpr std::size_t ETAG_LENGTH = 24;
+
+    struct ETagEntry
+    {
+        char FilePath[MAX_PATH_LENGTH];
+        std::size_t Size;
+        std::time_t ModifiedEpoch;
+        std::uint32_t WriteGeneration;
+        std::uint32_t Crc;
+    };
+
+public:
+    /// Send the file (304 if If-None-Match has its ETag, 404 if there is no file)
+    static esp_err_t Send(httpd_req_t *const pHttpRequestData, const char *const filePath, const char *const contentType);
+
+private:
+    /// CRC of the content
+    static bool GetCrc(const char *const filePath, const FileSystem::FileStatus& status, std::uint32_t& crc);
+
+    static bool IsNotModified(httpd_req_t *const pHttpRequestData, const char *const eTag);
+
+    /// httpd_send until all is sent
+    static bool SendAll(httpd_req_t *const pHttpRequestData, const char *const pData, const std::size_t length);
+
+private:
+    static std::mutex s_Mutex;
+    static ETagEntry s_CacheList[MAX_CACHE_ENTRY];
+    static std::size_t s_NextCacheIndex;
+};
+
+} // IrrigationSystem
+
+#endif // FILE_RESPONSE_H_
+// EOF
@@ -5,23 +5,90 @@
 // Include ----------------------
 #include "file_system.h"
 
+#include <atomic>
 #include <fstream>
 #include <iostream>
-#include <sstream>
+
+#include <sys/stat.h>
 
 #include "esp_vfs.h"
 #include "esp_vfs_fat.h"
 #include "esp_system.h"
 
 #include "logger.h"
+#include "wait_scope.h"
 
 namespace IrrigationSystem {
 namespace FileSystem {
 
 static constexpr char *const base_path = (char*)"/spiflash";
 
+namespace {
+    std::atomic<std::uint32_t> s_WriteGeneration(0);
+    /// Previous file kept by Rename until the new one is in place
+    constexpr char BACKUP_SUFFIX[] = ".bak";
+}
+
 static wl_handle_t s_wl_handle = WL_INVALID_HANDLE; // Handle of the wear levelling library instance
 
+File::File()
+    :m_pFile(nullptr)
+{}
+
+File::~File()
+{
+    Close();
+}
+
+bool File::Open(const std::string& filePath, const char *const pMode)
+{
+    Close();
+    const WaitScope waitScope;
+    m_pFile = std::fopen((base_path + std::string("/") + filePath).c_str(), pMode);
+    if (!m_pFile) {
+        ESP_LOGE(TAG, "Failed to open file. %s", filePath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool File::Close()
+{
+    if (!m_pFile) {
+        return true;
+    }
+    const bool isClosed = (std::fclose(m_pFile) == 0);
+    m_pFile = nullptr;
+    if (!isClosed) {
+        ESP_LOGE(TAG, "Failed to close file.");
+    }
+    return isClosed;
+}
+
+bool File::IsOpen() const
+{
+    return m_pFile != nullptr;
+}
+
+std::size_t File::Read(void *const pBuffer, const std::size_t size)
+{
+    if (!m_pFile) {
+        return 0;
+    }
+    const WaitScope waitScope;
+    return std::fread(pBuffer, 1, size, m_pFile);
+}
+
+bool File::Write(const void *const pData, const std::size_t size)
+{
+    if (!m_pFile) {
+        return false;
+    }
+    const WaitScope waitScope;
+    s_WriteGeneration.fetch_add(1, std::memory_order_relaxed);
+    return std::fwrite(pData, 1, size, m_pFile) == size;
+}
+
 /// Mount File system
 bool Mount()
 {
@@ -51,6 +118,8 @@ void Unmount()
 /// Write
 bool Write(const std::string& filePath, const std::string& body)
 {
+    const WaitScope waitScope;
+    s_WriteGeneration.fetch_add(1, std::memory_order_relaxed);
     std::fstream fileOpenStream;
     fileOpenStream.open(base_path + std::string("/") + filePath, std::ios::out);
     if (!fileOpenStream.is_open()) {
@@ -64,22 +133,88 @@ bool Write(const std::string& filePath, const std::string& body)
 /// Read
 bool Read(const std::string& filePath, std::string& body)
 {
-    std::fstream fileReadStream;
-    fileReadStream.open(base_path + std::string("/") + filePath, std::ios::in);
-    if (!fileReadStream.is_open()) {
-        ESP_LOGE(TAG, "Failed to open file for writing");
+    // Read straight into the body sized from stat (no intermediate stream copy)
+    FileStatus status = {};
+    File file;
+    RestoreBackup(filePath);
+    if (!Stat(filePath, status) || !file.Open(filePath, "rb")) {
+        ESP_LOGE(TAG, "Failed to open file for reading");
         return false;
     }
-    body = static_cast<std::stringstream const&>(std::stringstream() << fileReadStream.rdbuf()).str();
+    body.resize(status.Size);
+    const std::size_t readSize = (0 < status.Size) ? file.Read(&body[0], status.Size) : 0;
+    body.resize(readSize);
     return true;
 }
 
+/// Restore backup
+void RestoreBackup(const std::string& filePath)
+{
+    FileStatus status = {};
+    if (!Stat(filePath, status) && Stat(filePath + BACKUP_SUFFIX, status)) {
+        // Rename was cut between its two steps (power loss)
+        ESP_LOGW(TAG, "Restore the backup of %s", filePath.c_str());
+        const std::string fullPath = base_path + std::string("/") + filePath;
+        std::rename((fullPath + BACKUP_SUFFIX).c_str(), fullPath.c_str());
+        s_WriteGeneration.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
 /// Delete
 bool Delete(const std::string& filePath)
 {
+    s_WriteGeneration.fetch_add(1, std::memory_order_relaxed);
     return std::remove((base_path + std::string("/") + filePath).c_str()) == 0;
 }
 
+/// Rename
+bool Rename(const std::string& oldFilePath, const std::string& newFilePath)
+{
+    const std::string oldFullPath = base_path + std::string("/") + oldFilePath;
+    const std::string newFullPath = base_path + std::string("/") + newFilePath;
+    const std::string backupFullPath = newFullPath + BACKUP_SUFFIX;
+
+    s_WriteGeneration.fetch_add(1, std::memory_order_relaxed);
+
+    // FAT does not overwrite on rename. The current file is kept as the backup until the new one is in place
+    std::remove(backupFullPath.c_str());
+    struct stat fileStat = {};
+    const bool isExist = (stat(newFullPath.c_str(), &fileStat) == 0);
+    if (isExist && std::rename(newFullPath.c_str(), backupFullPath.c_str()) != 0) {
+        ESP_LOGE(TAG, "Failed to back up file. %s", newFilePath.c_str());
+        return false;
+    }
+    if (std::rename(oldFullPath.c_str(), newFullPath.c_str()) != 0) {
+        ESP_LOGE(TAG, "Failed to rename file. %s -> %s", oldFilePath.c_str(), newFilePath.c_str());
+        if (isExist && std::rename(backupFullPath.c_str(), newFullPath.c_str()) != 0) {
+            ESP_LOGE(TAG, "Failed to restore file. %s", newFilePath.c_str());
+        }
+        return false;
+    }
+    if (isExist) {
+        std::remove(backupFullPath.c_str());
+    }
+    return true;
+}
+
+/// Stat
+bool Stat(const std::string& filePath, FileStatus& status)
+{
+    const WaitScope waitScope;
+    struct stat fileStat = {};
+    if (stat((base_path + std::string("/") + filePath).c_str(), &fileStat) != 0) {
+        return false;
+    }
+    status.Size = fileStat.st_size;
+    status.ModifiedEpoch = fileStat.st_mtime;
+    return true;
+}
+
+std::uint32_t GetWriteGeneration()
+{
+    return s_WriteGeneration.load(std::memory_order_relaxed);
+}
+
 } // FileSystem
 } // IrrigationSystem
 
@@ -6,10 +6,49 @@
 
 // Include ----------------------
 #include <string>
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
 
 namespace IrrigationSystem {
 namespace FileSystem {
 
+/// stat result
+struct FileStatus
+{
+    std::size_t Size;
+    std::time_t ModifiedEpoch;
+};
+
+/// File stream (read / write in fixed size blocks)
+class File final
+{
+public:
+    File();
+    ~File();
+
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+
+    /// Open (mode is the same as fopen)
+    bool Open(const std::string& filePath, const char *const pMode);
+
+    /// Close. Return false when the buffered data could not be written
+    bool Close();
+
+    bool IsOpen() const;
+
+    /// Read up to size bytes. Return the number of bytes read.
+    std::size_t Read(void *const pBuffer, const std::size_t size);
+
+    /// Write
+    bool Write(const void *const pData, const std::size_t size);
+
+private:
+    std::FILE* m_pFile;
+};
+
 /// Mount File system
 bool Mount();
 
@@ -22,9 +61,21 @@ bool Write(const std::string& filePath, const std::string& body);
 /// Read
 bool Read(const std::string& filePath, std::string& body);
 
+/// Put the backup left by an interrupted Rename back (Read does it. Call it before File::Open of such a file)
+void RestoreBackup(const std::string& filePath);
+
 /// Delete
 bool Delete(const std::string& filePath);
 
+/// Rename (An existing file of newFilePath is replaced. It is kept as newFilePath.bak until the rename succeeds, and Read restores it)
+bool Rename(const std::string& oldFilePath, const std::string& newFilePath);
+
+/// Size and modified time
+bool Stat(const std::string& filePath, FileStatus& status);
+
+/// Counted up on every write, rename and delete (cached file contents are checked against it)
+std::uint32_t GetWriteGeneration();
+
 
 } // FileSystem
 } // IrrigationSystem
@@ -10,10 +10,18 @@
 #include <esp_adc/adc_cali_scheme.h>
 
 #include "logger.h"
+#include "metrics.h"
 
 namespace IrrigationSystem {
 namespace GPIO {
 
+namespace {
+
+Metric s_AdcSampleMetric("irrigation_adc_sample_total", "ADC one-shot reads", Metric::TYPE_COUNTER);
+Metric s_AdcErrorMetric("irrigation_adc_error_total", "ADC reads failed to calibrate", Metric::TYPE_COUNTER);
+
+} // namespace
+
 /// Init GPIO (Output)
 void InitOutput(const int32_t gpioNumber, const int32_t level)
 {
@@ -57,9 +65,11 @@ uint32_t GetAdcVoltage(const int32_t adcChannelNo, const int32_t round)
     };
     esp_err_t ret = adc_cali_create_scheme_line_fitting(&caliConfig, &adcCaliHandle);
     if (ret != ESP_OK) {
+        s_AdcErrorMetric.Add();
         return 0;
     }
 
+    s_AdcSampleMetric.Add(round);
     uint32_t sumVoltage = 0;
     for (int32_t i = 0; i < round; ++i) {
         int32_t adcValue = 0;
@@ -0,0 +1,259 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include "gzip_encoder.h"
+
+#include <cstring>
+#include <algorithm>
+
+#include <esp_timer.h>
+#include <esp_rom_crc.h>
+
+namespace IrrigationSystem {
+
+namespace {
+    /// RFC 1951 3.2.5
+    constexpr std::uint16_t LENGTH_BASE[] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+    };
+    constexpr std::uint8_t LENGTH_EXTRA[] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+    };
+    constexpr std::uint16_t DISTANCE_BASE[] = {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+    };
+    constexpr std::uint8_t DISTANCE_EXTRA[] = {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+    };
+    constexpr std::uint32_t END_OF_BLOCK = 256;
+
+    /// Header with no file name and no mtime (RFC 1952 2.3)
+    constexpr std::uint8_t GZIP_HEADER[] = {0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF};
+}
+
+GzipEncoder::GzipEncoder()
+    :m_pListener(nullptr)
+    ,m_Window()
+    ,m_Head()
+    ,m_Position(0)
+    ,m_End(0)
+    ,m_BitBuffer(0)
+    ,m_BitCount(0)
+    ,m_Output()
+    ,m_OutputLength(0)
+    ,m_Crc(0)
+    ,m_InputBytes(0)
+    ,m_OutputBytes(0)
+    ,m_CpuMicrosecond(0)
+    ,m_IsError(false)
+{}
+
+void GzipEncoder::Begin(Listener& listener)
+{
+    m_pListener = &listener;
+    for (const std::uint8_t value : GZIP_HEADER) {
+        PutByte(value);
+    }
+    // One final block with the fixed Huffman codes (BFINAL=1 BTYPE=01) that lasts until Finish
+    PutBits(1, 1);
+    PutBits(1, 2);
+}
+
+bool GzipEncoder::Write(const void *const pData, const std::size_t length)
+{
+    const std::int64_t beginTime = esp_timer_get_time();
+    const std::uint8_t *pCurrent = static_cast<const std::uint8_t*>(pData);
+    std::size_t remainLength = length;
+    while (0 < remainLength && !m_IsError) {
+        if (m_End == sizeof(m_Window)) {
+            Slide();
+        }
+        const std::size_t copyLength = std::min(sizeof(m_Window) - m_End, remainLength);
+        std::memcpy(m_Window + m_End, pCurrent, copyLength);
+        m_Crc = esp_rom_crc32_le(m_Crc, pCurrent, copyLength);
+        m_End += copyLength;
+        m_InputBytes += copyLength;
+        pCurrent += copyLength;
+        remainLength -= copyLength;
+        Deflate(false);
+    }
+    m_CpuMicrosecond += esp_timer_get_time() - beginTime;
+    return !m_IsError;
+}
+
+bool GzipEncoder::Finish()
+{
+    const std::int64_t beginTime = esp_timer_get_time();
+    Deflate(true);
+    PutHuffman(0, 7);
+    // Byte align
+    if (0 < m_BitCount) {
+        PutBits(0, 8 - m_BitCount);
+    }
+    for (const std::uint32_t value : {m_Crc, static_cast<std::uint32_t>(m_InputBytes)}) {
+        for (int shift = 0; shift < 32; shift += 8) {
+            PutByte(static_cast<std::uint8_t>(value >> shift));
+        }
+    }
+    FlushOutput();
+    m_CpuMicrosecond += esp_timer_get_time() - beginTime;
+    return !m_IsError;
+}
+
+bool GzipEncoder::IsError() const
+{
+    return m_IsError;
+}
+
+std::size_t GzipEncoder::GetInputBytes() const
+{
+    return m_InputBytes;
+}
+
+std::size_t GzipEncoder::GetOutputBytes() const
+{
+    return m_OutputBytes + m_OutputLength;
+}
+
+std::uint32_t GzipEncoder::GetCpuMicrosecond() const
+{
+    return static_cast<std::uint32_t>(std::max<std::int64_t>(m_CpuMicrosecond, 0));
+}
+
+void GzipEncoder::Deflate(const bool isFinal)
+{
+    const std::size_t limit = isFinal ? m_End : ((MAX_MATCH < m_End) ? m_End - MAX_MATCH : 0);
+    while (m_Position < limit) {
+        const std::size_t available = m_End - m_Position;
+        std::size_t matchLength = 0;
+        std::size_t matchPosition = 0;
+        if (MIN_MATCH <= available) {
+            const std::uint32_t hash = Hash(m_Window + m_Position);
+            if (m_Head[hash] != 0) {
+                matchPosition = m_Head[hash] - 1;
+                const std::size_t maxLength = std::min(available, MAX_MATCH);
+                while (matchLength < maxLength && m_Window[matchPosition + matchLength] == m_Window[m_Position + matchLength]) {
+                    ++matchLength;
+                }
+            }
+            m_Head[hash] = static_cast<std::uint16_t>(m_Position + 1);
+        }
+
+        if (matchLength < MIN_MATCH) {
+            PutLiteral(m_Window[m_Position]);
+            ++m_Position;
+            continue;
+        }
+        PutMatch(matchLength, m_Position - matchPosition);
+        // Positions inside the match are hashed for the later matches
+        for (std::size_t i = 1; i < matchLength; ++i) {
+            const std::size_t position = m_Position + i;
+            if (m_End < position + MIN_MATCH) {
+                break;
+            }
+            m_Head[Hash(m_Window + position)] = static_cast<std::uint16_t>(position + 1);
+        }
+        m_Position += matchLength;
+    }
+}
+
+void GzipEncoder::Slide()
+{
+    // Deflate has left at most MAX_MATCH bytes, so the encode position is in the newer half
+    std::memmove(m_Window, m_Window + WINDOW_SIZE, WINDOW_SIZE);
+    m_Position -= WINDOW_SIZE;
+    m_End -= WINDOW_SIZE;
+    for (std::uint16_t& head : m_Head) {
+        head = (WINDOW_SIZE < head) ? static_cast<std::uint16_t>(head - WINDOW_SIZE) : 0;
+    }
+}
+
+void GzipEncoder::PutLiteral(const std::uint32_t literal)
+{
+    // RFC 1951 3.2.6
+    if (literal < 144) {
+        PutHuffman(0x30 + literal, 8);
+    } else {
+        PutHuffman(0x190 + (literal - 144), 9);
+    }
+}
+
+void GzipEncoder::PutMatch(const std::size_t length, const std::size_t distance)
+{
+    std::size_t lengthCode = 0;
+    while (lengthCode + 1 < sizeof(LENGTH_BASE) / sizeof(LENGTH_BASE[0]) && LENGTH_BASE[lengthCode + 1] <= length) {
+        ++lengthCode;
+    }
+    const std::uint32_t symbol = 257 + lengthCode;
+    if (symbol < 280) {
+        PutHuffman(symbol - 256, 7);
+    } else {
+        PutHuffman(0xC0 + (symbol - 280), 8);
+    }
+    PutBits(length - LENGTH_BASE[lengthCode], LENGTH_EXTRA[lengthCode]);
+
+    std::size_t distanceCode = 0;
+    while (distanceCode + 1 < sizeof(DISTANCE_BASE) / sizeof(DISTANCE_BASE[0]) && DISTANCE_BASE[distanceCode + 1] <= distance) {
+        ++distanceCode;
+    }
+    PutHuffman(distanceCode, 5);
+    PutBits(distance - DISTANCE_BASE[distanceCode], DISTANCE_EXTRA[distanceCode]);
+}
+
+void GzipEncoder::PutHuffman(const std::uint32_t code, const std::uint32_t bitLength)
+{
+    // Huffman codes are packed starting with the most significant bit
+    std::uint32_t reversed = 0;
+    for (std::uint32_t i = 0; i < bitLength; ++i) {
+        reversed |= ((code >> i) & 1) << (bitLength - 1 - i);
+    }
+    PutBits(reversed, bitLength);
+}
+
+void GzipEncoder::PutBits(const std::uint32_t value, const std::uint32_t bitCount)
+{
+    m_BitBuffer |= value << m_BitCount;
+    m_BitCount += bitCount;
+    while (8 <= m_BitCount) {
+        PutByte(static_cast<std::uint8_t>(m_BitBuffer));
+        m_BitBuffer >>= 8;
+        m_BitCount -= 8;
+    }
+}
+
+void GzipEncoder::PutByte(const std::uint8_t value)
+{
+    if (m_OutputLength == OUTPUT_SIZE) {
+        FlushOutput();
+    }
+    m_Output[m_OutputLength++] = value;
+}
+
+void GzipEncoder::FlushOutput()
+{
+    if (m_OutputLength == 0) {
+        return;
+    }
+    const std::int64_t beginTime = esp_timer_get_time();
+    if (!m_IsError && (!m_pListener || !m_pListener->OnCompressed(m_Output, m_OutputLength))) {
+        m_IsError = true;
+    }
+    m_CpuMicrosecond -= esp_timer_get_time() - beginTime;
+    m_OutputBytes += m_OutputLength;
+    m_OutputLength = 0;
+}
+
+std::uint32_t GzipEncoder::Hash(const std::uint8_t *const pData)
+{
+    const std::uint32_t value = (static_cast<std::uint32_t>(pData[0]) << 16) | (static_cast<std::uint32_t>(pData[1]) << 8) | pData[2];
+    return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+} // IrrigationSystem
+
+// EOF
@@ -0,0 +1,98 @@
+#ifndef GZIP_ENCODER_H_
+#define GZIP_ENCODER_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// Streaming gzip encoder with a small fixed window
+
+// Include ----------------------
+#include <cstddef>
+#include <cstdint>
+
+namespace IrrigationSystem {
+
+/// Streaming gzip (RFC 1952) Encoder
+/// Deflate with the fixed Huffman codes (RFC 1951 3.2.6) and a greedy LZ77 match over a 1KB window.
+/// The whole state is a few KB of fixed buffers, so it can live on the stack of the handler.
+class GzipEncoder final
+{
+public:
+    static constexpr std::size_t WINDOW_SIZE = 1024;
+    static constexpr std::size_t OUTPUT_SIZE = 256;
+
+    /// Compressed Data Listener
+    class Listener
+    {
+    public:
+        virtual ~Listener() {}
+
+        /// Compressed data. Return false to abort
+        virtual bool OnCompressed(const std::uint8_t *const pData, const std::size_t length) = 0;
+    };
+
+private:
+    static constexpr std::size_t HASH_BITS = 8;
+    static constexpr std::size_t HASH_SIZE = 1 << HASH_BITS;
+    static constexpr std::size_t MIN_MATCH = 3;
+    static constexpr std::size_t MAX_MATCH = 258;
+
+public:
+    GzipEncoder();
+
+    GzipEncoder(const GzipEncoder&) = delete;
+    GzipEncoder& operator=(const GzipEncoder&) = delete;
+
+    /// Start a stream (the gzip header is output)
+    void Begin(Listener& listener);
+
+    /// Compress a part of the data
+    bool Write(const void *const pData, const std::size_t length);
+
+    /// Output the rest and the gzip trailer
+    bool Finish();
+
+    bool IsError() const;
+
+    std::size_t GetInputBytes() const;
+    std::size_t GetOutputBytes() const;
+
+    /// Time spent compressing (the listener time is not included)
+    std::uint32_t GetCpuMicrosecond() const;
+
+private:
+    /// Encode the window up to the position where a full length match may still be cut by the next data
+    void Deflate(const bool isFinal);
+
+    /// Drop the older half of the window
+    void Slide();
+
+    void PutLiteral(const std::uint32_t literal);
+    void PutMatch(const std::size_t length, const std::size_t distance);
+    void PutHuffman(const std::uint32_t code, const std::uint32_t bitLength);
+    void PutBits(const std::uint32_t value, const std::uint32_t bitCount);
+    void PutByte(const std::uint8_t value);
+    void FlushOutput();
+
+    static std::uint32_t Hash(const std::uint8_t *const pData);
+
+private:
+    Listener* m_pListener;
+    std::uint8_t m_Window[WINDOW_SIZE * 2];
+    /// Latest position + 1 of the 3 byte hash (0 is empty)
+    std::uint16_t m_Head[HASH_SIZE];
+    std::size_t m_Position;
+    std::size_t m_End;
+    std::uint32_t m_BitBuffer;
+    std::uint32_t m_BitCount;
+    std::uint8_t m_Output[OUTPUT_SIZE];
+    std::size_t m_OutputLength;
+    std::uint32_t m_Crc;
+    std::size_t m_InputBytes;
+    std::size_t m_OutputBytes;
+    std::int64_t m_CpuMicrosecond;
+    bool m_IsError;
+};
+
+} // IrrigationSystem
+
+#endif // GZIP_ENCODER_H_
+// EOF
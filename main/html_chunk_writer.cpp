@@ -0,0 +1,298 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include "html_chunk_writer.h"
+
+#include <esp_heap_caps.h>
+
+#include <cstring>
+#include <algorithm>
+
+#include "logger.h"
+#include "metrics.h"
+#include "request_parser.h"
+
+namespace IrrigationSystem {
+
+namespace {
+
+Metric s_GzipInputMetric("irrigation_http_gzip_input_bytes_total", "Bytes rendered into the gzip responses", Metric::TYPE_COUNTER);
+Metric s_GzipOutputMetric("irrigation_http_gzip_output_bytes_total", "Bytes sent as the gzip responses", Metric::TYPE_COUNTER);
+Metric s_GzipCpuMetric("irrigation_http_gzip_cpu_microseconds_total", "Time spent compressing the responses", Metric::TYPE_COUNTER);
+
+constexpr std::size_t ACCEPT_ENCODING_LENGTH = 128;
+
+} // namespace
+
+HtmlChunkWriter::HtmlChunkWriter(httpd_req_t *const pHttpRequestData, GzipEncoder *const pGzipEncoder)
+    :m_pHttpRequestData(pHttpRequestData)
+    ,m_pGzipEncoder(pGzipEncoder)
+    ,m_Buffer()
+    ,m_Length(0)
+    ,m_TotalBytes(0)
+    ,m_RenderedBytes(0)
+    ,m_ChunkCount(0)
+    ,m_MinimumFreeHeap(heap_caps_get_free_size(MALLOC_CAP_8BIT))
+    ,m_IsError(false)
+{
+    if (m_pGzipEncoder) {
+        httpd_resp_set_hdr(m_pHttpRequestData, "Content-Encoding", "gzip");
+        httpd_resp_set_hdr(m_pHttpRequestData, "Vary", "Accept-Encoding");
+        m_pGzipEncoder->Begin(*this);
+    }
+}
+
+HtmlChunkWriter& HtmlChunkWriter::operator<<(const char *const pText)
+{
+    if (pText) {
+        Append(pText, std::strlen(pText));
+    }
+    return *this;
+}
+
+HtmlChunkWriter& HtmlChunkWriter::operator<<(const std::string& text)
+{
+    Append(text.c_str(), text.length());
+    return *this;
+}
+
+HtmlChunkWriter& HtmlChunkWriter::operator<<(const char character)
+{
+    Append(&character, 1);
+    return *this;
+}
+
+HtmlChunkWriter& HtmlChunkWriter::operator<<(const int value)
+{
+    AppendInteger(value, 0);
+    return *this;
+}
+
+HtmlChunkWriter& HtmlChunkWriter::operator<<(const long value)
+{
+    AppendInteger(value, 0);
+    return *this;
+}
+
+HtmlChunkWriter& HtmlChunkWriter::operator<<(const long long value)
+{
+    AppendInteger(value, 0);
+    return *this;
+}
+
+HtmlChunkWriter& HtmlChunkWriter::operator<<(const unsigned int value)
+{
+    AppendInteger(value, 0);
+    return *this;
+}
+
+HtmlChunkWriter& HtmlChunkWriter::operator<<(const unsigned long value)
+{
+    AppendInteger(value, 0);
+    return *this;
+}
+
+HtmlChunkWriter& HtmlChunkWriter::operator<<(const ZeroPad& zeroPad)
+{
+    AppendInteger(zeroPad.Value, zeroPad.Width);
+    return *this;
+}
+
+HtmlChunkWriter& HtmlChunkWriter::operator<<(const Fixed& fixed)
+{
+    // Integer arithmetic (printf("%f") may allocate)
+    long long scale = 1;
+    for (int i = 0; i < fixed.Precision; ++i) {
+        scale *= 10;
+    }
+    const bool isNegative = (fixed.Value < 0.0f);
+    const long long scaled = static_cast<long long>((isNegative ? -fixed.Value : fixed.Value) * scale + 0.5f);
+    if (isNegative && scaled != 0) {
+        Append("-", 1);
+    }
+    AppendInteger(scaled / scale, 0);
+    if (0 < fixed.Precision) {
+        Append(".", 1);
+        AppendInteger(scaled % scale, fixed.Precision);
+    }
+    return *this;
+}
+
+HtmlChunkWriter& HtmlChunkWriter::operator<<(const Escape& escape)
+{
+    if (!escape.pText) {
+        return *this;
+    }
+    const char* pBegin = escape.pText;
+    for (const char* pCurrent = escape.pText; *pCurrent != '\0'; ++pCurrent) {
+        const char* pEntity = nullptr;
+        switch (*pCurrent) {
+        case '&':  pEntity = "&amp;";  break;
+        case '<':  pEntity = "&lt;";   break;
+        case '>':  pEntity = "&gt;";   break;
+        case '"':  pEntity = "&quot;"; break;
+        case '\'': pEntity = "&#39;";  break;
+        default:
+            continue;
+        }
+        Append(pBegin, pCurrent - pBegin);
+        Append(pEntity, std::strlen(pEntity));
+        pBegin = pCurrent + 1;
+    }
+    Append(pBegin, std::strlen(pBegin));
+    return *this;
+}
+
+HtmlChunkWriter& HtmlChunkWriter::operator<<(const DateTime& dateTime)
+{
+    const std::tm& timeInfo = dateTime.TimeInfo;
+    *this << ZeroPad{timeInfo.tm_year + 1900, 4} << '/'
+          << ZeroPad{timeInfo.tm_mon + 1, 2} << '/'
+          << ZeroPad{timeInfo.tm_mday, 2} << ' '
+          << ZeroPad{timeInfo.tm_hour, 2} << ':'
+          << ZeroPad{timeInfo.tm_min, 2} << ':'
+          << ZeroPad{timeInfo.tm_sec, 2};
+    return *this;
+}
+
+bool HtmlChunkWriter::Write(const char *const pData, const std::size_t length)
+{
+    Append(pData, length);
+    return !m_IsError;
+}
+
+bool HtmlChunkWriter::Flush()
+{
+    if (m_IsError) {
+        return false;
+    }
+    if (m_Length == 0) {
+        return true;
+    }
+    m_RenderedBytes += m_Length;
+    const bool isSent = m_pGzipEncoder ? m_pGzipEncoder->Write(m_Buffer, m_Length) : SendChunk(m_Buffer, m_Length);
+    m_Length = 0;
+    return isSent;
+}
+
+esp_err_t HtmlChunkWriter::Finish()
+{
+    if (!Flush()) {
+        return ESP_FAIL;
+    }
+    if (m_pGzipEncoder) {
+        const bool isFinished = m_pGzipEncoder->Finish();
+        s_GzipInputMetric.Add(m_pGzipEncoder->GetInputBytes());
+        s_GzipOutputMetric.Add(m_pGzipEncoder->GetOutputBytes());
+        s_GzipCpuMetric.Add(m_pGzipEncoder->GetCpuMicrosecond());
+        ESP_LOGD(TAG, "gzip %u -> %ubytes cpu:%uus",
+            static_cast<unsigned int>(m_pGzipEncoder->GetInputBytes()), static_cast<unsigned int>(m_pGzipEncoder->GetOutputBytes()),
+            static_cast<unsigned int>(m_pGzipEncoder->GetCpuMicrosecond()));
+        if (!isFinished) {
+            return ESP_FAIL;
+        }
+    }
+    return httpd_resp_send_chunk(m_pHttpRequestData, nullptr, 0);
+}
+
+bool HtmlChunkWriter::IsError() const
+{
+    return m_IsError;
+}
+
+std::size_t HtmlChunkWriter::GetTotalBytes() const
+{
+    return m_TotalBytes;
+}
+
+std::size_t HtmlChunkWriter::GetChunkCount() const
+{
+    return m_ChunkCount;
+}
+
+std::size_t HtmlChunkWriter::GetRenderedBytes() const
+{
+    return m_RenderedBytes + m_Length;
+}
+
+std::size_t HtmlChunkWriter::GetMinimumFreeHeap() const
+{
+    return m_MinimumFreeHeap;
+}
+
+bool HtmlChunkWriter::IsGzipAccepted(httpd_req_t *const pHttpRequestData)
+{
+#if CONFIG_HTTPD_GZIP_ENABLE
+    char acceptEncoding[ACCEPT_ENCODING_LENGTH] = {};
+    if (httpd_req_get_hdr_value_str(pHttpRequestData, "Accept-Encoding", acceptEncoding, sizeof(acceptEncoding)) != ESP_OK) {
+        return false;
+    }
+    // e.g. "gzip, deflate, br" (a q=0 coding is refused)
+    std::string_view encodingList(acceptEncoding);
+    std::string_view item;
+    while (RequestParser::NextListItem(encodingList, item)) {
+        if (RequestParser::EqualsIgnoreCase(RequestParser::GetItemName(item), "gzip")) {
+            return !RequestParser::IsRefused(item);
+        }
+    }
+#endif
+    return false;
+}
+
+bool HtmlChunkWriter::OnCompressed(const std::uint8_t *const pData, const std::size_t length)
+{
+    return SendChunk(reinterpret_cast<const char*>(pData), length);
+}
+
+bool HtmlChunkWriter::SendChunk(const char *const pData, const std::size_t length)
+{
+    m_MinimumFreeHeap = std::min(m_MinimumFreeHeap, heap_caps_get_free_size(MALLOC_CAP_8BIT));
+    if (httpd_resp_send_chunk(m_pHttpRequestData, pData, length) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to send chunk.");
+        m_IsError = true;
+        return false;
+    }
+    m_TotalBytes += length;
+    ++m_ChunkCount;
+    return true;
+}
+
+void HtmlChunkWriter::Append(const char *const pData, const std::size_t length)
+{
+    std::size_t offset = 0;
+    while (offset < length && !m_IsError) {
+        if (m_Length == BUFFER_SIZE) {
+            Flush();
+            continue;
+        }
+        const std::size_t copyLength = std::min(BUFFER_SIZE - m_Length, length - offset);
+        std::memcpy(m_Buffer + m_Length, pData + offset, copyLength);
+        m_Length += copyLength;
+        offset += copyLength;
+    }
+}
+
+void HtmlChunkWriter::AppendInteger(const long long value, const int width)
+{
+    // Digits are written from the end
+    static constexpr std::size_t MAX_DIGITS = 24;
+    char digits[MAX_DIGITS];
+    std::size_t position = MAX_DIGITS;
+    unsigned long long absoluteValue = (value < 0) ? (0ULL - static_cast<unsigned long long>(value)) : static_cast<unsigned long long>(value);
+    do {
+        digits[--position] = static_cast<char>('0' + (absoluteValue % 10));
+        absoluteValue /= 10;
+    } while (absoluteValue != 0 && 1 < position);
+    while (MAX_DIGITS - position < static_cast<std::size_t>(width) && 1 < position) {
+        digits[--position] = '0';
+    }
+    if (value < 0) {
+        digits[--position] = '-';
+    }
+    Append(digits + position, MAX_DIGITS - position);
+}
+
+} // IrrigationSystem
+
+// EOF
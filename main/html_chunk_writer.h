@@ -0,0 +1,125 @@
+#ifndef HTML_CHUNK_WRITER_H_
+#define HTML_CHUNK_WRITER_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// Chunked HTML response writer
+
+// Include ----------------------
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+#include <esp_http_server.h>
+
+#include "gzip_encoder.h"
+#include "json_writer.h"
+
+namespace IrrigationSystem {
+
+/// HTML renderer for the chunked response
+/// Values are formatted directly into a fixed buffer and sent with httpd_resp_send_chunk
+/// whenever it fills up, so rendering a page needs no heap and a bounded amount of stack.
+/// With a GzipEncoder the buffer is compressed on each flush and sent with Content-Encoding: gzip.
+/// Also the sink of a JsonWriter for the json responses.
+class HtmlChunkWriter final : public JsonSink, private GzipEncoder::Listener
+{
+public:
+    static constexpr std::size_t BUFFER_SIZE = CONFIG_HTTPD_HTML_CHUNK_SIZE;
+
+    /// Zero padded integer (e.g. "05")
+    struct ZeroPad
+    {
+        int Value;
+        int Width;
+    };
+
+    /// Fixed point number (e.g. "12.34")
+    struct Fixed
+    {
+        float Value;
+        int Precision;
+    };
+
+    /// HTML escaped text
+    struct Escape
+    {
+        const char* pText;
+    };
+
+    /// yyyy/mm/dd hh:mm:ss (Util::TimeToStr)
+    struct DateTime
+    {
+        const std::tm& TimeInfo;
+    };
+
+public:
+    /// pGzipEncoder: compress the response (nullptr: send as is)
+    explicit HtmlChunkWriter(httpd_req_t *const pHttpRequestData, GzipEncoder *const pGzipEncoder = nullptr);
+
+    HtmlChunkWriter(const HtmlChunkWriter&) = delete;
+    HtmlChunkWriter& operator=(const HtmlChunkWriter&) = delete;
+
+    HtmlChunkWriter& operator<<(const char *const pText);
+    HtmlChunkWriter& operator<<(const std::string& text);
+    HtmlChunkWriter& operator<<(const char character);
+    HtmlChunkWriter& operator<<(const int value);
+    HtmlChunkWriter& operator<<(const long value);
+    HtmlChunkWriter& operator<<(const long long value);
+    HtmlChunkWriter& operator<<(const unsigned int value);
+    HtmlChunkWriter& operator<<(const unsigned long value);
+    HtmlChunkWriter& operator<<(const ZeroPad& zeroPad);
+    HtmlChunkWriter& operator<<(const Fixed& fixed);
+    HtmlChunkWriter& operator<<(const Escape& escape);
+    HtmlChunkWriter& operator<<(const DateTime& dateTime);
+
+    /// (JsonSink:override)
+    bool Write(const char *const pData, const std::size_t length) override;
+
+    /// Send the buffered data as a chunk
+    bool Flush();
+
+    /// Send the rest and the terminating chunk
+    esp_err_t Finish();
+
+    /// A chunk could not be sent (the rest is discarded)
+    bool IsError() const;
+
+    /// Bytes sent (compressed)
+    std::size_t GetTotalBytes() const;
+    std::size_t GetChunkCount() const;
+
+    /// Bytes rendered (before compression)
+    std::size_t GetRenderedBytes() const;
+
+    /// Lowest free heap seen when a chunk was sent (the render state is alive then)
+    std::size_t GetMinimumFreeHeap() const;
+
+    /// Accept-Encoding of the request has gzip
+    static bool IsGzipAccepted(httpd_req_t *const pHttpRequestData);
+
+private:
+    /// (GzipEncoder::Listener:override)
+    bool OnCompressed(const std::uint8_t *const pData, const std::size_t length) override;
+
+    bool SendChunk(const char *const pData, const std::size_t length);
+
+    void Append(const char *const pData, const std::size_t length);
+    void AppendInteger(const long long value, const int width);
+
+private:
+    httpd_req_t *const m_pHttpRequestData;
+    GzipEncoder *const m_pGzipEncoder;
+    char m_Buffer[BUFFER_SIZE];
+    std::size_t m_Length;
+    std::size_t m_TotalBytes;
+    std::size_t m_RenderedBytes;
+    std::size_t m_ChunkCount;
+    std::size_t m_MinimumFreeHeap;
+    bool m_IsError;
+};
+
+} // IrrigationSystem
+
+#endif // HTML_CHUNK_WRITER_H_
+// EOF
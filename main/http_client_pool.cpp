@@ -0,0 +1,226 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// Reusable esp_http_client handles keyed by origin (scheme://host:port)
+
+// Include ----------------------
+#include "http_client_pool.h"
+
+#include <lwip/netdb.h>
+#include <esp_timer.h>
+
+#include "logger.h"
+
+namespace {
+    constexpr std::int64_t SECOND_TO_MICRO = 1000 * 1000;
+    constexpr std::int64_t MILLI_TO_MICRO = 1000;
+}
+
+namespace IrrigationSystem {
+
+HttpClientPool::HttpClientPool()
+    :m_Mutex()
+    ,m_ClientList()
+    ,m_DnsEntryList()
+{}
+
+HttpClientPool::~HttpClientPool()
+{
+    for (Client& client : m_ClientList) {
+        esp_http_client_cleanup(client.Handle);
+    }
+}
+
+HttpClientPool& HttpClientPool::GetInstance()
+{
+    static HttpClientPool instance;
+    return instance;
+}
+
+bool HttpClientPool::Acquire(const std::string& url, const char *const pServerRootCert, const int timeoutMillisecond,
+                             http_event_handle_cb eventHandler, Lease& lease)
+{
+    std::string origin;
+    std::string host;
+    if (!ParseUrl(url, origin, host)) {
+        return false;
+    }
+
+    Client* pClient = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        const std::int64_t nowTime = esp_timer_get_time();
+
+        Client* pEvictClient = nullptr;
+        for (Client& client : m_ClientList) {
+            if (client.IsInUse) {
+                continue;
+            }
+            if (client.Origin == origin) {
+                pClient = &client;
+                break;
+            }
+            if (!pEvictClient || client.LastUsedTime < pEvictClient->LastUsedTime) {
+                pEvictClient = &client;
+            }
+        }
+
+        if (pClient) {
+            // The sweep may not have run yet
+            CloseIdle(*pClient, nowTime);
+        } else {
+            if (CONFIG_HTTP_CLIENT_POOL_SIZE <= m_ClientList.size()) {
+                if (!pEvictClient) {
+                    ESP_LOGW(TAG, "HttpClientPool is full. %s", origin.c_str());
+                    return false;
+                }
+                ESP_LOGD(TAG, "HttpClientPool evict. %s", pEvictClient->Origin.c_str());
+                esp_http_client_cleanup(pEvictClient->Handle);
+                m_ClientList.erase(m_ClientList.begin() + (pEvictClient - &m_ClientList.front()));
+            }
+
+            #pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+            esp_http_client_config_t config = {
+                .url = url.c_str(),
+                .event_handler = eventHandler,
+            };
+            if (pServerRootCert) {
+                config.cert_pem = pServerRootCert;
+            }
+            if (0 < timeoutMillisecond) {
+                config.timeout_ms = timeoutMillisecond;
+            }
+            config.keep_alive_enable = true;
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+            // Resume the TLS session when reconnecting
+            config.save_client_session = true;
+#endif
+            esp_http_client_handle_t handle = esp_http_client_init(&config);
+            if (!handle) {
+                ESP_LOGE(TAG, "Failed esp_http_client_init");
+                return false;
+            }
+            m_ClientList.push_back(Client{origin, handle, false, false, nowTime});
+            pClient = &m_ClientList.back();
+        }
+
+        pClient->IsInUse = true;
+        lease.Handle = pClient->Handle;
+        lease.IsConnected = pClient->IsConnected;
+    }
+
+    if (0 < timeoutMillisecond) {
+        esp_http_client_set_timeout_ms(lease.Handle, timeoutMillisecond);
+    }
+    esp_http_client_set_url(lease.Handle, url.c_str());
+
+    // A new connection looks up the host
+    lease.DnsMillisecond = lease.IsConnected ? 0 : ResolveHost(host);
+    return true;
+}
+
+void HttpClientPool::Release(const Lease& lease, const bool isSuccess)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (Client& client : m_ClientList) {
+        if (client.Handle != lease.Handle) {
+            continue;
+        }
+        // The HttpRequest of the user_data ends here
+        esp_http_client_set_user_data(client.Handle, nullptr);
+        if (!isSuccess) {
+            // Do not reuse a connection in an unknown state
+            esp_http_client_close(client.Handle);
+        }
+        client.IsConnected = isSuccess;
+        client.IsInUse = false;
+        client.LastUsedTime = esp_timer_get_time();
+        return;
+    }
+}
+
+void HttpClientPool::CloseIdleConnections()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    const std::int64_t nowTime = esp_timer_get_time();
+    for (Client& client : m_ClientList) {
+        CloseIdle(client, nowTime);
+    }
+}
+
+void HttpClientPool::CloseIdle(Client& client, const std::int64_t nowTime)
+{
+    // The server closes an idle keep-alive connection anyway. The handle and the TLS session ticket are kept
+    static constexpr std::int64_t IDLE_TIME = CONFIG_HTTP_CLIENT_POOL_IDLE_SECOND * SECOND_TO_MICRO;
+    if (client.IsInUse || !client.IsConnected || nowTime - client.LastUsedTime <= IDLE_TIME) {
+        return;
+    }
+    ESP_LOGD(TAG, "HttpClientPool close idle connection. %s", client.Origin.c_str());
+    esp_http_client_close(client.Handle);
+    client.IsConnected = false;
+}
+
+std::uint32_t HttpClientPool::ResolveHost(const std::string& host)
+{
+    const std::int64_t nowTime = esp_timer_get_time();
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        for (const DnsEntry& dnsEntry : m_DnsEntryList) {
+            if (dnsEntry.Host == host && nowTime < dnsEntry.ExpireTime) {
+                return 0;
+            }
+        }
+    }
+
+    // esp_http_client resolves the host by itself. This lookup refreshes the lwIP DNS table,
+    // so the lookup of the client is answered from it. (and the DNS time is measured here)
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* pResult = nullptr;
+    const int err = getaddrinfo(host.c_str(), nullptr, &hints, &pResult);
+    if (pResult) {
+        freeaddrinfo(pResult);
+    }
+    const std::uint32_t dnsMillisecond = static_cast<std::uint32_t>((esp_timer_get_time() - nowTime) / MILLI_TO_MICRO);
+    if (err != 0) {
+        ESP_LOGW(TAG, "DNS lookup failed. host:%s err:%d", host.c_str(), err);
+        return dnsMillisecond;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    const std::int64_t expireTime = esp_timer_get_time() + CONFIG_HTTP_DNS_CACHE_TTL_SECOND * SECOND_TO_MICRO;
+    for (DnsEntry& dnsEntry : m_DnsEntryList) {
+        if (dnsEntry.Host == host) {
+            dnsEntry.ExpireTime = expireTime;
+            return dnsMillisecond;
+        }
+    }
+    m_DnsEntryList.push_back(DnsEntry{host, expireTime});
+    return dnsMillisecond;
+}
+
+bool HttpClientPool::ParseUrl(const std::string& url, std::string& origin, std::string& host)
+{
+    static const std::string SCHEME_SEPARATOR = "://";
+    const std::size_t schemeEnd = url.find(SCHEME_SEPARATOR);
+    if (schemeEnd == std::string::npos) {
+        return false;
+    }
+    const std::size_t hostBegin = schemeEnd + SCHEME_SEPARATOR.length();
+    std::size_t originEnd = url.find('/', hostBegin);
+    if (originEnd == std::string::npos) {
+        originEnd = url.length();
+    }
+    origin = url.substr(0, originEnd);
+
+    std::size_t hostEnd = url.find(':', hostBegin);
+    if (hostEnd == std::string::npos || originEnd < hostEnd) {
+        hostEnd = originEnd;
+    }
+    host = url.substr(hostBegin, hostEnd - hostBegin);
+    return !host.empty();
+}
+
+} // IrrigationSystem
+
+// EOF
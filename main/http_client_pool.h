@@ -0,0 +1,88 @@
+#ifndef HTTP_CLIENT_POOL_H_
+#define HTTP_CLIENT_POOL_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// Reusable esp_http_client handles keyed by origin (scheme://host:port)
+
+// Include ----------------------
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+
+#include <esp_http_client.h>
+
+namespace IrrigationSystem {
+
+/// HTTP client pool
+/// A pooled handle keeps the keep-alive connection and the TLS session ticket,
+/// so the next request skips the DNS lookup and the full TLS handshake.
+/// An idle connection is closed by the sweep. Only the handle and the session ticket stay between the fetches.
+class HttpClientPool final
+{
+public:
+    /// Acquired client
+    struct Lease
+    {
+        esp_http_client_handle_t Handle;
+        /// The connection of the previous request may be reused
+        bool IsConnected;
+        /// DNS lookup time (0 if cached)
+        std::uint32_t DnsMillisecond;
+    };
+
+private:
+    struct Client
+    {
+        std::string Origin;
+        esp_http_client_handle_t Handle;
+        bool IsInUse;
+        bool IsConnected;
+        std::int64_t LastUsedTime;
+    };
+
+    struct DnsEntry
+    {
+        std::string Host;
+        std::int64_t ExpireTime;
+    };
+
+private:
+    HttpClientPool();
+    ~HttpClientPool();
+    HttpClientPool(const HttpClientPool&) = delete;
+    HttpClientPool& operator=(const HttpClientPool&) = delete;
+
+public:
+    static HttpClientPool& GetInstance();
+
+    /// Get the client of the url's origin. Return false if the pool is full (use a one-shot client)
+    bool Acquire(const std::string& url, const char *const pServerRootCert, const int timeoutMillisecond,
+                 http_event_handle_cb eventHandler, Lease& lease);
+
+    /// Return the client. The connection is closed if the request failed
+    void Release(const Lease& lease, const bool isSuccess);
+
+    /// Close the connections idle longer than CONFIG_HTTP_CLIENT_POOL_IDLE_SECOND (called periodically)
+    void CloseIdleConnections();
+
+private:
+    /// Close the connection of the client if it is idle (locked by the caller)
+    static void CloseIdle(Client& client, const std::int64_t nowTime);
+
+    /// Resolve the host unless the cached entry is valid. Return the lookup time
+    std::uint32_t ResolveHost(const std::string& host);
+
+    /// Split "scheme://host:port/path" into the origin and the host
+    static bool ParseUrl(const std::string& url, std::string& origin, std::string& host);
+
+private:
+    std::mutex m_Mutex;
+    std::vector<Client> m_ClientList;
+    std::vector<DnsEntry> m_DnsEntryList;
+};
+
+} // IrrigationSystem
+
+#endif // HTTP_CLIENT_POOL_H_
+// EOF
@@ -4,46 +4,105 @@
 // Include ----------------------
 #include "http_request.h"
 
-#include <algorithm>
+#include <strings.h>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <esp_timer.h>
 
 #include "logger.h"
+#include "http_client_pool.h"
 
 namespace IrrigationSystem {
 
 HttpRequest::HttpRequest() 
     :m_Status(STATUS_WAIT)
     ,m_Url()
-    ,m_ResponseBody()
+    ,m_pResponseSink(nullptr)
+    ,m_RequestValidator()
+    ,m_ResponseValidator()
+    ,m_IsResponseBegin(false)
+    ,m_IsResponseError(false)
     ,m_pServerRootCert(nullptr)
+    ,m_TimeoutMillisecond(0)
+    ,m_Timing()
+    ,m_BeginTime(0)
+    ,m_ConnectedTime(0)
+    ,m_HeadersSentTime(0)
+    ,m_FirstHeaderTime(0)
 {}
 
 void HttpRequest::Request(const std::string& url)
 {
     m_Status = STATUS_WAIT;
+    m_IsResponseBegin = false;
+    m_IsResponseError = false;
+    m_ResponseValidator = Validator();
+    m_Timing = Timing();
+
+    // Keep-alive connection and TLS session of the host are reused
+    HttpClientPool::Lease lease = {};
+    const bool isPooled = HttpClientPool::GetInstance().Acquire(url, m_pServerRootCert, m_TimeoutMillisecond, this->EventHandle, lease);
+    esp_http_client_handle_t client = nullptr;
+    if (isPooled) {
+        client = lease.Handle;
+        esp_http_client_set_user_data(client, this);
+        m_Timing.DnsMillisecond = lease.DnsMillisecond;
+    } else {
+        #pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+        esp_http_client_config_t config = {
+            .url = url.c_str(),
+            .event_handler = this->EventHandle,
+            .user_data = this,
+        };
+
+        if (m_pServerRootCert) {
+            config.cert_pem = m_pServerRootCert;
+        }
+        if (0 < m_TimeoutMillisecond) {
+            config.timeout_ms = m_TimeoutMillisecond;
+        }
+        client = esp_http_client_init(&config);
+    }
 
-    #pragma GCC diagnostic ignored "-Wmissing-field-initializers"
-    esp_http_client_config_t config = {
-        .url = url.c_str(),
-        .event_handler = this->EventHandle,
-        .user_data = this,
-    };
-
-    if (m_pServerRootCert) {
-        config.cert_pem = m_pServerRootCert;
+    // A pooled client keeps the headers of the previous request
+    if (!m_RequestValidator.ETag.empty()) {
+        esp_http_client_set_header(client, "If-None-Match", m_RequestValidator.ETag.c_str());
+    } else {
+        esp_http_client_delete_header(client, "If-None-Match");
+    }
+    if (!m_RequestValidator.LastModified.empty()) {
+        esp_http_client_set_header(client, "If-Modified-Since", m_RequestValidator.LastModified.c_str());
+    } else {
+        esp_http_client_delete_header(client, "If-Modified-Since");
     }
 
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    const esp_err_t err = esp_http_client_perform(client);
+    m_BeginTime = esp_timer_get_time();
+    esp_err_t err = esp_http_client_perform(client);
+    if (err != ESP_OK && isPooled && lease.IsConnected && !m_IsResponseBegin) {
+        // The server may have closed the kept connection. Try once with a new connection
+        ESP_LOGD(TAG, "Retry with a new connection");
+        esp_http_client_close(client);
+        m_ResponseValidator = Validator();
+        m_ConnectedTime = 0;
+        m_HeadersSentTime = 0;
+        m_FirstHeaderTime = 0;
+        m_BeginTime = esp_timer_get_time();
+        err = esp_http_client_perform(client);
+    }
+    UpdateTiming();
 
     if (err == ESP_OK) {
         ESP_LOGV(TAG, "HTTP Request Status = %d, content_length = %d",
            esp_http_client_get_status_code(client),
            esp_http_client_get_content_length(client));
-        if (HttpStatus_Ok == esp_http_client_get_status_code(client)) {
+        const int statusCode = esp_http_client_get_status_code(client);
+        if (HttpStatus_Ok == statusCode && !m_IsResponseError) {
+            // Empty body
+            WriteResponseBody(client, nullptr, 0);
             m_Status = STATUS_OK;
+        } else if (HttpStatus_NotModified == statusCode) {
+            m_Status = STATUS_NOT_MODIFIED;
         } else {
             m_Status = STATUS_NG;
         }
@@ -52,7 +111,25 @@ void HttpRequest::Request(const std::string& url)
         m_Status = STATUS_NG;
     }
 
-    esp_http_client_cleanup(client);
+    if (m_pResponseSink) {
+        if (m_Status == STATUS_OK) {
+            if (!m_pResponseSink->End()) {
+                m_Status = STATUS_NG;
+            }
+        } else if (m_IsResponseBegin) {
+            m_pResponseSink->Abort();
+        }
+    }
+
+    ESP_LOGI(TAG, "HTTP Request timing. dns:%ums connect:%ums wait:%ums transfer:%ums total:%ums reused:%d",
+        m_Timing.DnsMillisecond, m_Timing.ConnectMillisecond, m_Timing.WaitMillisecond,
+        m_Timing.TransferMillisecond, m_Timing.TotalMillisecond, m_Timing.IsReused);
+
+    if (isPooled) {
+        HttpClientPool::GetInstance().Release(lease, err == ESP_OK);
+    } else {
+        esp_http_client_cleanup(client);
+    }
 }
 
 void HttpRequest::EnableTLS(const char *const pCert)
@@ -60,14 +137,67 @@ void HttpRequest::EnableTLS(const char *const pCert)
     m_pServerRootCert = pCert;
 }
 
-void HttpRequest::AddResponseBody(const size_t length, const void* data)
+void HttpRequest::SetTimeout(const int timeoutMillisecond)
+{
+    m_TimeoutMillisecond = timeoutMillisecond;
+}
+
+void HttpRequest::SetResponseSink(HttpResponseSink *const pResponseSink)
+{
+    m_pResponseSink = pResponseSink;
+}
+
+void HttpRequest::WriteResponseBody(esp_http_client_handle_t client, const char *const pData, const std::size_t length)
 {
-    m_ResponseBody.insert(m_ResponseBody.end(), static_cast<const char*>(data), static_cast<const char*>(data) + length);
+    if (!m_pResponseSink || m_IsResponseError) {
+        return;
+    }
+
+    if (!m_IsResponseBegin) {
+        m_IsResponseBegin = true;
+        // -1 when the body is sent by chunked transfer encoding
+        const std::int64_t contentLength = esp_http_client_is_chunked_response(client) ? -1 : esp_http_client_get_content_length(client);
+        if (!m_pResponseSink->Begin(contentLength)) {
+            m_IsResponseError = true;
+            return;
+        }
+    }
+
+    if (0 < length && !m_pResponseSink->Write(pData, length)) {
+        m_IsResponseError = true;
+    }
 }
 
-const std::string HttpRequest::GetResponseBody() const
+void HttpRequest::SetValidator(const Validator& validator)
 {
-    return std::string(m_ResponseBody.begin(), m_ResponseBody.end());
+    m_RequestValidator = validator;
+}
+
+const HttpRequest::Validator& HttpRequest::GetResponseValidator() const
+{
+    return m_ResponseValidator;
+}
+
+const HttpRequest::Timing& HttpRequest::GetTiming() const
+{
+    return m_Timing;
+}
+
+void HttpRequest::UpdateTiming()
+{
+    static constexpr std::int64_t MICRO_TO_MILLI = 1000;
+    const std::int64_t endTime = esp_timer_get_time();
+
+    // ON_CONNECTED is not raised when the kept connection is used
+    m_Timing.IsReused = (m_ConnectedTime == 0);
+    const std::int64_t connectedTime = m_Timing.IsReused ? m_BeginTime : m_ConnectedTime;
+    const std::int64_t headersSentTime = (m_HeadersSentTime != 0) ? m_HeadersSentTime : connectedTime;
+    const std::int64_t firstHeaderTime = (m_FirstHeaderTime != 0) ? m_FirstHeaderTime : endTime;
+
+    m_Timing.ConnectMillisecond = static_cast<std::uint32_t>((connectedTime - m_BeginTime) / MICRO_TO_MILLI);
+    m_Timing.WaitMillisecond = static_cast<std::uint32_t>((firstHeaderTime - headersSentTime) / MICRO_TO_MILLI);
+    m_Timing.TransferMillisecond = static_cast<std::uint32_t>((endTime - firstHeaderTime) / MICRO_TO_MILLI);
+    m_Timing.TotalMillisecond = m_Timing.DnsMillisecond + static_cast<std::uint32_t>((endTime - m_BeginTime) / MICRO_TO_MILLI);
 }
 
 HttpRequest::Status HttpRequest::GetStatus() const
@@ -79,9 +209,23 @@ void HttpRequest::Event(esp_http_client_event_t *const pEventData)
 {
     if (pEventData->event_id == HTTP_EVENT_ERROR) {
         ESP_LOGW(TAG, "HTTP_EVENT_ERROR");
+    } else if (pEventData->event_id == HTTP_EVENT_ON_CONNECTED) {
+        m_ConnectedTime = esp_timer_get_time();
+    } else if (pEventData->event_id == HTTP_EVENT_HEADERS_SENT) {
+        m_HeadersSentTime = esp_timer_get_time();
+    } else if (pEventData->event_id == HTTP_EVENT_ON_HEADER) {
+        if (m_FirstHeaderTime == 0) {
+            m_FirstHeaderTime = esp_timer_get_time();
+        }
+        if (strcasecmp(pEventData->header_key, "ETag") == 0) {
+            m_ResponseValidator.ETag = pEventData->header_value;
+        } else if (strcasecmp(pEventData->header_key, "Last-Modified") == 0) {
+            m_ResponseValidator.LastModified = pEventData->header_value;
+        }
     } else if (pEventData->event_id == HTTP_EVENT_ON_DATA) {
-        if (!esp_http_client_is_chunked_response(pEventData->client)) {
-            AddResponseBody(pEventData->data_len, pEventData->data);
+        // The data of a chunked response is already decoded. (Ignore the body of redirects and errors)
+        if (HttpStatus_Ok == esp_http_client_get_status_code(pEventData->client)) {
+            WriteResponseBody(pEventData->client, static_cast<const char*>(pEventData->data), pEventData->data_len);
         }
     }
 }
@@ -89,8 +233,9 @@ void HttpRequest::Event(esp_http_client_event_t *const pEventData)
 esp_err_t HttpRequest::EventHandle(esp_http_client_event_t *pEventData)
 {
     if (!pEventData->user_data) {
-        ESP_LOGE(TAG, "UserData Is Null");
-        return ESP_FAIL;
+        // A pooled client closed while no request uses it
+        ESP_LOGD(TAG, "UserData Is Null. event:%d", pEventData->event_id);
+        return ESP_OK;
     }
     static_cast<HttpRequest*>(pEventData->user_data)->Event(pEventData);
     return ESP_OK;
@@ -5,14 +5,16 @@
 
 // Include ----------------------
 #include <string>
-#include <vector>
+#include <cstdint>
 
 #include <esp_system.h>
 #include <esp_http_client.h>
 
+#include "http_response_sink.h"
+
 namespace IrrigationSystem {
 
-/// HttpGetRequest (synchronous process)
+/// HttpGetRequest (synchronous process. The connection is pooled by HttpClientPool)
 class HttpRequest
 {
 public:
@@ -20,9 +22,33 @@ public:
     {
         STATUS_WAIT,
         STATUS_OK,
+        STATUS_NOT_MODIFIED,
         STATUS_NG,
     };
 
+    /// Cache validators (Conditional GET)
+    struct Validator
+    {
+        std::string ETag;
+        std::string LastModified;
+    };
+
+    /// Time of each phase
+    struct Timing
+    {
+        /// Host lookup (0 if the cached result or the kept connection is used)
+        std::uint32_t DnsMillisecond;
+        /// TCP connect and TLS handshake (esp_http_client does not report them separately)
+        std::uint32_t ConnectMillisecond;
+        /// Request sent to the first response header
+        std::uint32_t WaitMillisecond;
+        /// First response header to the end of the body
+        std::uint32_t TransferMillisecond;
+        std::uint32_t TotalMillisecond;
+        /// The kept connection was used
+        bool IsReused;
+    };
+
 public:
     HttpRequest();
     
@@ -31,14 +57,29 @@ public:
 
     void EnableTLS(const char *const pCert);
 
-    const std::string GetResponseBody() const;
+    /// Network timeout (0:esp_http_client default)
+    void SetTimeout(const int timeoutMillisecond);
+
+    /// Set the destination of the response body (Not owned. Must outlive the request)
+    void SetResponseSink(HttpResponseSink *const pResponseSink);
+
+    /// Send If-None-Match / If-Modified-Since. (STATUS_NOT_MODIFIED if the resource is unchanged)
+    void SetValidator(const Validator& validator);
+
+    /// ETag / Last-Modified of the response
+    const Validator& GetResponseValidator() const;
     
+    /// Phase timings of the last request
+    const Timing& GetTiming() const;
+
     Status GetStatus() const;
 
 private:
+    void UpdateTiming();
+
     void Event(esp_http_client_event_t *const pEventData);
 
-    void AddResponseBody(const size_t length, const void* data);
+    void WriteResponseBody(esp_http_client_handle_t client, const char *const pData, const std::size_t length);
 
 public:
     static esp_err_t EventHandle(esp_http_client_event_t *pEventData);
@@ -47,8 +88,19 @@ public:
 private:
     Status m_Status;
     std::string m_Url;
-    std::vector<char> m_ResponseBody;
+    HttpResponseSink* m_pResponseSink;
+    Validator m_RequestValidator;
+    Validator m_ResponseValidator;
+    bool m_IsResponseBegin;
+    bool m_IsResponseError;
     const char* m_pServerRootCert;
+    int m_TimeoutMillisecond;
+
+    Timing m_Timing;
+    std::int64_t m_BeginTime;
+    std::int64_t m_ConnectedTime;
+    std::int64_t m_HeadersSentTime;
+    std::int64_t m_FirstHeaderTime;
 };
 
 } // IrrigationSystem
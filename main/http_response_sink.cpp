@@ -0,0 +1,98 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// Destination of the HttpRequest response body
+
+// Include ----------------------
+#include "http_response_sink.h"
+
+#include "logger.h"
+
+namespace IrrigationSystem {
+
+// HttpBufferSink -----------------------------
+
+HttpBufferSink::HttpBufferSink(const std::size_t maxSize)
+    :m_MaxSize(maxSize)
+    ,m_Body()
+{}
+
+bool HttpBufferSink::Begin(const std::int64_t contentLength)
+{
+    m_Body.clear();
+    if (0 < contentLength) {
+        if (m_MaxSize < static_cast<std::uint64_t>(contentLength)) {
+            ESP_LOGW(TAG, "Response too large. length:%lld max:%d", contentLength, m_MaxSize);
+            return false;
+        }
+        m_Body.reserve(static_cast<std::size_t>(contentLength));
+    }
+    return true;
+}
+
+bool HttpBufferSink::Write(const char *const pData, const std::size_t length)
+{
+    if (m_MaxSize < m_Body.size() + length) {
+        ESP_LOGW(TAG, "Response too large. max:%d", m_MaxSize);
+        return false;
+    }
+    m_Body.insert(m_Body.end(), pData, pData + length);
+    return true;
+}
+
+const std::vector<char>& HttpBufferSink::GetBody() const
+{
+    return m_Body;
+}
+
+// HttpCallbackSink ---------------------------
+
+HttpCallbackSink::HttpCallbackSink(const DataCallback& callback)
+    :m_Callback(callback)
+{}
+
+bool HttpCallbackSink::Write(const char *const pData, const std::size_t length)
+{
+    if (!m_Callback) {
+        return false;
+    }
+    return m_Callback(pData, length);
+}
+
+// HttpFileSink -------------------------------
+
+HttpFileSink::HttpFileSink(const std::string& filePath)
+    :m_FilePath(filePath)
+    ,m_File()
+{}
+
+bool HttpFileSink::Begin(const std::int64_t contentLength)
+{
+    return m_File.Open(m_FilePath, "wb");
+}
+
+bool HttpFileSink::Write(const char *const pData, const std::size_t length)
+{
+    return m_File.Write(pData, length);
+}
+
+bool HttpFileSink::End()
+{
+    // The rest of the data is written by fclose. A partial file is not left
+    if (!m_File.Close()) {
+        FileSystem::Delete(m_FilePath);
+        return false;
+    }
+    return true;
+}
+
+void HttpFileSink::Abort()
+{
+    if (m_File.IsOpen()) {
+        m_File.Close();
+        FileSystem::Delete(m_FilePath);
+    }
+}
+
+} // IrrigationSystem
+
+// EOF
@@ -0,0 +1,101 @@
+#ifndef HTTP_RESPONSE_SINK_H_
+#define HTTP_RESPONSE_SINK_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// Destination of the HttpRequest response body
+
+// Include ----------------------
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "file_system.h"
+
+namespace IrrigationSystem {
+
+/// Response body destination (chunked and non-chunked bodies are handled the same way)
+class HttpResponseSink
+{
+public:
+    virtual ~HttpResponseSink() {}
+
+    /// Called once before the body. contentLength is -1 if unknown (chunked transfer)
+    virtual bool Begin(const std::int64_t contentLength) { return true; }
+
+    /// Called for each part of the body
+    virtual bool Write(const char *const pData, const std::size_t length) = 0;
+
+    /// Called after the whole body has been received
+    virtual bool End() { return true; }
+
+    /// Called instead of End when the request failed
+    virtual void Abort() {}
+};
+
+/// In-memory buffer (reserved from Content-Length)
+class HttpBufferSink final : public HttpResponseSink
+{
+public:
+    static constexpr std::size_t DEFAULT_MAX_SIZE = 16 * 1024;
+
+public:
+    explicit HttpBufferSink(const std::size_t maxSize = DEFAULT_MAX_SIZE);
+
+    /// (HttpResponseSink:override)
+    bool Begin(const std::int64_t contentLength) override;
+
+    /// (HttpResponseSink:override)
+    bool Write(const char *const pData, const std::size_t length) override;
+
+    const std::vector<char>& GetBody() const;
+
+private:
+    std::size_t m_MaxSize;
+    std::vector<char> m_Body;
+};
+
+/// Streaming callback (constant memory)
+class HttpCallbackSink final : public HttpResponseSink
+{
+public:
+    using DataCallback = std::function<bool(const char *const pData, const std::size_t length)>;
+
+public:
+    explicit HttpCallbackSink(const DataCallback& callback);
+
+    /// (HttpResponseSink:override)
+    bool Write(const char *const pData, const std::size_t length) override;
+
+private:
+    DataCallback m_Callback;
+};
+
+/// File on the FileSystem (constant memory)
+class HttpFileSink final : public HttpResponseSink
+{
+public:
+    explicit HttpFileSink(const std::string& filePath);
+
+    /// (HttpResponseSink:override)
+    bool Begin(const std::int64_t contentLength) override;
+
+    /// (HttpResponseSink:override)
+    bool Write(const char *const pData, const std::size_t length) override;
+
+    /// (HttpResponseSink:override)
+    bool End() override;
+
+    /// (HttpResponseSink:override)
+    void Abort() override;
+
+private:
+    std::string m_FilePath;
+    FileSystem::File m_File;
+};
+
+} // IrrigationSystem
+
+#endif // HTTP_RESPONSE_SINK_H_
+// EOF
@@ -4,25 +4,48 @@
 // Include ----------------------
 #include "httpd_server_task.h"
 
-#include <sstream>
 #include <string>
-#include <iomanip>
 #include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
 
 #include "esp_vfs.h"
 #include "esp_spiffs.h"
+#include "lwip/sockets.h"
 
 #include "logger.h"
 #include "util.h"
+#include "html_chunk_writer.h"
+#include "json_writer.h"
+#include "gzip_encoder.h"
+#include "static_asset.h"
+#include "status_snapshot.h"
+#include "event_stream.h"
+#include "voltage_check_task.h"
 #include "schedule_manager.h"
 #include "schedule_base.h"
 #include "weather_forecast.h"
+#include "weather_forecast_task.h"
 #include "watering_setting.h"
+#include "file_system.h"
+#include "file_response.h"
+#include "multipart_parser.h"
+#include "request_parser.h"
+#include "setting_upload_writer.h"
+#include "metrics.h"
+#include "wait_scope.h"
+#include "httpd_worker_pool.h"
+#include "admission_control.h"
+#include "json_arena.h"
 #include "version.h"
 
 namespace {
-#if CONFIG_IS_ENABLE_VOLTAGE_CHECK
-    std::string voltageToColorName(const float voltage) 
+#if CONFIG_HTTPD_SERVER_RENDERED_CONSOLE && CONFIG_IS_ENABLE_VOLTAGE_CHECK
+    const char* voltageToColorName(const float voltage) 
     {
         if (12.5f <= voltage) {
             return "lime";
@@ -36,8 +59,8 @@ namespace {
         return "darkgray";
     }
 #endif
-#if CONFIG_IS_ENABLE_WATER_LEVEL_CHECK
-    std::string waterLevelToColorName(const int waterLevel) 
+#if CONFIG_HTTPD_SERVER_RENDERED_CONSOLE && CONFIG_IS_ENABLE_WATER_LEVEL_CHECK
+    const char* waterLevelToColorName(const int waterLevel) 
     {
         if (60 <= waterLevel) {
             return "steelblue";
@@ -53,15 +76,31 @@ namespace {
 namespace IrrigationSystem {
 
 static constexpr int WEB_RELAY_OPEN_MAX_SECOND = 60;
+/// Sensor value responses (sent with Content-Length)
+static constexpr std::size_t SMALL_JSON_SIZE = 64;
+
+namespace {
+
+Metric s_WorkerBusyMetric("irrigation_http_worker_busy_total", "Requests answered 503 because the worker queue was full", Metric::TYPE_COUNTER);
+Metric s_PriorityInlineMetric("irrigation_http_priority_inline_total", "Priority requests run on the server task because the priority queue was full", Metric::TYPE_COUNTER);
+
+} // namespace
 
 HttpdServerTask::HttpdServerTask(const IrrigationInterfaceWeakPtr pIrrigationInterface)
     :Task(TASK_NAME, PRIORITY, CORE_ID)
     ,m_pIrrigationInterface(pIrrigationInterface)
     ,m_HttpdHandle(NULL)
+    ,m_pRouteList(std::make_unique<Route[]>(MAX_ROUTE_COUNT))
+    ,m_RouteCount(0)
+    ,m_WorkerPool()
+    ,m_AdmissionControl()
+    ,m_SettingMutex()
+    ,m_HttpdTaskHandle(nullptr)
 {}
 
 void HttpdServerTask::Initialize()
 {
+    m_WorkerPool.Start();
     StopWebServer();
     m_HttpdHandle = StartWebServer();
 }
@@ -71,85 +110,70 @@ httpd_handle_t HttpdServerTask::StartWebServer()
     ESP_LOGI(TAG, "Starting HTTP Server");
 
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.max_uri_handlers = MAX_ROUTE_COUNT;
+    // Event stream clients hold their sockets. The least recently used one is closed for a new connection
+    config.lru_purge_enable = true;
+    config.global_user_ctx = this;
+    config.global_user_ctx_free_fn = this->FreeGlobalContext;
+    config.close_fn = this->CloseSessionHandler;
     httpd_handle_t httpdServerHandle = NULL;
     if (httpd_start(&httpdServerHandle, &config) != ESP_OK) {
         return NULL;
     }
 
-    // Get "/" Handle
-    const httpd_uri_t routingRootUriHandler = {
-        .uri       = "/",
-        .method    = HTTP_GET,
-        .handler   = this->RootHandler,
-        .user_ctx  = this,
-    };
-    httpd_register_uri_handler(httpdServerHandle, &routingRootUriHandler);
+    const IrrigationInterfaceSharedPtr irrigationInterface = m_pIrrigationInterface.lock();
+    if (irrigationInterface) {
+        irrigationInterface->GetEventStream().SetServer(httpdServerHandle);
+    }
+
+#if CONFIG_HTTPD_SERVER_RENDERED_CONSOLE
+    // Get "/" Handle (rendered on the device)
+    RegisterRoute(httpdServerHandle, "/", HTTP_GET, this->RootHandler, ROUTE_LANE_WORKER);
+
+    // Get "/console.css" "/console.js" handle
+    for (const StaticAsset *const pAsset : {&StaticAsset::GetStyleSheet(), &StaticAsset::GetScript()}) {
+        RegisterRoute(httpdServerHandle, pAsset->GetUri(), HTTP_GET, this->StaticAssetHandler);
+    }
+#else
+    // Get "/" Handle (single page console rendered by the browser)
+    RegisterRoute(httpdServerHandle, StaticAsset::GetConsolePage().GetUri(), HTTP_GET, this->StaticAssetHandler);
+#endif
+
+    // Get "/api/info" handle
+    RegisterRoute(httpdServerHandle, "/api/info", HTTP_GET, this->InfoHandler);
 
     // Post "/manual_watering" handle
-    const httpd_uri_t routingManualWateringUriHandler = {
-        .uri       = "/manual_watering",
-        .method    = HTTP_POST,
-        .handler   = this->ManualWateringHandler,
-        .user_ctx  = this,
-    };
-    httpd_register_uri_handler(httpdServerHandle, &routingManualWateringUriHandler);
+    RegisterRoute(httpdServerHandle, "/manual_watering", HTTP_POST, this->ManualWateringHandler, ROUTE_LANE_PRIORITY);
 
     // Post "/emergency_stop" handle
-    const httpd_uri_t routingEmergencyStopyUriHandler = {
-        .uri       = "/emergency_stop",
-        .method    = HTTP_POST,
-        .handler   = this->EmergencyStopHandler,
-        .user_ctx  = this,
-    };
-    httpd_register_uri_handler(httpdServerHandle, &routingEmergencyStopyUriHandler);
+    RegisterRoute(httpdServerHandle, "/emergency_stop", HTTP_POST, this->EmergencyStopHandler, ROUTE_LANE_PRIORITY);
 
     // Post "/upload_setting" handle
-    const httpd_uri_t routingUploadSettingUriHandler = {
-        .uri       = "/upload_setting",
-        .method    = HTTP_POST,
-        .handler   = this->UploadSettingHandler,
-        .user_ctx  = this,
-    };
-    httpd_register_uri_handler(httpdServerHandle, &routingUploadSettingUriHandler);
+    RegisterRoute(httpdServerHandle, "/upload_setting", HTTP_POST, this->UploadSettingHandler, ROUTE_LANE_WORKER);
 
     // Post "/download_setting" handle
-    const httpd_uri_t routingDownloadSettingUriHandler = {
-        .uri       = "/download_setting",
-        .method    = HTTP_GET,
-        .handler   = this->DownloadSettingHandler,
-        .user_ctx  = this,
-    };
-    httpd_register_uri_handler(httpdServerHandle, &routingDownloadSettingUriHandler);
+    RegisterRoute(httpdServerHandle, "/download_setting", HTTP_GET, this->DownloadSettingHandler, ROUTE_LANE_WORKER);
 
     // Post "/delete_setting" handle
-    const httpd_uri_t routingDeleteSettingUriHandler = {
-        .uri       = "/delete_setting",
-        .method    = HTTP_POST,
-        .handler   = this->DeleteSettingHandler,
-        .user_ctx  = this,
-    };
-    httpd_register_uri_handler(httpdServerHandle, &routingDeleteSettingUriHandler);
+    RegisterRoute(httpdServerHandle, "/delete_setting", HTTP_POST, this->DeleteSettingHandler, ROUTE_LANE_WORKER);
 
     // Post "/voltage" handle
-    const httpd_uri_t routingGetVoltageUriHandler = {
-        .uri       = "/voltage",
-        .method    = HTTP_GET,
-        .handler   = this->GetVoltageHandler,
-        .user_ctx  = this,
-    };
-    httpd_register_uri_handler(httpdServerHandle, &routingGetVoltageUriHandler);
+    RegisterRoute(httpdServerHandle, "/voltage", HTTP_GET, this->GetVoltageHandler, ROUTE_LANE_WORKER);
 
     // Post "/waterlevel" handle
-    const httpd_uri_t routingGetWaterLevelUriHandler = {
-        .uri       = "/waterlevel",
-        .method    = HTTP_GET,
-        .handler   = this->GetWaterLevelHandler,
-        .user_ctx  = this,
-    };
-    httpd_register_uri_handler(httpdServerHandle, &routingGetWaterLevelUriHandler);
+    RegisterRoute(httpdServerHandle, "/waterlevel", HTTP_GET, this->GetWaterLevelHandler, ROUTE_LANE_WORKER);
+
+    // Get "/api/status" handle
+    RegisterRoute(httpdServerHandle, "/api/status", HTTP_GET, this->StatusHandler);
 
+    // Get "/api/events" handle
+    RegisterRoute(httpdServerHandle, "/api/events", HTTP_GET, this->EventStreamHandler);
 
+    // Get "/metrics" handle
+    RegisterRoute(httpdServerHandle, "/metrics", HTTP_GET, this->MetricsHandler, ROUTE_LANE_WORKER);
 
+    // Get "/api/latency" handle
+    RegisterRoute(httpdServerHandle, "/api/latency", HTTP_GET, this->LatencyHandler, ROUTE_LANE_WORKER);
 
     // Not Found Handle
     httpd_register_err_handler(httpdServerHandle, HTTPD_404_NOT_FOUND, this->ErrorNotFoundHandler);
@@ -157,20 +181,179 @@ httpd_handle_t HttpdServerTask::StartWebServer()
     return httpdServerHandle;
 }
 
+bool HttpdServerTask::RegisterRoute(const httpd_handle_t httpdHandle, const char *const uri, const httpd_method_t method, const RequestHandler handler, const RouteLane lane)
+{
+    if (MAX_ROUTE_COUNT <= m_RouteCount) {
+        ESP_LOGE(TAG, "Failed to register %s. Too many routes", uri);
+        return false;
+    }
+    Route& route = m_pRouteList[m_RouteCount];
+    route.Uri = uri;
+    route.Method = method;
+    route.Handler = handler;
+    route.Lane = lane;
+    // The valve control is never limited. The worker lane has the slow handlers
+    route.Class = (lane == ROUTE_LANE_PRIORITY) ? AdmissionControl::ROUTE_CLASS_CONTROL
+                : (lane == ROUTE_LANE_WORKER) ? AdmissionControl::ROUTE_CLASS_EXPENSIVE
+                : AdmissionControl::ROUTE_CLASS_LIGHT;
+    route.pHttpdServerTask = this;
+    route.RequestCount.store(0);
+    route.Latency.Reset();
+    route.Wait.Reset();
+
+    const httpd_uri_t routingUriHandler = {
+        .uri       = uri,
+        .method    = method,
+        .handler   = this->DispatchHandler,
+        .user_ctx  = &route,
+    };
+    if (httpd_register_uri_handler(httpdHandle, &routingUriHandler) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register %s", uri);
+        return false;
+    }
+    ++m_RouteCount;
+    return true;
+}
+
+esp_err_t HttpdServerTask::DispatchHandler(httpd_req_t *pHttpRequestData)
+{
+    Route *const pRoute = static_cast<Route*>(pHttpRequestData->user_ctx);
+    pRoute->RequestCount.fetch_add(1, std::memory_order_relaxed);
+    AdmissionControl& admissionControl = pRoute->pHttpdServerTask->m_AdmissionControl;
+    // The /metrics handler runs on a worker, so it cannot take the handle itself
+    pRoute->pHttpdServerTask->m_HttpdTaskHandle.store(xTaskGetCurrentTaskHandle(), std::memory_order_relaxed);
+
+    // Refused before the handler (the IrrigationInterface is not touched)
+    if (pRoute->Class != AdmissionControl::ROUTE_CLASS_CONTROL) {
+        std::uint32_t retryAfterSecond = 0;
+        const AdmissionControl::Result admission = admissionControl.Admit(AdmissionControl::GetClientAddress(pHttpRequestData), pRoute->Class, retryAfterSecond);
+        if (admission == AdmissionControl::RESULT_RATE_LIMITED) {
+            ESP_LOGD(TAG, "Rate limited. %s", pRoute->Uri);
+            return SendRetryLater(pHttpRequestData, "429 Too Many Requests", retryAfterSecond);
+        }
+        if (admission == AdmissionControl::RESULT_BUSY) {
+            ESP_LOGD(TAG, "Too many expensive requests. %s", pRoute->Uri);
+            return SendRetryLater(pHttpRequestData, "503 Service Unavailable", retryAfterSecond);
+        }
+    }
+
+    // The handlers get the task as the user_ctx (copied to the async request)
+    pHttpRequestData->user_ctx = pRoute->pHttpdServerTask;
+
+    if (pRoute->Lane == ROUTE_LANE_INLINE) {
+        const esp_err_t result = RunRoute(pHttpRequestData, *pRoute, 0);
+        admissionControl.Release(pRoute->Class);
+        return result;
+    }
+    const HttpdWorkerPool::Lane lane = (pRoute->Lane == ROUTE_LANE_PRIORITY) ? HttpdWorkerPool::LANE_PRIORITY : HttpdWorkerPool::LANE_NORMAL;
+    if (pRoute->pHttpdServerTask->m_WorkerPool.Submit(pHttpRequestData, lane, RunRouteOnWorker, pRoute)) {
+        return ESP_OK;
+    }
+    admissionControl.Release(pRoute->Class);
+
+    // A valve control request is never refused
+    if (lane == HttpdWorkerPool::LANE_PRIORITY) {
+        ESP_LOGW(TAG, "Priority lane is full. Run %s on the server task", pRoute->Uri);
+        s_PriorityInlineMetric.Add();
+        return RunRoute(pHttpRequestData, *pRoute, 0);
+    }
+    ESP_LOGW(TAG, "Worker lane is full. %s", pRoute->Uri);
+    s_WorkerBusyMetric.Add();
+    return SendRetryLater(pHttpRequestData, "503 Service Unavailable", 1);
+}
+
+esp_err_t HttpdServerTask::SendRetryLater(httpd_req_t *pHttpRequestData, const char *const status, const std::uint32_t retryAfterSecond)
+{
+    // The header value is referenced until the response is sent
+    char retryAfter[12];
+    std::snprintf(retryAfter, sizeof(retryAfter), "%" PRIu32, std::max<std::uint32_t>(retryAfterSecond, 1));
+    httpd_resp_set_status(pHttpRequestData, status);
+    httpd_resp_set_hdr(pHttpRequestData, "Retry-After", retryAfter);
+    httpd_resp_send(pHttpRequestData, nullptr, 0);
+    return ESP_OK;
+}
+
+esp_err_t HttpdServerTask::RunRoute(httpd_req_t *pHttpRequestData, Route& route, const std::uint32_t queueMicrosecond)
+{
+    WaitScope::Reset();
+    const std::int64_t beginTime = esp_timer_get_time();
+    const esp_err_t result = route.Handler(pHttpRequestData);
+    // The time in the worker queue is waiting as well
+    route.Latency.Record(static_cast<std::uint32_t>(esp_timer_get_time() - beginTime) + queueMicrosecond);
+    route.Wait.Record(WaitScope::GetTotalMicrosecond() + queueMicrosecond);
+    return result;
+}
+
+void HttpdServerTask::RunRouteOnWorker(httpd_req_t *pHttpRequestData, void *pContext, const std::uint32_t queueMicrosecond)
+{
+    Route *const pRoute = static_cast<Route*>(pContext);
+    const esp_err_t result = RunRoute(pHttpRequestData, *pRoute, queueMicrosecond);
+    pRoute->pHttpdServerTask->m_AdmissionControl.Release(pRoute->Class);
+    if (result != ESP_OK) {
+        // The server closes the session of a failed handler only when it runs on the server task
+        httpd_sess_trigger_close(pHttpRequestData->handle, httpd_req_to_sockfd(pHttpRequestData));
+    }
+}
+
+std::unique_lock<std::mutex> HttpdServerTask::LockSetting()
+{
+    std::unique_lock<std::mutex> lock(m_SettingMutex, std::defer_lock);
+    const WaitScope waitScope;
+    lock.lock();
+    return lock;
+}
+
+bool HttpdServerTask::ReceiveBody(httpd_req_t *pHttpRequestData, char *const pBuffer, const std::size_t bufferSize, std::size_t& length)
+{
+    length = pHttpRequestData->content_len;
+    if (bufferSize < length) {
+        httpd_resp_send_err(pHttpRequestData, HTTPD_400_BAD_REQUEST, "content too long");
+        return false;
+    }
+    std::size_t receivedLength = 0;
+    while (receivedLength < length) {
+        int received = 0;
+        {
+            const WaitScope waitScope;
+            received = httpd_req_recv(pHttpRequestData, pBuffer + receivedLength, length - receivedLength);
+        }
+        if (received == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (received <= 0) {
+            httpd_resp_send_err(pHttpRequestData, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to post control value");
+            return false;
+        }
+        receivedLength += received;
+    }
+    return true;
+}
+
 void HttpdServerTask::StopWebServer()
 {
     if (m_HttpdHandle) {
         ESP_LOGI(TAG, "Stop HTTP Server");
+        const IrrigationInterfaceSharedPtr irrigationInterface = m_pIrrigationInterface.lock();
+        if (irrigationInterface) {
+            irrigationInterface->GetEventStream().SetServer(nullptr);
+        }
+        m_HttpdTaskHandle.store(nullptr, std::memory_order_relaxed);
         httpd_stop(m_HttpdHandle);
         m_HttpdHandle = nullptr;
+        m_RouteCount = 0;
     }
 }
 
 void HttpdServerTask::Update()
 {
+    const IrrigationInterfaceSharedPtr irrigationInterface = m_pIrrigationInterface.lock();
+    if (irrigationInterface) {
+        irrigationInterface->GetEventStream().KeepAlive();
+    }
     Util::SleepMillisecond(10 * 1000);
 }
 
+#if CONFIG_HTTPD_SERVER_RENDERED_CONSOLE
 esp_err_t HttpdServerTask::RootHandler(httpd_req_t *pHttpRequestData)
 {
     ESP_LOGV(TAG, "WebServer Request Recv. Get:Root");
@@ -190,6 +373,7 @@ esp_err_t HttpdServerTask::RootHandler(httpd_req_t *pHttpRequestData)
         ESP_LOGE(TAG, "Failed IrrigationInterface is null");
         return ESP_FAIL;
     }
+    const std::unique_lock<std::mutex> settingLock = pHttpdServerTask->LockSetting();
     const WeatherForecast& weatherForecast = irrigationInterface->GetWeatherForecast();
     const WateringSetting& weatherSetting = irrigationInterface->GetWateringSetting();
     const ScheduleManagerSharedPtr scheduleManager = irrigationInterface->GetScheduleManager().lock();
@@ -209,89 +393,61 @@ esp_err_t HttpdServerTask::RootHandler(httpd_req_t *pHttpRequestData)
 #endif
 
 #if CONFIG_DEBUG != 0
-    static const std::string title = "Irrigation System (DEBUG)";
-    static const std::string bodyStyle = "body {background-color:lightgray;}";
+    static constexpr char *const title = (char*)"Irrigation System (DEBUG)";
+    static constexpr char *const bodyClass = (char*)"debug";
 #else
-    static const std::string title = "Irrigation System";
-    static const std::string bodyStyle = "body {background-color:lightskyblue;}";
+    static constexpr char *const title = (char*)"Irrigation System";
+    static constexpr char *const bodyClass = (char*)"";
 #endif
-    
-    std::stringstream weatherInfo;
-    if (weatherForecast.GetRequestStatus() == WeatherForecast::NOT_REQUEST) {   
-        weatherInfo << " Not yet acquired.";
-    } else if (weatherForecast.GetRequestStatus() == WeatherForecast::ACQUIRED) {   
-        weatherInfo << " Weather(" << WeatherForecast::WeatherCodeToStr(weatherForecast.GetCurrentWeatherCode())
-                    << ") MaxTemp(" << weatherForecast.GetCurrentMaxTemperature() << "°C)";
-    } else {
-        weatherInfo << " <span style=\"background-color: yellow;\">Failed to retrieve data</span>";
-    }
 
-    std::stringstream responseBody;
-    responseBody 
+    // Rendered into the fixed buffer of the writer and sent chunk by chunk
+    const std::int64_t renderBeginTime = esp_timer_get_time();
+    const std::size_t renderBeginFreeHeap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    const std::size_t renderBeginMinimumFreeHeap = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    GzipEncoder gzipEncoder;
+    HtmlChunkWriter response(pHttpRequestData, HtmlChunkWriter::IsGzipAccepted(pHttpRequestData) ? &gzipEncoder : nullptr);
+    response
         << "<!doctype html><head>"
         << "<meta charset=\"utf-8\"/>"
         << "<meta name=\"viewport\" content=\"width=device-width,initial-scale=1\">"
         << "<meta http-equiv=\"refresh\" content=\"3600\">"
         << "<title>" << title << "</title>"
-        << "<style>" 
-        << "*{box-sizing:border-box;margin:0;padding:0;}"
-        << "h1 {margin: 10px 12px; font-size: 1.3em;}"
-        << "h2 {margin: 10px 12px; font-size: 1.2em;}"
-        << "h3 {margin: 8px 12px; font-size: 1.0em;}"
-        << "hr {margin:0px 6px}"
-        << "p, form {margin: 4px 12px; font-size: 1.0em;}"
-        << "table {margin: 10px 20px}"
-        << "input {border-style:none; padding: 5px}"
-        << bodyStyle
-        << "hr {height:0;border:0;overflow:visible;border-top:3px dotted white;}"
-        << "table {border-collapse: collapse;border-spacing: 0;background-color:aliceblue;border:solid 1px steelblue;}"
-        << "table th {text-align:center;padding: 10px;background: steelblue;color: white;}"
-        << "table td {padding: 10px; border-bottom: solid 1px steelblue; }"
-        << ".schedule_disable { background-color: silver;}"
-        << ".schedule_executable { background-color: greenyellow;}"
-        << ".gauge{ position: relative; border:solid 1px steelblue; background-color:lightgray; width: 300px; margin: 6px 20px; }"
-        << "div#inner { height: 20px; }"
-        << "div#num { position: absolute; top: 0px; left: 0px; line-height: 20px; text-align: center; width: 300px;}"
-        << "</style>"
-        << "<script>var checkSubmit = function(msg) { return confirm(msg); };</script>"
+        << "<link rel=\"stylesheet\" href=\"" << StaticAsset::GetStyleSheet().GetUri() << "?v=" << StaticAsset::GetStyleSheet().GetVersion() << "\">"
+        << "<script src=\"" << StaticAsset::GetScript().GetUri() << "?v=" << StaticAsset::GetScript().GetVersion() << "\"></script>"
         << "</head>";
 
-    httpd_resp_sendstr_chunk(pHttpRequestData, responseBody.str().c_str());
-    responseBody.str("");
-    responseBody.clear(std::stringstream::goodbit);
-
-    responseBody
-        << "<body><h1>" << title << "</h1>"
-        << "<hr><h2>Schedule</h2>";
+    response
+        << "<body class=\"" << bodyClass << "\"><h1>" << title << "</h1>"
+        << "<hr><h2>Schedule</h2>"
+        << "<div id=\"schedule\" data-time-zone=\"" << CONFIG_LOCAL_TIME_ZONE << "\">";
 
     if (weatherSetting.IsActive()) {
         const std::tm wateringTm = Util::EpochToLocalTime(irrigationInterface->GetLastWateringEpoch());
+        const std::tm nowTimeInfo = Util::GetLocalTime();
 
-        responseBody
-            << "<p>System Time : " << Util::GetNowTimeStr() << " TZ:" << CONFIG_LOCAL_TIME_ZONE << "</p>"
-            << std::setfill('0')
+        response
+            << "<p>System Time : " << HtmlChunkWriter::DateTime{nowTimeInfo} << " TZ:" << CONFIG_LOCAL_TIME_ZONE << "</p>"
             << "<p>Current Date : " 
-            << std::setw(2) << scheduleManager->GetCurrentMonth() << "/" 
-            << std::setw(2) << scheduleManager->GetCurrentDay()
+            << HtmlChunkWriter::ZeroPad{scheduleManager->GetCurrentMonth(), 2} << "/" 
+            << HtmlChunkWriter::ZeroPad{scheduleManager->GetCurrentDay(), 2}
             << "&nbsp;&nbsp; Last Watering Date : "
-            << std::setw(2) << (wateringTm.tm_mon + 1) << "/" 
-            << std::setw(2) << wateringTm.tm_mday
+            << HtmlChunkWriter::ZeroPad{wateringTm.tm_mon + 1, 2} << "/" 
+            << HtmlChunkWriter::ZeroPad{wateringTm.tm_mday, 2}
             << "</p>";
 
         // Create Schedule Table
-        responseBody << "<table><thead><tr><th>ScheduleName</th><th>Time</th><th>Status</th></tr></thead><tbody>";
+        response << "<table><thead><tr><th>ScheduleName</th><th>Time</th><th>Status</th></tr></thead><tbody>";
 
         if (std::any_of(scheduleList.begin(), scheduleList.end(), [](const ScheduleBaseUniquePtr& item){ return item->IsVisible(); })) {
             // Found Visible Schedule Item
             for (const auto& pScheduleItem : scheduleList) {
                 if (pScheduleItem->IsVisible()) {
-                    responseBody 
-                        << std::setfill('0')
+                    response 
                         << "<tr class=\"" << ScheduleBase::StatusToRecordStyle(pScheduleItem->GetStatus()) << "\">"
-                        << "<td>" << pScheduleItem->GetName() << "</td>"
+                        << "<td>" << HtmlChunkWriter::Escape{pScheduleItem->GetName().c_str()} << "</td>"
                         << "<td>" 
-                        << std::setw(2) << pScheduleItem->GetHour() << ":"
-                        << std::setw(2) << pScheduleItem->GetMinute()
+                        << HtmlChunkWriter::ZeroPad{pScheduleItem->GetHour(), 2} << ":"
+                        << HtmlChunkWriter::ZeroPad{pScheduleItem->GetMinute(), 2}
                         << "</td>"
                         << "<td>" << ScheduleBase::StatusToStr(pScheduleItem->GetStatus()) << "</td>"
                         << "</tr>";
@@ -299,54 +455,103 @@ esp_err_t HttpdServerTask::RootHandler(httpd_req_t *pHttpRequestData)
             }
         } else {
             // Not Found Visible Schedule Item
-            responseBody << "<tr><td colspan=\"3\">Empty</td></tr>";
+            response << "<tr><td colspan=\"3\">Empty</td></tr>";
         }
            
-        responseBody << "</tbody></table>";
+        response << "</tbody></table>";
+
+        // Watering plan of the coming days (advance mode)
+        const ScheduleManager::DailyPlanList& wateringPlan = scheduleManager->GetWateringPlan();
+        if (!wateringPlan.empty()) {
+            const std::int32_t today = Util::DateToDayNumber(nowTimeInfo);
+            response << "<h3>Watering Plan</h3>"
+                << "<table><thead><tr><th>Date</th><th>Type</th><th>Watering</th><th>Basis</th></tr></thead><tbody>";
+            for (const ScheduleManager::DailyPlan& dailyPlan : wateringPlan) {
+                std::tm dayTimeInfo = nowTimeInfo;
+                dayTimeInfo.tm_mday += dailyPlan.Day - today;
+                std::mktime(&dayTimeInfo);
+                response
+                    << "<tr><td>"
+                    << HtmlChunkWriter::ZeroPad{dayTimeInfo.tm_mon + 1, 2} << "/"
+                    << HtmlChunkWriter::ZeroPad{dayTimeInfo.tm_mday, 2}
+                    << "</td>"
+                    << "<td>" << HtmlChunkWriter::Escape{dailyPlan.WateringTypeName.c_str()} << "</td>"
+                    << "<td>" << (dailyPlan.IsWatering ? "Yes" : "-") << "</td>"
+                    << "<td>" << (dailyPlan.IsForecast ? "Forecast" : "Monthly") << "</td>"
+                    << "</tr>";
+            }
+            response << "</tbody></table>";
+        }
     } else {
-        responseBody << "<p><span style=\"background-color:yellow;\">No settings have been made.<span></p>";
+        response << "<p><span style=\"background-color:yellow;\">No settings have been made.<span></p>";
     }
-
-    httpd_resp_sendstr_chunk(pHttpRequestData, responseBody.str().c_str());
-    responseBody.str("");
-    responseBody.clear(std::stringstream::goodbit);
+    response << "</div>";
 
     // -- Status -----
-    responseBody
+    response
         << "<hr><h2>Status</h2>";
  
-    responseBody
+    response
         << "<h3>Valve Status</h3>";
     if (valveCloseEpoch == 0) {
-        responseBody << "<p>Close</p>";
+        response << "<p id=\"valve\">Close</p>";
     } else {
-        responseBody 
-            << "<p><span style=\"background:coral;\">Open</span> &gt; Close At(" 
-            << Util::TimeToStr(Util::EpochToLocalTime(valveCloseEpoch)) << ")</p>";
+        response 
+            << "<p id=\"valve\"><span style=\"background:coral;\">Open</span> &gt; Close At(" 
+            << HtmlChunkWriter::DateTime{Util::EpochToLocalTime(valveCloseEpoch)} << ")</p>";
     }
 
-    responseBody
+    response
         << "<h3>Weather Forecast</h3>"
-        << "<p>" << weatherInfo.str() << "</p>";
+        << "<p><span id=\"forecast\">";
+    if (weatherForecast.GetRequestStatus() == WeatherForecast::NOT_REQUEST) {   
+        response << " Not yet acquired.";
+    } else if (weatherForecast.GetRequestStatus() == WeatherForecast::ACQUIRED) {   
+        response << " Weather(" << WeatherForecast::WeatherCodeToStr(weatherForecast.GetCurrentWeatherCode(), GetRequestLanguage(pHttpRequestData))
+                 << ") MaxTemp(" << weatherForecast.GetCurrentMaxTemperature() << "°C)";
+    } else {
+        response << " <span style=\"background-color: yellow;\">Failed to retrieve data</span>";
+    }
+    response << "</span>";
+    const WeatherForecast::CacheStatistics cacheStatistics = weatherForecast.GetCacheStatistics();
+    if (0 < cacheStatistics.RequestCount) {
+        response << " Cache Hit(" << cacheStatistics.HitCount << "/" << cacheStatistics.RequestCount << ")";
+    }
+    if (0 < cacheStatistics.SnapshotCount) {
+        response << " Snapshot(" << cacheStatistics.SnapshotCount << ")";
+    }
+    const WeatherForecastFetchStatistics fetchStatistics = irrigationInterface->GetWeatherForecastFetchStatistics();
+    if (0 < fetchStatistics.FetchCount) {
+        response << " Fetch(success:" << fetchStatistics.SuccessCount
+                 << " retry:" << fetchStatistics.RetryCount
+                 << " give up:" << fetchStatistics.GiveUpCount
+                 << " latency:" << fetchStatistics.LastLatencyMillisecond << "ms"
+                 << " max:" << fetchStatistics.MaxLatencyMillisecond << "ms)";
+    }
+    if (0 < cacheStatistics.RequestCount) {
+        const HttpRequest::Timing timing = weatherForecast.GetLastRequestTiming();
+        response << " Timing(dns:" << timing.DnsMillisecond
+                 << " connect:" << timing.ConnectMillisecond
+                 << " wait:" << timing.WaitMillisecond
+                 << " transfer:" << timing.TransferMillisecond
+                 << (timing.IsReused ? "ms reused)" : "ms)");
+    }
+    response << "</p>";
 
 #if CONFIG_IS_ENABLE_WATER_LEVEL_CHECK
-    responseBody
+    response
         << "<h3>Warter Level</h3>"
-        << "<div class=\"gauge\"><div id=\"inner\" style=\"width:" << waterLevel << "%;  background-color:" << ::waterLevelToColorName(waterLevel) << ";\"></div><div id=\"num\">" << waterLevel << "%</div></div>";
+        << "<div class=\"gauge\" data-gauge=\"water_level\"><div class=\"inner\" style=\"width:" << waterLevel << "%;  background-color:" << ::waterLevelToColorName(waterLevel) << ";\"></div><div class=\"num\">" << waterLevel << "%</div></div>";
 #endif
 
 #if CONFIG_IS_ENABLE_VOLTAGE_CHECK
-    responseBody
+    response
         << "<h3>Battery Voltage</h3>"
-        << "<div class=\"gauge\"><div id=\"inner\" style=\"width:" << voltageGuage << "%; background-color:" << ::voltageToColorName(batteryVoltage) << ";\"></div><div id=\"num\">" << std::setfill('0') << std::fixed << std::setprecision(2) << batteryVoltage << "[V]</div></div>";
+        << "<div class=\"gauge\" data-gauge=\"voltage\"><div class=\"inner\" style=\"width:" << voltageGuage << "%; background-color:" << ::voltageToColorName(batteryVoltage) << ";\"></div><div class=\"num\">" << HtmlChunkWriter::Fixed{batteryVoltage, 2} << "[V]</div></div>";
 #endif
 
-    httpd_resp_sendstr_chunk(pHttpRequestData, responseBody.str().c_str());
-    responseBody.str("");
-    responseBody.clear(std::stringstream::goodbit);
-
     // -- Operation -----
-    responseBody
+    response
         << "<hr><h2>Operation</h2>"
         << "<form action=\"/manual_watering\" method=\"post\">"
         << "Manual Watering. time (sec) : <input type=\"number\" name=\"second\" value=\"10\" min=\"1\" max=\"" << WEB_RELAY_OPEN_MAX_SECOND << "\"> "
@@ -360,31 +565,121 @@ esp_err_t HttpdServerTask::RootHandler(httpd_req_t *pHttpRequestData)
         << "</form>";
 
     if (weatherSetting.IsActive()) {
-        responseBody
+        response
             << ":<form action=\"/download_setting\" method=\"get\" style=\"display:inline;\"><input type=\"submit\" value=\"Download\"></form>"
             << ":<form action=\"/delete_setting\" method=\"post\" style=\"display:inline;\" onsubmit=\"return checkSubmit('Are you sure you want to delete setting?');\">"
             << "<input type=\"submit\" value=\"Delete\"></form>"
             << "</p>";
     }
 
-    httpd_resp_sendstr_chunk(pHttpRequestData, responseBody.str().c_str());
-    responseBody.str("");
-    responseBody.clear(std::stringstream::goodbit);
-
     // -- Information -----
-    responseBody
+    response
         << "<hr>"
         << "<p>Version : " << GIT_VERSION << "</p>"
         << "</body></html>";
 
-    httpd_resp_sendstr_chunk(pHttpRequestData, responseBody.str().c_str());
-    responseBody.str("");
-    responseBody.clear(std::stringstream::goodbit);
+    const esp_err_t result = response.Finish();
+
+    // peak: the free heap at the start minus the lowest free heap seen while the chunks were sent
+    // low-water: the device lifetime minimum went down during the render (another task may share it)
+    const std::size_t renderPeakHeap = renderBeginFreeHeap - std::min(renderBeginFreeHeap, response.GetMinimumFreeHeap());
+    const std::size_t renderEndMinimumFreeHeap = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    ESP_LOGD(TAG, "Root rendered. %ubytes sent:%ubytes chunks:%u elapsed:%lldus heap peak:%u left:%d low-water lowered:%u",
+        static_cast<unsigned int>(response.GetRenderedBytes()), static_cast<unsigned int>(response.GetTotalBytes()), static_cast<unsigned int>(response.GetChunkCount()),
+        esp_timer_get_time() - renderBeginTime,
+        static_cast<unsigned int>(renderPeakHeap),
+        static_cast<int>(renderBeginFreeHeap) - static_cast<int>(heap_caps_get_free_size(MALLOC_CAP_8BIT)),
+        static_cast<unsigned int>(renderBeginMinimumFreeHeap - std::min(renderBeginMinimumFreeHeap, renderEndMinimumFreeHeap)));
+    return result;
+}
+#endif
+
+esp_err_t HttpdServerTask::InfoHandler(httpd_req_t *pHttpRequestData)
+{
+    ESP_LOGV(TAG, "WebServer Request Recv. Get:Info");
+
+    HttpdServerTask *const pHttpdServerTask = static_cast<HttpdServerTask*>(pHttpRequestData->user_ctx);
+    if (!pHttpdServerTask) {
+        ESP_LOGE(TAG, "Failed HttpdServerTask is null");
+        return ESP_FAIL;
+    }
+    const IrrigationInterfaceSharedPtr irrigationInterface = pHttpdServerTask->m_pIrrigationInterface.lock();
+    if (!irrigationInterface) {
+        ESP_LOGE(TAG, "Failed IrrigationInterface is null");
+        return ESP_FAIL;
+    }
+    const WeatherForecast::CacheStatistics cacheStatistics = irrigationInterface->GetWeatherForecast().GetCacheStatistics();
+    const WeatherForecastFetchStatistics fetchStatistics = irrigationInterface->GetWeatherForecastFetchStatistics();
+
+    // Device values for the console (the state is /api/status)
+    httpd_resp_set_type(pHttpRequestData, "application/json");
+    httpd_resp_set_hdr(pHttpRequestData, "Cache-Control", "no-cache");
+    HtmlChunkWriter response(pHttpRequestData);
+    JsonWriter json(response);
+    json.BeginObject()
+        .Key("version").String(GIT_VERSION)
+        .Key("debug").Bool(CONFIG_DEBUG != 0)
+        .Key("time_zone").String(CONFIG_LOCAL_TIME_ZONE)
+        .Key("manual_max_second").Int(WEB_RELAY_OPEN_MAX_SECOND)
+        .Key("features").BeginObject()
+            .Key("voltage").Bool(CONFIG_IS_ENABLE_VOLTAGE_CHECK)
+            .Key("water_level").Bool(CONFIG_IS_ENABLE_WATER_LEVEL_CHECK)
+        .EndObject()
+        .Key("forecast_statistics").BeginObject()
+            .Key("cache_request").Int(cacheStatistics.RequestCount)
+            .Key("cache_hit").Int(cacheStatistics.HitCount)
+            .Key("snapshot").Int(cacheStatistics.SnapshotCount)
+            .Key("fetch").Int(fetchStatistics.FetchCount)
+            .Key("success").Int(fetchStatistics.SuccessCount)
+            .Key("retry").Int(fetchStatistics.RetryCount)
+            .Key("give_up").Int(fetchStatistics.GiveUpCount)
+            .Key("latency_ms").Int(fetchStatistics.LastLatencyMillisecond)
+            .Key("max_latency_ms").Int(fetchStatistics.MaxLatencyMillisecond)
+        .EndObject()
+    .EndObject();
+    if (!json.Finish()) {
+        ESP_LOGE(TAG, "Failed Info json");
+        return ESP_FAIL;
+    }
+    return response.Finish();
+}
+
+esp_err_t HttpdServerTask::SendOperationResult(httpd_req_t *pHttpRequestData)
+{
+    // The single page console posts with "Accept: application/json" and reloads /api/status itself
+    static constexpr std::size_t ACCEPT_LENGTH = 64;
+    char accept[ACCEPT_LENGTH] = {};
+    const esp_err_t result = httpd_req_get_hdr_value_str(pHttpRequestData, "Accept", accept, sizeof(accept));
+    if (result == ESP_OK || result == ESP_ERR_HTTPD_RESULT_TRUNC) {
+        std::string_view acceptList(accept);
+        std::string_view item;
+        while (RequestParser::NextListItem(acceptList, item)) {
+            if (RequestParser::EqualsIgnoreCase(RequestParser::GetItemName(item), "application/json")) {
+                httpd_resp_set_type(pHttpRequestData, "application/json");
+                return httpd_resp_sendstr(pHttpRequestData, "{\"result\":\"ok\"}");
+            }
+        }
+    }
 
-    httpd_resp_sendstr_chunk(pHttpRequestData, nullptr);
+    // Redirect (form post)
+    httpd_resp_set_status(pHttpRequestData, "303 See Other");
+    httpd_resp_set_hdr(pHttpRequestData, "Location", "/");
+    httpd_resp_send(pHttpRequestData, NULL, 0);
     return ESP_OK;
 }
 
+esp_err_t HttpdServerTask::StaticAssetHandler(httpd_req_t *pHttpRequestData)
+{
+    ESP_LOGV(TAG, "WebServer Request Recv. Get:%s", pHttpRequestData->uri);
+
+    const StaticAsset *const pAsset = StaticAsset::Find(pHttpRequestData->uri);
+    if (!pAsset) {
+        httpd_resp_send_err(pHttpRequestData, HTTPD_404_NOT_FOUND, "Not Found");
+        return ESP_FAIL;
+    }
+    return pAsset->Send(pHttpRequestData);
+}
+
 esp_err_t HttpdServerTask::ManualWateringHandler(httpd_req_t *pHttpRequestData)
 {
     ESP_LOGV(TAG, "WebServer Request Recv. Post:ManualWatering");
@@ -396,34 +691,19 @@ esp_err_t HttpdServerTask::ManualWateringHandler(httpd_req_t *pHttpRequestData)
 
     // Receive Post Data
     static constexpr size_t SCRATCH_BUFSIZE = 256;
-    const int total_len = pHttpRequestData->content_len;
-
-    if (SCRATCH_BUFSIZE <= total_len) {
-        httpd_resp_send_err(pHttpRequestData, HTTPD_500_INTERNAL_SERVER_ERROR, "content too long");
+    char buf[SCRATCH_BUFSIZE];
+    std::size_t bodyLength = 0;
+    if (!ReceiveBody(pHttpRequestData, buf, sizeof(buf), bodyLength)) {
         return ESP_FAIL;
     }
-    char buf[SCRATCH_BUFSIZE] = {};
-    int cur_len = 0;
-    int received = 0;
-    while (cur_len < total_len) {
-        received = httpd_req_recv(pHttpRequestData, buf + cur_len, total_len);
-        if (received <= 0) {
-            httpd_resp_send_err(pHttpRequestData, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to post control value");
-            return ESP_FAIL;
-        }
-        cur_len += received;
-    }
-    buf[total_len] = '\0';
+    ESP_LOGV(TAG, " Recv Data Length:%u Data:%.*s", bodyLength, static_cast<int>(bodyLength), buf);
 
-    ESP_LOGV(TAG, " Recv Data Length:%d Data:%s", total_len, buf);
-    
-    // Parse
+    // Parse (second=N)
     int valveOpenSecond = 0;
-    std::vector<std::string> elements = Util::SplitString(buf, '=');   
-    if (elements.size() == 2) {
-        if (elements.at(0) == "second") {
-            valveOpenSecond = std::max(1, std::min(WEB_RELAY_OPEN_MAX_SECOND, static_cast<int>(std::stol(elements.at(1)))));
-        }
+    std::string_view secondText;
+    long second = 0;
+    if (RequestParser::FormReader(buf, bodyLength).Find("second", secondText) && RequestParser::ToInteger(secondText, second)) {
+        valveOpenSecond = static_cast<int>(std::max(1L, std::min(static_cast<long>(WEB_RELAY_OPEN_MAX_SECOND), second)));
     }
 
     // Valve Open
@@ -439,11 +719,7 @@ esp_err_t HttpdServerTask::ManualWateringHandler(httpd_req_t *pHttpRequestData)
     }
     irrigationInterface->ValveAddOpenSecond(valveOpenSecond);
  
-    // Redirect
-    httpd_resp_set_status(pHttpRequestData, "303 See Other");
-    httpd_resp_set_hdr(pHttpRequestData, "Location", "/");
-    httpd_resp_send(pHttpRequestData, NULL, 0);
-    return ESP_OK;
+    return SendOperationResult(pHttpRequestData);
 }
 
 esp_err_t HttpdServerTask::EmergencyStopHandler(httpd_req_t *pHttpRequestData)
@@ -468,11 +744,7 @@ esp_err_t HttpdServerTask::EmergencyStopHandler(httpd_req_t *pHttpRequestData)
     }
     irrigationInterface->ValveResetTimer();
 
-    // Redirect
-    httpd_resp_set_status(pHttpRequestData, "303 See Other");
-    httpd_resp_set_hdr(pHttpRequestData, "Location", "/");
-    httpd_resp_send(pHttpRequestData, NULL, 0);
-    return ESP_OK;
+    return SendOperationResult(pHttpRequestData);
 }
 
 
@@ -498,101 +770,68 @@ esp_err_t HttpdServerTask::UploadSettingHandler(httpd_req_t *pHttpRequestData)
 
     // Receive Header (get Multipart boundary)
     static constexpr char *const HTTP_HEADER_CONTENT_TYPE = (char*)"Content-Type";
-    const size_t contentTypeHeaderLen = httpd_req_get_hdr_value_len(pHttpRequestData, HTTP_HEADER_CONTENT_TYPE);
-    if (contentTypeHeaderLen == 0) {
-        ESP_LOGE(TAG, "Not Found Rqeust Header Empty: %s", HTTP_HEADER_CONTENT_TYPE);
-        return ESP_FAIL;
-    }
-    std::string contentType;
-    contentType.resize(contentTypeHeaderLen);
-    if (httpd_req_get_hdr_value_str(pHttpRequestData, HTTP_HEADER_CONTENT_TYPE, &contentType.at(0), contentTypeHeaderLen + 1) != ESP_OK) {
+    static constexpr std::size_t CONTENT_TYPE_LENGTH = 160;
+    char contentType[CONTENT_TYPE_LENGTH] = {};
+    if (httpd_req_get_hdr_value_str(pHttpRequestData, HTTP_HEADER_CONTENT_TYPE, contentType, sizeof(contentType)) != ESP_OK) {
         ESP_LOGE(TAG, "Not Found Rqeust Header : %s", HTTP_HEADER_CONTENT_TYPE);
+        httpd_resp_send_err(pHttpRequestData, HTTPD_400_BAD_REQUEST, "Invalid multipart");
         return ESP_FAIL;
     }
-    //ESP_LOGV(TAG, "Found header => %s: %s",HTTP_HEADER_CONTENT_TYPE, contentType.c_str());
-   
-    // Get Boundary String
-    const std::string BOUNDARY_STR = "boundary=";
-    std::string::size_type pos = contentType.find(BOUNDARY_STR); 
-    if (pos == std::string::npos) {
-        ESP_LOGE(TAG, "Failed Get Rqeust Header : %s", HTTP_HEADER_CONTENT_TYPE);
-        return ESP_FAIL;
-    }
-    const std::string boundaryStr = contentType.substr(pos + BOUNDARY_STR.length());
-    const std::string::size_type boundaryStrLength = boundaryStr.length();
-    //ESP_LOGV(TAG, "Boundary => %s", boundaryStr.c_str());
-
 
-    // Receive Post Data
-    static constexpr size_t MAX_FILE_SIZE = 10240; // 10 KB
-    const int total_len = pHttpRequestData->content_len;
-    if (MAX_FILE_SIZE <= total_len) {
-        httpd_resp_send_err(pHttpRequestData, HTTPD_500_INTERNAL_SERVER_ERROR, "content too long");
+    // One upload file
+    const std::unique_lock<std::mutex> settingLock = pHttpdServerTask->LockSetting();
+    SettingUploadWriter uploadWriter(WateringSetting::UPLOAD_FILE_NAME, "setting_file", CONFIG_SETTING_FILE_MAX_SIZE);
+    MultipartParser multipartParser(uploadWriter);
+    if (!multipartParser.SetContentType(contentType)) {
+        ESP_LOGE(TAG, "Failed Get Rqeust Header : %s", HTTP_HEADER_CONTENT_TYPE);
+        httpd_resp_send_err(pHttpRequestData, HTTPD_400_BAD_REQUEST, "Invalid multipart");
         return ESP_FAIL;
     }
 
-    ESP_LOGV(TAG, "Receive post data length:%d", total_len);
-    std::string body;
-    body.resize(total_len + 1);
-    int cur_len = 0;
-    int received = 0;
-    while (cur_len < total_len) {
-        received = httpd_req_recv(pHttpRequestData, &body.at(0) + cur_len, total_len);
-        if (received <= 0) {
-            httpd_resp_send_err(pHttpRequestData, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to post control value");
-            return ESP_FAIL;
+    // Receive Post Data (the setting_file part is written to the upload file as it arrives)
+    ESP_LOGV(TAG, "Receive post data length:%d", pHttpRequestData->content_len);
+    char receiveBuffer[CONFIG_HTTPD_UPLOAD_BUFFER_SIZE];
+    std::size_t remainLength = pHttpRequestData->content_len;
+    while (0 < remainLength) {
+        int received = 0;
+        {
+            const WaitScope waitScope;
+            received = httpd_req_recv(pHttpRequestData, receiveBuffer, std::min(remainLength, sizeof(receiveBuffer)));
         }
-        cur_len += received;
-    }
-    //ESP_LOGE(TAG, "Recv File \n-------\n%s", body.c_str());
-
-    // Split multipart data
-    std::vector<std::string> list;
-    if (boundaryStrLength == 0) {
-        list.push_back(body);
-    } else {
-        std::string::size_type offset = std::string::size_type(0);
-        while (true) {
-            std::string::size_type pos = body.find(std::string("--") + boundaryStr, offset);
-            if (pos == std::string::npos) {
-                std::string splitStr = body.substr(offset);
-                list.push_back(splitStr);
-                break;
-            }
-            std::string splitStr = body.substr(offset, pos - offset);
-            list.push_back(splitStr);
-            offset = pos + boundaryStrLength + 2;
+        if (received == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
         }
-    }
-
-    // Get Json Data
-    std::string payloadJsonData;
-    for (std::vector<std::string>::const_iterator iter = list.begin(); iter != list.end(); ++iter) {
-        //ESP_LOGV(TAG, "Split\n%s", (*iter).c_str());
-        if (iter->find("name=\"setting_file\"") != std::string::npos) {
-            std::string::size_type begin = iter->find("\r\n\r\n") + 4;
-            std::string::size_type end = iter->rfind("\r\n");
-            if ((end - begin) <= 0) {
-                break;
-            }
-            payloadJsonData = iter->substr(begin, end - begin);
-            ESP_LOGV(TAG, "OK Payload-------\n%s\n-----", payloadJsonData.c_str());
+        if (received <= 0 || !multipartParser.Feed(receiveBuffer, received)) {
             break;
         }
+        remainLength -= received;
     }
-    
-    // Parse
-    WateringSetting& weatherSetting = irrigationInterface->GetWateringSetting();
-    if (!weatherSetting.SetSettingData(payloadJsonData)) {
-        httpd_resp_send_err(pHttpRequestData, HTTPD_500_INTERNAL_SERVER_ERROR, "Invalid Data");
+    uploadWriter.Close();
+    if (0 < remainLength || !multipartParser.Finish() || !uploadWriter.IsComplete()) {
+        WateringSetting::DeleteUpload();
+        if (uploadWriter.IsTooLarge()) {
+            httpd_resp_send_err(pHttpRequestData, HTTPD_400_BAD_REQUEST, "content too long");
+        } else {
+            httpd_resp_send_err(pHttpRequestData, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to post control value");
+        }
         return ESP_FAIL;
     }
-    
-    // Save
-    if (!WateringSetting::Save(payloadJsonData)) {
+    ESP_LOGI(TAG, "Upload setting. size:%u", uploadWriter.GetWrittenSize());
+
+    // Validate
+    WateringSetting uploadSetting;
+    if (!uploadSetting.LoadFile(WateringSetting::UPLOAD_FILE_NAME)) {
+        WateringSetting::DeleteUpload();
+        httpd_resp_send_err(pHttpRequestData, HTTPD_400_BAD_REQUEST, "Invalid Data");
+        return ESP_FAIL;
+    }
+
+    // Swap
+    if (!WateringSetting::InstallUpload()) {
         httpd_resp_send_err(pHttpRequestData, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed save");
         return ESP_FAIL;
     }
+    irrigationInterface->GetWateringSetting() = std::move(uploadSetting);
 
     // Init Schedule
     const ScheduleManagerSharedPtr scheduleManager = irrigationInterface->GetScheduleManager().lock();
@@ -603,26 +842,20 @@ esp_err_t HttpdServerTask::UploadSettingHandler(httpd_req_t *pHttpRequestData)
     const std::tm nowTimeInfo = Util::GetLocalTime();
     scheduleManager->InitializeNewDay(nowTimeInfo);
 
-    // Redirect
-    httpd_resp_set_status(pHttpRequestData, "303 See Other");
-    httpd_resp_set_hdr(pHttpRequestData, "Location", "/");
-    httpd_resp_send(pHttpRequestData, NULL, 0);
-    return ESP_OK;
+    return SendOperationResult(pHttpRequestData);
 }
 
 esp_err_t HttpdServerTask::DownloadSettingHandler(httpd_req_t *pHttpRequestData)
 {
     ESP_LOGV(TAG, "WebServer Request Recv. Post:DownloadSetting");
 
-    std::string rawSettingData;
-    if (!WateringSetting::Load(rawSettingData)) {
-        ESP_LOGE(TAG, "Failed Load Setting File");
+    HttpdServerTask *const pHttpdServerTask = static_cast<HttpdServerTask*>(pHttpRequestData->user_ctx);
+    if (!pHttpdServerTask) {
+        ESP_LOGE(TAG, "Failed HttpdServerTask is null");
         return ESP_FAIL;
     }
-
-    httpd_resp_set_type(pHttpRequestData, "application/json");
-    httpd_resp_send(pHttpRequestData, rawSettingData.c_str(), rawSettingData.length());
-    return ESP_OK;
+    const std::unique_lock<std::mutex> settingLock = pHttpdServerTask->LockSetting();
+    return FileResponse::Send(pHttpRequestData, WateringSetting::SETTING_FILE_NAME, "application/json");
 }
  
 esp_err_t HttpdServerTask::DeleteSettingHandler(httpd_req_t *pHttpRequestData)
@@ -646,6 +879,7 @@ esp_err_t HttpdServerTask::DeleteSettingHandler(httpd_req_t *pHttpRequestData)
     }
 
     // Delete
+    const std::unique_lock<std::mutex> settingLock = pHttpdServerTask->LockSetting();
     if (!WateringSetting::Delete()) {
         httpd_resp_send_err(pHttpRequestData, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed delete");
         return ESP_FAIL;
@@ -664,11 +898,7 @@ esp_err_t HttpdServerTask::DeleteSettingHandler(httpd_req_t *pHttpRequestData)
     const std::tm nowTimeInfo = Util::GetLocalTime();
     scheduleManager->InitializeNewDay(nowTimeInfo);
 
-    // Redirect
-    httpd_resp_set_status(pHttpRequestData, "303 See Other");
-    httpd_resp_set_hdr(pHttpRequestData, "Location", "/");
-    httpd_resp_send(pHttpRequestData, NULL, 0);
-    return ESP_OK;
+    return SendOperationResult(pHttpRequestData);
 }
 
 esp_err_t HttpdServerTask::GetVoltageHandler(httpd_req_t *pHttpRequestData)
@@ -676,25 +906,43 @@ esp_err_t HttpdServerTask::GetVoltageHandler(httpd_req_t *pHttpRequestData)
     ESP_LOGV(TAG, "WebServer Request Recv. Get:GetVoltage");
 
 #if CONFIG_IS_ENABLE_VOLTAGE_CHECK
-    const float voltage = Util::GetVoltage();
+    HttpdServerTask *const pHttpdServerTask = static_cast<HttpdServerTask*>(pHttpRequestData->user_ctx);
+    if (!pHttpdServerTask) {
+        ESP_LOGE(TAG, "Failed HttpdServerTask is null");
+        return ESP_FAIL;
+    }
+    const IrrigationInterfaceSharedPtr irrigationInterface = pHttpdServerTask->m_pIrrigationInterface.lock();
+    if (!irrigationInterface) {
+        ESP_LOGE(TAG, "Failed IrrigationInterface is null");
+        return ESP_FAIL;
+    }
+
+    // Cached sample. (The ADC is read by VoltageCheckTask when it is stale)
+    const VoltageSample sample = irrigationInterface->GetMainVoltageSample();
 
     // Generate Response 
-    std::stringstream responseBody;
-    responseBody 
-        << "{\"voltage\":"
-        << std::setfill('0') 
-        << std::fixed 
-        << std::setprecision(2) 
-        << voltage 
-        << "}";
+    char body[SMALL_JSON_SIZE];
+    JsonBufferSink sink(body, sizeof(body));
+    JsonWriter json(sink);
+    json.BeginObject().Key("voltage").Fixed(sample.Voltage, 2).Key("age_ms");
+    if (sample.AgeMillisecond < 0) {
+        json.Null();
+    } else {
+        json.Int(sample.AgeMillisecond);
+    }
+    json.Key("stale").Bool(sample.IsStale).EndObject();
 #else
-    std::stringstream responseBody;
-    responseBody
-        << "{\"voltage\": 0}";
-
+    char body[SMALL_JSON_SIZE];
+    JsonBufferSink sink(body, sizeof(body));
+    JsonWriter json(sink);
+    json.BeginObject().Key("voltage").Int(0).EndObject();
 #endif
+    if (!json.Finish()) {
+        ESP_LOGE(TAG, "Failed Voltage json");
+        return ESP_FAIL;
+    }
     httpd_resp_set_type(pHttpRequestData, "application/json");
-    httpd_resp_send(pHttpRequestData, responseBody.str().c_str(), responseBody.str().length());
+    httpd_resp_send(pHttpRequestData, sink.GetData(), sink.GetLength());
     return ESP_OK;
 }
 
@@ -717,26 +965,270 @@ esp_err_t HttpdServerTask::GetWaterLevelHandler(httpd_req_t *pHttpRequestData)
     const float waterLevel = irrigationInterface->GetWaterLevel();
 
     // Generate Response 
-    std::stringstream responseBody;
-    responseBody 
-        << "{\"water_level\":"
-        << std::setfill('0') 
-        << std::fixed 
-        << std::setprecision(2) 
-        << waterLevel
-        << "}";
+    char body[SMALL_JSON_SIZE];
+    JsonBufferSink sink(body, sizeof(body));
+    JsonWriter json(sink);
+    json.BeginObject().Key("water_level").Fixed(waterLevel, 2).EndObject();
 #else
     ESP_LOGI(TAG, "WATER LEVEL CHECK 5 ");
-    std::stringstream responseBody;
-    responseBody
-        << "{\"water_level\": 0}";
-
+    char body[SMALL_JSON_SIZE];
+    JsonBufferSink sink(body, sizeof(body));
+    JsonWriter json(sink);
+    json.BeginObject().Key("water_level").Int(0).EndObject();
 #endif
+    if (!json.Finish()) {
+        ESP_LOGE(TAG, "Failed WaterLevel json");
+        return ESP_FAIL;
+    }
     httpd_resp_set_type(pHttpRequestData, "application/json");
-    httpd_resp_send(pHttpRequestData, responseBody.str().c_str(), responseBody.str().length());
+    httpd_resp_send(pHttpRequestData, sink.GetData(), sink.GetLength());
     return ESP_OK;
 }
 
+esp_err_t HttpdServerTask::StatusHandler(httpd_req_t *pHttpRequestData)
+{
+    ESP_LOGV(TAG, "WebServer Request Recv. Get:Status");
+
+    HttpdServerTask *const pHttpdServerTask = static_cast<HttpdServerTask*>(pHttpRequestData->user_ctx);
+    if (!pHttpdServerTask) {
+        ESP_LOGE(TAG, "Failed HttpdServerTask is null");
+        return ESP_FAIL;
+    }
+    const IrrigationInterfaceSharedPtr irrigationInterface = pHttpdServerTask->m_pIrrigationInterface.lock();
+    if (!irrigationInterface) {
+        ESP_LOGE(TAG, "Failed IrrigationInterface is null");
+        return ESP_FAIL;
+    }
+
+    // Serialized by the management task. The document is kept alive until sent
+    const StatusSnapshot::DocumentConstSharedPtr pDocument = irrigationInterface->GetStatusSnapshot().GetDocument();
+    if (!pDocument) {
+        return SendRetryLater(pHttpRequestData, "503 Service Unavailable", 1);
+    }
+
+    httpd_resp_set_hdr(pHttpRequestData, "ETag", pDocument->ETag);
+    httpd_resp_set_hdr(pHttpRequestData, "Cache-Control", "no-cache");
+
+    static constexpr std::size_t IF_NONE_MATCH_LENGTH = 64;
+    char ifNoneMatch[IF_NONE_MATCH_LENGTH] = {};
+    if (httpd_req_get_hdr_value_str(pHttpRequestData, "If-None-Match", ifNoneMatch, sizeof(ifNoneMatch)) == ESP_OK
+        && std::strstr(ifNoneMatch, pDocument->ETag) != nullptr) {
+        httpd_resp_set_status(pHttpRequestData, "304 Not Modified");
+        return httpd_resp_send(pHttpRequestData, nullptr, 0);
+    }
+
+    httpd_resp_set_type(pHttpRequestData, "application/json");
+    return httpd_resp_send(pHttpRequestData, pDocument->Body.data(), pDocument->Body.size());
+}
+
+esp_err_t HttpdServerTask::EventStreamHandler(httpd_req_t *pHttpRequestData)
+{
+    ESP_LOGV(TAG, "WebServer Request Recv. Get:EventStream");
+
+    HttpdServerTask *const pHttpdServerTask = static_cast<HttpdServerTask*>(pHttpRequestData->user_ctx);
+    if (!pHttpdServerTask) {
+        ESP_LOGE(TAG, "Failed HttpdServerTask is null");
+        return ESP_FAIL;
+    }
+    const IrrigationInterfaceSharedPtr irrigationInterface = pHttpdServerTask->m_pIrrigationInterface.lock();
+    if (!irrigationInterface) {
+        ESP_LOGE(TAG, "Failed IrrigationInterface is null");
+        return ESP_FAIL;
+    }
+
+    // Returns at once. The events are sent from the httpd task as they are published
+    return irrigationInterface->GetEventStream().Subscribe(pHttpRequestData);
+}
+
+void HttpdServerTask::CloseSessionHandler(httpd_handle_t httpdHandle, int sockfd)
+{
+    HttpdServerTask *const pHttpdServerTask = static_cast<HttpdServerTask*>(httpd_get_global_user_ctx(httpdHandle));
+    if (pHttpdServerTask) {
+        const IrrigationInterfaceSharedPtr irrigationInterface = pHttpdServerTask->m_pIrrigationInterface.lock();
+        if (irrigationInterface) {
+            irrigationInterface->GetEventStream().Unsubscribe(sockfd);
+        }
+    }
+    // The socket is closed here when close_fn is set
+    close(sockfd);
+}
+
+void HttpdServerTask::FreeGlobalContext(void *pContext) {}
+
+esp_err_t HttpdServerTask::MetricsHandler(httpd_req_t *pHttpRequestData)
+{
+    ESP_LOGV(TAG, "WebServer Request Recv. Get:Metrics");
+
+    HttpdServerTask *const pHttpdServerTask = static_cast<HttpdServerTask*>(pHttpRequestData->user_ctx);
+    if (!pHttpdServerTask) {
+        ESP_LOGE(TAG, "Failed HttpdServerTask is null");
+        return ESP_FAIL;
+    }
+    const IrrigationInterfaceSharedPtr irrigationInterface = pHttpdServerTask->m_pIrrigationInterface.lock();
+    if (!irrigationInterface) {
+        ESP_LOGE(TAG, "Failed IrrigationInterface is null");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(pHttpRequestData, "text/plain; version=0.0.4");
+    GzipEncoder gzipEncoder;
+    HtmlChunkWriter response(pHttpRequestData, HtmlChunkWriter::IsGzipAccepted(pHttpRequestData) ? &gzipEncoder : nullptr);
+
+    // System
+    static constexpr std::int64_t SECOND_TO_MICRO = 1000 * 1000;
+    Metrics::WriteHeader(response, "irrigation_uptime_seconds", "Time since boot", Metric::TYPE_GAUGE);
+    Metrics::WriteSample(response, "irrigation_uptime_seconds", nullptr, esp_timer_get_time() / SECOND_TO_MICRO);
+    Metrics::WriteHeader(response, "irrigation_heap_free_bytes", "Free heap", Metric::TYPE_GAUGE);
+    Metrics::WriteSample(response, "irrigation_heap_free_bytes", nullptr, heap_caps_get_free_size(MALLOC_CAP_8BIT));
+    Metrics::WriteHeader(response, "irrigation_heap_minimum_free_bytes", "Minimum free heap since boot", Metric::TYPE_GAUGE);
+    Metrics::WriteSample(response, "irrigation_heap_minimum_free_bytes", nullptr, heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+    Metrics::WriteHeader(response, "irrigation_heap_largest_free_block_bytes", "Largest free heap block", Metric::TYPE_GAUGE);
+    Metrics::WriteSample(response, "irrigation_heap_largest_free_block_bytes", nullptr, heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+
+    // Tasks (the http server task is not a Task)
+    static constexpr char *const STACK_METRIC = (char*)"irrigation_task_stack_high_water_mark_bytes";
+    static constexpr std::size_t LABEL_LENGTH = 48;
+    static constexpr std::size_t TASK_NAME_LENGTH = 32;
+    char label[LABEL_LENGTH];
+    char taskName[TASK_NAME_LENGTH];
+    Metrics::WriteHeader(response, STACK_METRIC, "Minimum free stack of the task since its start", Metric::TYPE_GAUGE);
+    for (std::size_t i = 0; i < Task::MAX_RUNNING_TASK; ++i) {
+        // A task that is not running is skipped
+        std::uint32_t stackHighWaterMark = 0;
+        if (Task::SampleRunningTask(i, taskName, sizeof(taskName), stackHighWaterMark)) {
+            std::snprintf(label, sizeof(label), "task=\"%s\"", taskName);
+            Metrics::WriteSample(response, STACK_METRIC, label, stackHighWaterMark);
+        }
+    }
+    const TaskHandle_t httpdTaskHandle = pHttpdServerTask->m_HttpdTaskHandle.load(std::memory_order_relaxed);
+    if (httpdTaskHandle) {
+        Metrics::WriteSample(response, STACK_METRIC, "task=\"httpd\"", uxTaskGetStackHighWaterMark(httpdTaskHandle));
+    }
+
+    // Http
+    static constexpr char *const REQUEST_METRIC = (char*)"irrigation_http_requests_total";
+    Metrics::WriteHeader(response, REQUEST_METRIC, "HTTP requests by URI", Metric::TYPE_COUNTER);
+    for (std::size_t i = 0; i < pHttpdServerTask->m_RouteCount; ++i) {
+        const Route& route = pHttpdServerTask->m_pRouteList[i];
+        std::snprintf(label, sizeof(label), "uri=\"%s\"", route.Uri);
+        Metrics::WriteSample(response, REQUEST_METRIC, label, route.RequestCount.load(std::memory_order_relaxed));
+    }
+    WriteHistogram(response, "irrigation_http_handler_duration_seconds", "Handler time by URI", *pHttpdServerTask, false);
+    WriteHistogram(response, "irrigation_http_handler_wait_seconds", "Handler time waiting on locks and hardware by URI", *pHttpdServerTask, true);
+
+    // Weather forecast cache
+    const WeatherForecast::CacheStatistics cacheStatistics = irrigationInterface->GetWeatherForecast().GetCacheStatistics();
+    Metrics::WriteHeader(response, "irrigation_forecast_cache_requests_total", "Weather forecast requests by cache result", Metric::TYPE_COUNTER);
+    Metrics::WriteSample(response, "irrigation_forecast_cache_requests_total", "result=\"hit\"", cacheStatistics.HitCount);
+    Metrics::WriteSample(response, "irrigation_forecast_cache_requests_total", "result=\"miss\"", cacheStatistics.MissCount);
+    Metrics::WriteSample(response, "irrigation_forecast_cache_requests_total", "result=\"snapshot\"", cacheStatistics.SnapshotCount);
+
+    // Json arena
+    const JsonArena::Statistics arenaStatistics = JsonArena::GetStatistics();
+    Metrics::WriteHeader(response, "irrigation_json_arena_parse_total", "Records parsed in the cJSON arena", Metric::TYPE_COUNTER);
+    Metrics::WriteSample(response, "irrigation_json_arena_parse_total", nullptr, arenaStatistics.ParseCount);
+    Metrics::WriteHeader(response, "irrigation_json_arena_max_peak_bytes", "Largest cJSON arena high-water mark", Metric::TYPE_GAUGE);
+    Metrics::WriteSample(response, "irrigation_json_arena_max_peak_bytes", nullptr, arenaStatistics.MaxPeakBytes);
+
+    // Instrumented counters
+    Metrics::WriteRegistry(response);
+
+    return response.Finish();
+}
+
+esp_err_t HttpdServerTask::LatencyHandler(httpd_req_t *pHttpRequestData)
+{
+    ESP_LOGV(TAG, "WebServer Request Recv. Get:Latency");
+
+    HttpdServerTask *const pHttpdServerTask = static_cast<HttpdServerTask*>(pHttpRequestData->user_ctx);
+    if (!pHttpdServerTask) {
+        ESP_LOGE(TAG, "Failed HttpdServerTask is null");
+        return ESP_FAIL;
+    }
+
+    // Quantiles in milliseconds
+    static constexpr std::uint32_t QUANTILE_PERCENT[] = {50, 95, 99};
+    static constexpr std::size_t QUANTILE_KEY_LENGTH = 16;
+    httpd_resp_set_type(pHttpRequestData, "application/json");
+    GzipEncoder gzipEncoder;
+    HtmlChunkWriter response(pHttpRequestData, HtmlChunkWriter::IsGzipAccepted(pHttpRequestData) ? &gzipEncoder : nullptr);
+    JsonWriter json(response);
+    json.BeginObject().Key("routes").BeginArray();
+    char key[QUANTILE_KEY_LENGTH];
+    for (std::size_t i = 0; i < pHttpdServerTask->m_RouteCount; ++i) {
+        const Route& route = pHttpdServerTask->m_pRouteList[i];
+        json.BeginObject()
+            .Key("uri").String(route.Uri)
+            .Key("count").Int(route.Latency.GetCount());
+        for (const LatencyHistogram *const pHistogram : {&route.Latency, &route.Wait}) {
+            const char *const pPrefix = (pHistogram == &route.Wait) ? "wait_" : "";
+            for (const std::uint32_t percent : QUANTILE_PERCENT) {
+                std::snprintf(key, sizeof(key), "%sp%" PRIu32 "_ms", pPrefix, percent);
+                // 0.1ms resolution
+                json.Key(key).Scaled((pHistogram->GetQuantileMicrosecond(percent) + 50) / 100, 1);
+            }
+        }
+        json.EndObject();
+    }
+    json.EndArray().EndObject();
+    if (!json.Finish()) {
+        ESP_LOGE(TAG, "Failed Latency json");
+        return ESP_FAIL;
+    }
+    return response.Finish();
+}
+
+void HttpdServerTask::WriteHistogram(HtmlChunkWriter& writer, const char *const name, const char *const help, const HttpdServerTask& httpdServerTask, const bool isWait)
+{
+    static constexpr std::size_t NAME_LENGTH = 64;
+    static constexpr std::size_t LABEL_LENGTH = 64;
+    char sampleName[NAME_LENGTH];
+    char label[LABEL_LENGTH];
+
+    writer << "# HELP " << name << ' ' << help << '\n' << "# TYPE " << name << " histogram\n";
+    for (std::size_t i = 0; i < httpdServerTask.m_RouteCount; ++i) {
+        const Route& route = httpdServerTask.m_pRouteList[i];
+        const LatencyHistogram& histogram = isWait ? route.Wait : route.Latency;
+
+        // Cumulative buckets
+        std::snprintf(sampleName, sizeof(sampleName), "%s_bucket", name);
+        std::uint32_t cumulative = 0;
+        for (std::size_t bucket = 0; bucket < LatencyHistogram::BUCKET_COUNT; ++bucket) {
+            cumulative += histogram.GetBucketCount(bucket);
+            std::snprintf(label, sizeof(label), "uri=\"%s\",le=\"%s\"", route.Uri, LatencyHistogram::GetBucketLabel(bucket));
+            Metrics::WriteSample(writer, sampleName, label, cumulative);
+        }
+        std::snprintf(label, sizeof(label), "uri=\"%s\"", route.Uri);
+        std::snprintf(sampleName, sizeof(sampleName), "%s_sum", name);
+        // Seconds with the microsecond digits (integer, float would lose them as the sum grows)
+        static constexpr std::uint64_t SECOND_TO_MICRO = 1000 * 1000;
+        static constexpr int MICRO_DIGITS = 6;
+        const std::uint64_t sumMicrosecond = histogram.GetSumMicrosecond();
+        writer << sampleName << '{' << label << "} " << static_cast<long long>(sumMicrosecond / SECOND_TO_MICRO)
+               << '.' << HtmlChunkWriter::ZeroPad{static_cast<int>(sumMicrosecond % SECOND_TO_MICRO), MICRO_DIGITS} << '\n';
+        std::snprintf(sampleName, sizeof(sampleName), "%s_count", name);
+        Metrics::WriteSample(writer, sampleName, label, cumulative);
+    }
+}
+
+
+WeatherForecast::Language HttpdServerTask::GetRequestLanguage(httpd_req_t *pHttpRequestData)
+{
+    // The first language of the list. e.g. "ja,en-US;q=0.9"
+    static constexpr std::size_t LANGUAGE_LENGTH = 32;
+    char language[LANGUAGE_LENGTH] = {};
+    // ESP_ERR_HTTPD_RESULT_TRUNC is expected (only the head is needed)
+    const esp_err_t result = httpd_req_get_hdr_value_str(pHttpRequestData, "Accept-Language", language, sizeof(language));
+    if (result != ESP_OK && result != ESP_ERR_HTTPD_RESULT_TRUNC) {
+        return WeatherForecast::LANGUAGE_EN;
+    }
+    std::string_view languageList(language);
+    std::string_view item;
+    if (RequestParser::NextListItem(languageList, item) && RequestParser::EqualsIgnoreCase(RequestParser::GetItemName(item).substr(0, 2), "ja")) {
+        return WeatherForecast::LANGUAGE_JA;
+    }
+    return WeatherForecast::LANGUAGE_EN;
+}
 
 esp_err_t HttpdServerTask::ErrorNotFoundHandler(httpd_req_t *pHttpRequestData, httpd_err_code_t errCode)
 {
@@ -7,11 +7,23 @@
 #include <soc/soc.h>
 #include <esp_http_server.h>
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
 #include "task.h"
+#include "latency_histogram.h"
+#include "httpd_worker_pool.h"
+#include "admission_control.h"
 #include "irrigation_interface.h"
+#include "weather_forecast.h"
 
 namespace IrrigationSystem {
 
+class HtmlChunkWriter;
+
 class HttpdServerTask final : public Task
 {
 public:
@@ -19,6 +31,39 @@ public:
     static constexpr int PRIORITY = Task::PRIORITY_LOW;
     static constexpr int CORE_ID = APP_CPU_NUM;
 
+    /// Number of the registered URI handlers
+    static constexpr std::size_t MAX_ROUTE_COUNT = 24;
+
+private:
+    using RequestHandler = esp_err_t (*)(httpd_req_t *pHttpRequestData);
+
+    /// Where the handler of the route runs
+    enum RouteLane : int {
+        /// On the httpd server task (short handlers)
+        ROUTE_LANE_INLINE,
+        /// On a worker (flash, ADC, page render, upload)
+        ROUTE_LANE_WORKER,
+        /// On the priority worker (valve control)
+        ROUTE_LANE_PRIORITY,
+    };
+
+    /// Registered URI handler (user_ctx of DispatchHandler)
+    struct Route
+    {
+        const char *Uri;
+        httpd_method_t Method;
+        RequestHandler Handler;
+        RouteLane Lane;
+        /// Rate limit class (from the lane)
+        AdmissionControl::RouteClass Class;
+        HttpdServerTask *pHttpdServerTask;
+        std::atomic<std::uint32_t> RequestCount;
+        /// Handler time
+        LatencyHistogram Latency;
+        /// Part of the handler time waiting on locks, flash, ADC and sockets (WaitScope)
+        LatencyHistogram Wait;
+    };
+
 public:
     explicit HttpdServerTask(const IrrigationInterfaceWeakPtr pIrrigationInterface);
    
@@ -30,8 +75,30 @@ private:
     httpd_handle_t StartWebServer();
     void StopWebServer();
 
+    /// Register the handler through DispatchHandler
+    bool RegisterRoute(const httpd_handle_t httpdHandle, const char *const uri, const httpd_method_t method, const RequestHandler handler, const RouteLane lane = ROUTE_LANE_INLINE);
+
+    /// The handlers reading or replacing the watering setting run on different workers
+    std::unique_lock<std::mutex> LockSetting();
+
 private:
+    /// Count the request, admit it and call the handler of the route (with the task as the user_ctx)
+    static esp_err_t DispatchHandler(httpd_req_t *pHttpRequestData);
+
+    /// Refused request (429 or 503 with Retry-After). No handler work is done
+    static esp_err_t SendRetryLater(httpd_req_t *pHttpRequestData, const char *const status, const std::uint32_t retryAfterSecond);
+
+    /// Call the handler of the route and record its time
+    static esp_err_t RunRoute(httpd_req_t *pHttpRequestData, Route& route, const std::uint32_t queueMicrosecond);
+
+    /// (HttpdWorkerPool::Runner) RunRoute on a worker
+    static void RunRouteOnWorker(httpd_req_t *pHttpRequestData, void *pContext, const std::uint32_t queueMicrosecond);
+
+#if CONFIG_HTTPD_SERVER_RENDERED_CONSOLE
     static esp_err_t RootHandler(httpd_req_t *pHttpRequestData);
+#endif
+    static esp_err_t InfoHandler(httpd_req_t *pHttpRequestData);
+    static esp_err_t StaticAssetHandler(httpd_req_t *pHttpRequestData);
     static esp_err_t ManualWateringHandler(httpd_req_t *pHttpRequestData);
     static esp_err_t EmergencyStopHandler(httpd_req_t *pHttpRequestData);
     static esp_err_t UploadSettingHandler(httpd_req_t *pHttpRequestData);
@@ -39,11 +106,41 @@ private:
     static esp_err_t DeleteSettingHandler(httpd_req_t *pHttpRequestData);
     static esp_err_t GetVoltageHandler(httpd_req_t *pHttpRequestData);
     static esp_err_t GetWaterLevelHandler(httpd_req_t *pHttpRequestData);
+    static esp_err_t StatusHandler(httpd_req_t *pHttpRequestData);
+    static esp_err_t EventStreamHandler(httpd_req_t *pHttpRequestData);
+    static esp_err_t MetricsHandler(httpd_req_t *pHttpRequestData);
+    static esp_err_t LatencyHandler(httpd_req_t *pHttpRequestData);
     static esp_err_t ErrorNotFoundHandler(httpd_req_t *pHttpRequestData, httpd_err_code_t errCode);
 
+    /// (httpd close_fn) Drop the event stream client of the session
+    static void CloseSessionHandler(httpd_handle_t httpdHandle, int sockfd);
+
+    /// (httpd global_user_ctx_free_fn) The task owns itself
+    static void FreeGlobalContext(void *pContext);
+
+    /// Prometheus histogram of the routes (handler time or its wait part)
+    static void WriteHistogram(HtmlChunkWriter& writer, const char *const name, const char *const help, const HttpdServerTask& httpdServerTask, const bool isWait);
+
+    /// Result of an operation. json for the single page console, otherwise the redirect to the page
+    static esp_err_t SendOperationResult(httpd_req_t *pHttpRequestData);
+
+    /// Receive the whole body (form) into the buffer. An error response is sent on failure
+    static bool ReceiveBody(httpd_req_t *pHttpRequestData, char *const pBuffer, const std::size_t bufferSize, std::size_t& length);
+
+    /// Weather name language from Accept-Language
+    static WeatherForecast::Language GetRequestLanguage(httpd_req_t *pHttpRequestData);
+
 private:
     const IrrigationInterfaceWeakPtr m_pIrrigationInterface;
     httpd_handle_t m_HttpdHandle;
+    /// Heap (the task object is on the stack of the main task)
+    std::unique_ptr<Route[]> m_pRouteList;
+    std::size_t m_RouteCount;
+    HttpdWorkerPool m_WorkerPool;
+    AdmissionControl m_AdmissionControl;
+    std::mutex m_SettingMutex;
+    /// The httpd server task (taken by DispatchHandler, for its stack sample. nullptr while stopped)
+    std::atomic<TaskHandle_t> m_HttpdTaskHandle;
 };
 
 } // IrrigationSystem
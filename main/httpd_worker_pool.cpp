@@ -0,0 +1,99 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include "httpd_worker_pool.h"
+
+#include <esp_timer.h>
+
+#include "logger.h"
+
+namespace IrrigationSystem {
+
+namespace {
+    constexpr std::size_t PRIORITY_QUEUE_LENGTH = 2;
+    /// Above the management task so a stop request is not delayed by the schedule
+    constexpr int PRIORITY_WORKER_PRIORITY = Task::PRIORITY_HIGH + 1;
+    /// Same as the httpd server task
+    constexpr int NORMAL_WORKER_PRIORITY = Task::PRIORITY_LOW;
+}
+
+HttpdWorkerPool::WorkerTask::WorkerTask(const std::string& taskName, const int priority, const QueueHandle_t queueHandle)
+    :Task(taskName, priority, APP_CPU_NUM)
+    ,m_QueueHandle(queueHandle)
+{}
+
+void HttpdWorkerPool::WorkerTask::Update()
+{
+    Job job = {};
+    if (xQueueReceive(m_QueueHandle, &job, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
+    const std::int64_t queueMicrosecond = esp_timer_get_time() - job.QueueTime;
+    job.JobRunner(job.pHttpRequestData, job.pContext, static_cast<std::uint32_t>(queueMicrosecond));
+    // The socket is given back to the server
+    httpd_req_async_handler_complete(job.pHttpRequestData);
+}
+
+
+HttpdWorkerPool::HttpdWorkerPool()
+    :m_NormalQueueHandle(nullptr)
+    ,m_PriorityQueueHandle(nullptr)
+    ,m_WorkerList()
+{}
+
+bool HttpdWorkerPool::Start()
+{
+    if (m_NormalQueueHandle) {
+        return true;
+    }
+    m_NormalQueueHandle = xQueueCreate(CONFIG_HTTPD_WORKER_QUEUE_LENGTH, sizeof(Job));
+    m_PriorityQueueHandle = xQueueCreate(PRIORITY_QUEUE_LENGTH, sizeof(Job));
+    if (!m_NormalQueueHandle || !m_PriorityQueueHandle) {
+        ESP_LOGE(TAG, "Failed to create the httpd worker queue");
+        return false;
+    }
+
+    for (std::size_t i = 0; i < WORKER_COUNT; ++i) {
+        const bool isPriority = NORMAL_WORKER_COUNT <= i;
+        m_WorkerList[i] = std::make_unique<WorkerTask>(
+            (isPriority ? "HttpdPriorityWorker" : "HttpdWorker") + std::to_string(i),
+            isPriority ? PRIORITY_WORKER_PRIORITY : NORMAL_WORKER_PRIORITY,
+            isPriority ? m_PriorityQueueHandle : m_NormalQueueHandle);
+        m_WorkerList[i]->Start();
+    }
+    ESP_LOGI(TAG, "Httpd worker started. normal:%u priority:%u",
+        static_cast<unsigned int>(NORMAL_WORKER_COUNT), static_cast<unsigned int>(PRIORITY_WORKER_COUNT));
+    return true;
+}
+
+bool HttpdWorkerPool::Submit(httpd_req_t *pHttpRequestData, const Lane lane, const Runner runner, void *const pContext)
+{
+    const QueueHandle_t queueHandle = (lane == LANE_PRIORITY) ? m_PriorityQueueHandle : m_NormalQueueHandle;
+    // Only the httpd server task submits, so the free space can not be taken in between
+    if (!queueHandle || uxQueueSpacesAvailable(queueHandle) == 0) {
+        return false;
+    }
+
+    httpd_req_t *pAsyncRequest = nullptr;
+    if (httpd_req_async_handler_begin(pHttpRequestData, &pAsyncRequest) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to begin the async request");
+        return false;
+    }
+    const Job job = {pAsyncRequest, runner, pContext, esp_timer_get_time()};
+    if (xQueueSend(queueHandle, &job, 0) != pdTRUE) {
+        httpd_req_async_handler_complete(pAsyncRequest);
+        return false;
+    }
+    return true;
+}
+
+std::uint32_t HttpdWorkerPool::GetQueuedCount(const Lane lane) const
+{
+    const QueueHandle_t queueHandle = (lane == LANE_PRIORITY) ? m_PriorityQueueHandle : m_NormalQueueHandle;
+    return queueHandle ? uxQueueMessagesWaiting(queueHandle) : 0;
+}
+
+} // IrrigationSystem
+
+// EOF
@@ -0,0 +1,78 @@
+#ifndef HTTPD_WORKER_POOL_H_
+#define HTTPD_WORKER_POOL_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include <soc/soc.h>
+#include <esp_http_server.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+#include <cstdint>
+#include <memory>
+
+#include "task.h"
+
+namespace IrrigationSystem {
+
+/// Runs httpd requests on worker tasks (httpd_req_async_handler_begin) so a slow handler does not block the server task.
+/// The priority lane has its own worker that never takes the normal lane work
+class HttpdWorkerPool final
+{
+public:
+    enum Lane : int {
+        LANE_NORMAL,
+        LANE_PRIORITY,
+    };
+
+    /// Called on the worker with the async copy of the request (queueMicrosecond: time spent in the queue)
+    using Runner = void (*)(httpd_req_t *pHttpRequestData, void *pContext, const std::uint32_t queueMicrosecond);
+
+    static constexpr std::size_t NORMAL_WORKER_COUNT = CONFIG_HTTPD_WORKER_COUNT;
+    static constexpr std::size_t PRIORITY_WORKER_COUNT = 1;
+    static constexpr std::size_t WORKER_COUNT = NORMAL_WORKER_COUNT + PRIORITY_WORKER_COUNT;
+
+private:
+    struct Job
+    {
+        httpd_req_t *pHttpRequestData;
+        Runner JobRunner;
+        void *pContext;
+        std::int64_t QueueTime;
+    };
+
+    class WorkerTask final : public Task
+    {
+    public:
+        WorkerTask(const std::string& taskName, const int priority, const QueueHandle_t queueHandle);
+
+        void Update() override;
+
+    private:
+        const QueueHandle_t m_QueueHandle;
+    };
+
+public:
+    HttpdWorkerPool();
+
+    /// Create the queues and start the workers
+    bool Start();
+
+    /// Hand the request over to a worker of the lane.
+    /// false if the lane is full (the request is untouched and must be answered by the caller)
+    bool Submit(httpd_req_t *pHttpRequestData, const Lane lane, const Runner runner, void *const pContext);
+
+    /// Requests waiting in the lane
+    std::uint32_t GetQueuedCount(const Lane lane) const;
+
+private:
+    QueueHandle_t m_NormalQueueHandle;
+    QueueHandle_t m_PriorityQueueHandle;
+    std::unique_ptr<WorkerTask> m_WorkerList[WORKER_COUNT];
+};
+
+} // IrrigationSystem
+
+#endif // HTTPD_WORKER_POOL_H_
+// EOF
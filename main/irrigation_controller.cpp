@@ -15,6 +15,7 @@
 #include "watering_button_task.h"
 #include "gpio_control.h"
 #include "file_system.h"
+#include "json_arena.h"
 #include "version.h"
 
 
@@ -25,13 +26,16 @@ IrrigationController::IrrigationController()
     ,m_ValveTask()
     ,m_ScheduleManager()
     ,m_WeatherForecast()
+    ,m_WeatherForecastTask()
     ,m_WateringSetting()
     ,m_WateringRecord()
+    ,m_StatusSnapshot()
+    ,m_EventStream()
 #if CONFIG_IS_ENABLE_VOLTAGE_CHECK
-    ,m_VoltageCheckTask()
+    ,m_VoltageCheckTask(m_EventStream)
 #endif
 #if CONFIG_IS_ENABLE_WATER_LEVEL_CHECK
-    ,m_WaterLevelChecker()
+    ,m_WaterLevelChecker(m_EventStream)
 #endif
 {}
 
@@ -74,13 +78,11 @@ void IrrigationController::Start()
     // Mount File System
     FileSystem::Mount();
 
+    // cJSON Hooks (before the tasks use cJSON)
+    JsonArena::InstallHooks();
+
     // Read Setting Data
-    std::string rawSettingData;
-    if (WateringSetting::Load(rawSettingData)) {
-        if (!m_WateringSetting.SetSettingData(rawSettingData)) {
-            ESP_LOGE(TAG, "Invlaid Setting data");
-        }
-    } else {
+    if (!m_WateringSetting.LoadFile(WateringSetting::SETTING_FILE_NAME)) {
         ESP_LOGI(TAG, "Failed Load Setting File");
     }
 
@@ -93,6 +95,7 @@ void IrrigationController::Start()
     WateringButtonTask wateringButtonTask(weak_from_this());
     m_ScheduleManager = std::make_shared<ScheduleManager>(weak_from_this());
     m_ValveTask = std::make_unique<ValveTask>(weak_from_this());
+    m_WeatherForecastTask = std::make_unique<WeatherForecastTask>(weak_from_this());
 
     managementTask.Start();
     httpdServerTask.Start();
@@ -102,6 +105,10 @@ void IrrigationController::Start()
         m_ValveTask->Start();
     }
 
+    if (m_WeatherForecastTask) {
+        m_WeatherForecastTask->Start();
+    }
+
 #if CONFIG_IS_ENABLE_VOLTAGE_CHECK
     m_VoltageCheckTask.Start();
 #endif
@@ -160,6 +167,29 @@ WeatherForecast& IrrigationController::GetWeatherForecast()
     return m_WeatherForecast;
 }
 
+void IrrigationController::WeatherForecastFetch(const std::int32_t areaPathCode, const std::int32_t localCode, const std::int32_t AMeDASPoint, const std::time_t retryDeadlineEpoch)
+{
+    if (m_WeatherForecastTask) {
+        m_WeatherForecastTask->RequestFetch(areaPathCode, localCode, AMeDASPoint, retryDeadlineEpoch);
+    }
+}
+
+bool IrrigationController::WeatherForecastIsFetchComplete() const
+{
+    if (m_WeatherForecastTask) {
+        return m_WeatherForecastTask->IsFetchComplete();
+    }
+    return true;
+}
+
+WeatherForecastFetchStatistics IrrigationController::GetWeatherForecastFetchStatistics() const
+{
+    if (m_WeatherForecastTask) {
+        return m_WeatherForecastTask->GetFetchStatistics();
+    }
+    return WeatherForecastFetchStatistics();
+}
+
 WateringSetting& IrrigationController::GetWateringSetting()
 {
     return m_WateringSetting;
@@ -174,6 +204,7 @@ void IrrigationController::SaveLastWateringEpoch(const std::time_t wateringEpoch
 {
     m_WateringRecord.SetLastWateringEpoch(wateringEpoch);
     m_WateringRecord.Save();
+    m_StatusSnapshot.Invalidate();
 }
 
 std::time_t IrrigationController::GetLastWateringEpoch() const
@@ -190,6 +221,17 @@ float IrrigationController::GetMainVoltage() const
 #endif
 }
 
+VoltageSample IrrigationController::GetMainVoltageSample()
+{
+#if CONFIG_IS_ENABLE_VOLTAGE_CHECK
+    return m_VoltageCheckTask.GetSample();
+#else
+    VoltageSample sample = {};
+    sample.AgeMillisecond = -1;
+    return sample;
+#endif
+}
+
 void IrrigationController::CheckWaterLevel()
 {
 #if CONFIG_IS_ENABLE_WATER_LEVEL_CHECK
@@ -206,6 +248,16 @@ float IrrigationController::GetWaterLevel() const
 #endif
 }
 
+StatusSnapshot& IrrigationController::GetStatusSnapshot()
+{
+    return m_StatusSnapshot;
+}
+
+EventStream& IrrigationController::GetEventStream()
+{
+    return m_EventStream;
+}
+
 } // IrrigationSystem
 
 // EOF
@@ -10,11 +10,14 @@
 #include "wifi_manager.h"
 #include "schedule_manager.h"
 #include "weather_forecast.h"
+#include "weather_forecast_task.h"
 #include "watering_setting.h"
 #include "watering_record.h"
 #include "voltage_check_task.h"
 #include "water_level_checker.h"
 #include "valve_task.h"
+#include "status_snapshot.h"
+#include "event_stream.h"
 
 namespace IrrigationSystem {
 
@@ -49,6 +52,15 @@ public:
     /// (IrrigationInterface:override)
     WeatherForecast& GetWeatherForecast() override;
 
+    /// (IrrigationInterface:override)
+    void WeatherForecastFetch(const std::int32_t areaPathCode, const std::int32_t localCode, const std::int32_t AMeDASPoint, const std::time_t retryDeadlineEpoch) override;
+
+    /// (IrrigationInterface:override)
+    bool WeatherForecastIsFetchComplete() const override;
+
+    /// (IrrigationInterface:override)
+    WeatherForecastFetchStatistics GetWeatherForecastFetchStatistics() const override;
+
     /// (IrrigationInterface:override)
     WateringSetting& GetWateringSetting() override;
 
@@ -64,19 +76,31 @@ public:
     /// (IrrigationInterface:override)
     float GetMainVoltage() const override;
 
+    /// (IrrigationInterface:override)
+    VoltageSample GetMainVoltageSample() override;
+
     /// (IrrigationInterface:override)
     void CheckWaterLevel() override;
 
     /// (IrrigationInterface:override)
     float GetWaterLevel() const override;
 
+    /// (IrrigationInterface:override)
+    StatusSnapshot& GetStatusSnapshot() override;
+
+    /// (IrrigationInterface:override)
+    EventStream& GetEventStream() override;
+
 private:
     WifiManager m_WifiManager;
     ValveTaskUniquePtr m_ValveTask;
     ScheduleManagerSharedPtr m_ScheduleManager;
     WeatherForecast m_WeatherForecast;
+    WeatherForecastTaskUniquePtr m_WeatherForecastTask;
     WateringSetting m_WateringSetting;
     WateringRecord m_WateringRecord;
+    StatusSnapshot m_StatusSnapshot;
+    EventStream m_EventStream;
 
 #if CONFIG_IS_ENABLE_VOLTAGE_CHECK
     VoltageCheckTask m_VoltageCheckTask;
@@ -5,6 +5,7 @@
 
 // Include ----------------------
 #include <chrono>
+#include <cstdint>
 #include <memory>
 
 namespace IrrigationSystem {
@@ -12,7 +13,11 @@ namespace IrrigationSystem {
 class ScheduleManager;
 using ScheduleManagerWeakPtr = std::weak_ptr<ScheduleManager>;
 class WeatherForecast;
+struct WeatherForecastFetchStatistics;
+struct VoltageSample;
 class WateringSetting;
+class StatusSnapshot;
+class EventStream;
 
 class IrrigationInterface
 {
@@ -26,13 +31,19 @@ public:
 
     virtual const ScheduleManagerWeakPtr GetScheduleManager() = 0;
     virtual WeatherForecast& GetWeatherForecast() = 0;
+    virtual void WeatherForecastFetch(const std::int32_t areaPathCode, const std::int32_t localCode, const std::int32_t AMeDASPoint, const std::time_t retryDeadlineEpoch) = 0;
+    virtual bool WeatherForecastIsFetchComplete() const = 0;
+    virtual WeatherForecastFetchStatistics GetWeatherForecastFetchStatistics() const = 0;
     virtual WateringSetting& GetWateringSetting() = 0;
     virtual const WateringSetting& GetWateringSetting() const = 0;
     virtual void SaveLastWateringEpoch(const std::time_t wateringEpoch) = 0;
     virtual std::time_t GetLastWateringEpoch() const = 0;
     virtual float GetMainVoltage() const = 0;
+    virtual VoltageSample GetMainVoltageSample() = 0;
     virtual void CheckWaterLevel() = 0;
     virtual float GetWaterLevel() const = 0;
+    virtual StatusSnapshot& GetStatusSnapshot() = 0;
+    virtual EventStream& GetEventStream() = 0;
 };
 
 using IrrigationInterfaceSharedPtr = std::shared_ptr<IrrigationInterface>;
@@ -0,0 +1,153 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include "json_arena.h"
+
+#include <cstdlib>
+#include <algorithm>
+
+#include <esp_timer.h>
+#include <cJSON.h>
+
+#include "logger.h"
+
+namespace {
+    constexpr std::size_t ALIGNMENT = alignof(std::max_align_t);
+
+    constexpr std::size_t AlignUp(const std::size_t size)
+    {
+        return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+}
+
+namespace IrrigationSystem {
+
+std::mutex JsonArena::s_Mutex;
+std::atomic<TaskHandle_t> JsonArena::s_OwnerTask(nullptr);
+JsonArena* JsonArena::s_pCurrent = nullptr;
+JsonArena::Statistics JsonArena::s_Statistics = {};
+
+JsonArena::JsonArena(const char *const name, const std::size_t sizeHint)
+    :m_Lock(s_Mutex)
+    ,m_Name(name)
+    ,m_pBlock(nullptr)
+    ,m_PeakBytes(0)
+    ,m_ReservedBytes(0)
+    ,m_BlockCount(0)
+    ,m_BeginTime(esp_timer_get_time())
+{
+    // One block for the whole DOM if possible
+    if (sizeHint <= CONFIG_JSON_ARENA_BLOCK_SIZE || !AddBlock(sizeHint)) {
+        AddBlock(CONFIG_JSON_ARENA_BLOCK_SIZE);
+    }
+
+    InstallHooks();
+    s_pCurrent = this;
+    s_OwnerTask.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+}
+
+JsonArena::~JsonArena()
+{
+    // Back to malloc/free
+    s_OwnerTask.store(nullptr, std::memory_order_release);
+    s_pCurrent = nullptr;
+
+    while (m_pBlock) {
+        Block *const pNext = m_pBlock->pNext;
+        std::free(m_pBlock);
+        m_pBlock = pNext;
+    }
+
+    const std::uint32_t elapsed = static_cast<std::uint32_t>(esp_timer_get_time() - m_BeginTime);
+    ++s_Statistics.ParseCount;
+    s_Statistics.LastPeakBytes = static_cast<std::uint32_t>(m_PeakBytes);
+    s_Statistics.LastReservedBytes = static_cast<std::uint32_t>(m_ReservedBytes);
+    s_Statistics.MaxPeakBytes = std::max(s_Statistics.MaxPeakBytes, s_Statistics.LastPeakBytes);
+    s_Statistics.LastElapsedMicrosecond = elapsed;
+    ESP_LOGI(TAG, "JsonArena %s peak:%u bytes reserved:%u bytes blocks:%u elapsed:%uus",
+        m_Name, static_cast<unsigned int>(m_PeakBytes), static_cast<unsigned int>(m_ReservedBytes),
+        static_cast<unsigned int>(m_BlockCount), elapsed);
+}
+
+void JsonArena::InstallHooks()
+{
+    static std::once_flag s_HookFlag;
+    std::call_once(s_HookFlag, []() {
+        cJSON_Hooks hooks = {};
+        hooks.malloc_fn = HookMalloc;
+        hooks.free_fn = HookFree;
+        cJSON_InitHooks(&hooks);
+    });
+}
+
+JsonArena::Statistics JsonArena::GetStatistics()
+{
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    return s_Statistics;
+}
+
+void* JsonArena::Allocate(const std::size_t size)
+{
+    const std::size_t alignedSize = AlignUp(size);
+    if (!m_pBlock || m_pBlock->Size - m_pBlock->Used < alignedSize) {
+        if (!AddBlock(std::max<std::size_t>(alignedSize, CONFIG_JSON_ARENA_BLOCK_SIZE))) {
+            return nullptr;
+        }
+    }
+
+    std::uint8_t *const pData = reinterpret_cast<std::uint8_t*>(m_pBlock) + AlignUp(sizeof(Block)) + m_pBlock->Used;
+    m_pBlock->Used += alignedSize;
+    m_PeakBytes += alignedSize;
+    return pData;
+}
+
+bool JsonArena::IsOwned(const void *const pData) const
+{
+    const std::uint8_t *const pByte = static_cast<const std::uint8_t*>(pData);
+    for (const Block* pBlock = m_pBlock; pBlock; pBlock = pBlock->pNext) {
+        const std::uint8_t *const pBegin = reinterpret_cast<const std::uint8_t*>(pBlock) + AlignUp(sizeof(Block));
+        if (pBegin <= pByte && pByte < pBegin + pBlock->Size) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool JsonArena::AddBlock(const std::size_t size)
+{
+    const std::size_t dataSize = AlignUp(size);
+    Block *const pBlock = static_cast<Block*>(std::malloc(AlignUp(sizeof(Block)) + dataSize));
+    if (!pBlock) {
+        ESP_LOGW(TAG, "JsonArena %s failed to allocate %u bytes", m_Name, static_cast<unsigned int>(dataSize));
+        return false;
+    }
+    pBlock->pNext = m_pBlock;
+    pBlock->Size = dataSize;
+    pBlock->Used = 0;
+    m_pBlock = pBlock;
+    m_ReservedBytes += dataSize;
+    ++m_BlockCount;
+    return true;
+}
+
+void* JsonArena::HookMalloc(std::size_t size)
+{
+    if (s_OwnerTask.load(std::memory_order_acquire) != xTaskGetCurrentTaskHandle()) {
+        return std::malloc(size);
+    }
+    return s_pCurrent->Allocate(size);
+}
+
+void JsonArena::HookFree(void* pData)
+{
+    // Arena data is released with the arena. Others were allocated by malloc
+    if (s_OwnerTask.load(std::memory_order_acquire) == xTaskGetCurrentTaskHandle() && s_pCurrent->IsOwned(pData)) {
+        return;
+    }
+    std::free(pData);
+}
+
+} // IrrigationSystem
+
+// EOF
@@ -0,0 +1,99 @@
+#ifndef JSON_ARENA_H_
+#define JSON_ARENA_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// Bump allocator for the cJSON DOM
+
+// Include ----------------------
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace IrrigationSystem {
+
+/// cJSON arena
+/// While an instance is alive, cJSON on the task that created it allocates from a few large
+/// blocks and free is a no-op. The whole DOM is released at once when the instance is destroyed,
+/// so parsing leaves no small holes in the heap.
+/// The DOM must not be used (or cJSON_Delete'd) after the arena is destroyed.
+/// The cJSON hooks are installed once (InstallHooks) and are never changed afterwards.
+/// cJSON on other tasks keeps using malloc/free. Only one arena exists at a time (other parses wait).
+class JsonArena final
+{
+public:
+    /// Expected DOM size per json text byte (sizeHint)
+    static constexpr std::size_t DOM_SIZE_RATE = 2;
+
+    /// Arena usage
+    struct Statistics
+    {
+        /// Number of arenas (parses)
+        std::uint32_t ParseCount;
+        /// Bytes allocated by cJSON in the last parse (high-water mark)
+        std::uint32_t LastPeakBytes;
+        /// Reserved block bytes of the last parse
+        std::uint32_t LastReservedBytes;
+        /// Largest high-water mark
+        std::uint32_t MaxPeakBytes;
+        /// Lifetime of the last arena (parse time)
+        std::uint32_t LastElapsedMicrosecond;
+    };
+
+private:
+    struct Block
+    {
+        Block* pNext;
+        std::size_t Size;
+        std::size_t Used;
+    };
+
+public:
+    /// name is used for the log. sizeHint is the expected DOM size (e.g. from the body length)
+    JsonArena(const char *const name, const std::size_t sizeHint);
+    ~JsonArena();
+
+    JsonArena(const JsonArena&) = delete;
+    JsonArena& operator=(const JsonArena&) = delete;
+
+    /// Install the cJSON hooks. Call at boot before other tasks use cJSON (also called by the first arena)
+    static void InstallHooks();
+
+    static Statistics GetStatistics();
+
+private:
+    void* Allocate(const std::size_t size);
+
+    /// The data is in a block of this arena
+    bool IsOwned(const void *const pData) const;
+
+    /// Add a block with at least the given data size
+    bool AddBlock(const std::size_t size);
+
+    /// (cJSON_Hooks)
+    static void* HookMalloc(std::size_t size);
+    static void HookFree(void* pData);
+
+private:
+    static std::mutex s_Mutex;
+    /// Task of the current arena. s_pCurrent is only used by that task
+    static std::atomic<TaskHandle_t> s_OwnerTask;
+    static JsonArena* s_pCurrent;
+    static Statistics s_Statistics;
+
+    std::unique_lock<std::mutex> m_Lock;
+    const char *const m_Name;
+    Block* m_pBlock;
+    std::size_t m_PeakBytes;
+    std::size_t m_ReservedBytes;
+    std::size_t m_BlockCount;
+    std::int64_t m_BeginTime;
+};
+
+} // IrrigationSystem
+
+#endif // JSON_ARENA_H_
+// EOF
@@ -0,0 +1,30 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include "json_sink.h"
+
+namespace IrrigationSystem {
+
+JsonFileSink::JsonFileSink()
+    :m_File()
+{}
+
+bool JsonFileSink::Open(const std::string& filePath)
+{
+    return m_File.Open(filePath, "wb");
+}
+
+bool JsonFileSink::Write(const char *const pData, const std::size_t length)
+{
+    return m_File.IsOpen() && m_File.Write(pData, length);
+}
+
+bool JsonFileSink::Close()
+{
+    return m_File.Close();
+}
+
+} // IrrigationSystem
+
+// EOF
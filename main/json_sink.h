@@ -0,0 +1,39 @@
+#ifndef JSON_SINK_H_
+#define JSON_SINK_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// JsonWriter destinations on the device
+
+// Include ----------------------
+#include <cstddef>
+#include <string>
+
+#include "json_writer.h"
+#include "file_system.h"
+
+namespace IrrigationSystem {
+
+/// File on the FileSystem (constant memory)
+/// The http response is HtmlChunkWriter (httpd_resp_send_chunk)
+class JsonFileSink final : public JsonSink
+{
+public:
+    JsonFileSink();
+
+    /// Create (truncate) the file
+    bool Open(const std::string& filePath);
+
+    /// (JsonSink:override)
+    bool Write(const char *const pData, const std::size_t length) override;
+
+    /// Close the file. Return false when the rest of the data could not be written
+    bool Close();
+
+private:
+    FileSystem::File m_File;
+};
+
+} // IrrigationSystem
+
+#endif // JSON_SINK_H_
+// EOF
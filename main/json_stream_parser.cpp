@@ -0,0 +1,382 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// Incremental (event driven) JSON parser with fixed size buffers
+
+// Include ----------------------
+#include "json_stream_parser.h"
+
+#include <cstring>
+
+namespace IrrigationSystem {
+
+JsonStreamParser::JsonStreamParser(Listener& listener)
+    :m_Listener(listener)
+    ,m_State(STATE_VALUE)
+    ,m_IsKeyString(false)
+    ,m_IsTruncated(false)
+    ,m_UnicodeDigits(0)
+    ,m_UnicodeValue(0)
+    ,m_Depth(0)
+    ,m_Path()
+    ,m_TokenLength(0)
+    ,m_Token()
+{}
+
+bool JsonStreamParser::Feed(const char *const pData, const std::size_t length)
+{
+    for (std::size_t i = 0; i < length; ++i) {
+        if (!Process(pData[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool JsonStreamParser::Finish()
+{
+    // A number at the root level has no terminator
+    if (m_State == STATE_NUMBER && m_Depth == 0) {
+        m_Listener.OnValue(*this, VALUE_NUMBER, m_Token);
+        EndValue();
+    }
+    if (m_State != STATE_DONE) {
+        m_State = STATE_ERROR;
+    }
+    return m_State == STATE_DONE;
+}
+
+bool JsonStreamParser::IsError() const
+{
+    return m_State == STATE_ERROR;
+}
+
+bool JsonStreamParser::IsComplete() const
+{
+    return m_State == STATE_DONE;
+}
+
+bool JsonStreamParser::IsTruncated() const
+{
+    return m_IsTruncated;
+}
+
+std::size_t JsonStreamParser::GetDepth() const
+{
+    return m_Depth;
+}
+
+const JsonStreamParser::PathItem& JsonStreamParser::GetPathItem(const std::size_t depth) const
+{
+    return m_Path[depth];
+}
+
+bool JsonStreamParser::IsKey(const std::size_t depth, const char *const pKey) const
+{
+    return depth < m_Depth &&
+           m_Path[depth].Type == CONTAINER_OBJECT &&
+           std::strcmp(m_Path[depth].Key, pKey) == 0;
+}
+
+bool JsonStreamParser::IsIndex(const std::size_t depth, const std::int32_t index) const
+{
+    return GetIndex(depth) == index;
+}
+
+std::int32_t JsonStreamParser::GetIndex(const std::size_t depth) const
+{
+    if (m_Depth <= depth || m_Path[depth].Type != CONTAINER_ARRAY) {
+        return -1;
+    }
+    return m_Path[depth].Index;
+}
+
+bool JsonStreamParser::Process(const char c)
+{
+    switch (m_State) {
+    case STATE_VALUE:
+        if (IsWhitespace(c)) {
+            return true;
+        }
+        return BeginValue(c);
+
+    case STATE_VALUE_OR_END:
+        if (IsWhitespace(c)) {
+            return true;
+        }
+        if (c == ']') {
+            return EndContainer(CONTAINER_ARRAY);
+        }
+        return BeginValue(c);
+
+    case STATE_KEY_OR_END:
+        if (IsWhitespace(c)) {
+            return true;
+        }
+        if (c == '}') {
+            return EndContainer(CONTAINER_OBJECT);
+        }
+        // fall through
+    case STATE_KEY:
+        if (IsWhitespace(c)) {
+            return true;
+        }
+        if (c != '"') {
+            break;
+        }
+        m_TokenLength = 0;
+        m_Token[0] = '\0';
+        m_IsTruncated = false;
+        m_IsKeyString = true;
+        m_State = STATE_STRING;
+        return true;
+
+    case STATE_COLON:
+        if (IsWhitespace(c)) {
+            return true;
+        }
+        if (c != ':') {
+            break;
+        }
+        m_State = STATE_VALUE;
+        return true;
+
+    case STATE_COMMA_OR_END:
+        if (IsWhitespace(c)) {
+            return true;
+        }
+        if (c == ',') {
+            PathItem& pathItem = m_Path[m_Depth - 1];
+            if (pathItem.Type == CONTAINER_ARRAY) {
+                ++pathItem.Index;
+                m_State = STATE_VALUE;
+            } else {
+                pathItem.Key[0] = '\0';
+                m_State = STATE_KEY;
+            }
+            return true;
+        } else if (c == ']') {
+            return EndContainer(CONTAINER_ARRAY);
+        } else if (c == '}') {
+            return EndContainer(CONTAINER_OBJECT);
+        }
+        break;
+
+    case STATE_STRING:
+        if (c == '"') {
+            EndString();
+            return true;
+        } else if (c == '\\') {
+            m_State = STATE_STRING_ESCAPE;
+            return true;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            break;
+        }
+        AppendToken(c);
+        return true;
+
+    case STATE_STRING_ESCAPE:
+        m_State = STATE_STRING;
+        switch (c) {
+        case '"':  AppendToken('"');  return true;
+        case '\\': AppendToken('\\'); return true;
+        case '/':  AppendToken('/');  return true;
+        case 'b':  AppendToken('\b'); return true;
+        case 'f':  AppendToken('\f'); return true;
+        case 'n':  AppendToken('\n'); return true;
+        case 'r':  AppendToken('\r'); return true;
+        case 't':  AppendToken('\t'); return true;
+        case 'u':
+            m_UnicodeDigits = 0;
+            m_UnicodeValue = 0;
+            m_State = STATE_STRING_UNICODE;
+            return true;
+        default:
+            break;
+        }
+        break;
+
+    case STATE_STRING_UNICODE:
+        {
+            std::uint32_t digit = 0;
+            if ('0' <= c && c <= '9') {
+                digit = c - '0';
+            } else if ('a' <= c && c <= 'f') {
+                digit = c - 'a' + 10;
+            } else if ('A' <= c && c <= 'F') {
+                digit = c - 'A' + 10;
+            } else {
+                break;
+            }
+            m_UnicodeValue = (m_UnicodeValue << 4) | digit;
+            if (++m_UnicodeDigits == 4) {
+                AppendUnicode(m_UnicodeValue);
+                m_State = STATE_STRING;
+            }
+            return true;
+        }
+
+    case STATE_NUMBER:
+        if (('0' <= c && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E') {
+            AppendToken(c);
+            return true;
+        }
+        m_Listener.OnValue(*this, VALUE_NUMBER, m_Token);
+        EndValue();
+        // The terminator belongs to the next token
+        return Process(c);
+
+    case STATE_LITERAL:
+        if ('a' <= c && c <= 'z') {
+            AppendToken(c);
+            return true;
+        }
+        if (!EndLiteral()) {
+            break;
+        }
+        return Process(c);
+
+    case STATE_DONE:
+        if (IsWhitespace(c)) {
+            return true;
+        }
+        break;
+
+    case STATE_ERROR:
+    default:
+        break;
+    }
+
+    m_State = STATE_ERROR;
+    return false;
+}
+
+bool JsonStreamParser::BeginValue(const char c)
+{
+    if (c == '{') {
+        return BeginContainer(CONTAINER_OBJECT);
+    } else if (c == '[') {
+        return BeginContainer(CONTAINER_ARRAY);
+    }
+
+    m_TokenLength = 0;
+    m_Token[0] = '\0';
+    m_IsTruncated = false;
+    if (c == '"') {
+        m_IsKeyString = false;
+        m_State = STATE_STRING;
+    } else if (c == '-' || ('0' <= c && c <= '9')) {
+        AppendToken(c);
+        m_State = STATE_NUMBER;
+    } else if (c == 't' || c == 'f' || c == 'n') {
+        AppendToken(c);
+        m_State = STATE_LITERAL;
+    } else {
+        m_State = STATE_ERROR;
+        return false;
+    }
+    return true;
+}
+
+bool JsonStreamParser::BeginContainer(const ContainerType type)
+{
+    if (MAX_DEPTH <= m_Depth) {
+        m_State = STATE_ERROR;
+        return false;
+    }
+
+    m_Listener.OnBeginContainer(*this, type);
+
+    PathItem& pathItem = m_Path[m_Depth];
+    pathItem.Type = type;
+    pathItem.Key[0] = '\0';
+    pathItem.Index = 0;
+    ++m_Depth;
+
+    m_State = (type == CONTAINER_OBJECT) ? STATE_KEY_OR_END : STATE_VALUE_OR_END;
+    return true;
+}
+
+bool JsonStreamParser::EndContainer(const ContainerType type)
+{
+    if (m_Depth == 0 || m_Path[m_Depth - 1].Type != type) {
+        m_State = STATE_ERROR;
+        return false;
+    }
+    --m_Depth;
+
+    m_Listener.OnEndContainer(*this, type);
+    EndValue();
+    return true;
+}
+
+void JsonStreamParser::EndValue()
+{
+    m_State = (m_Depth == 0) ? STATE_DONE : STATE_COMMA_OR_END;
+}
+
+bool JsonStreamParser::EndLiteral()
+{
+    ValueType type = VALUE_NULL;
+    if (std::strcmp(m_Token, "true") == 0) {
+        type = VALUE_TRUE;
+    } else if (std::strcmp(m_Token, "false") == 0) {
+        type = VALUE_FALSE;
+    } else if (std::strcmp(m_Token, "null") == 0) {
+        type = VALUE_NULL;
+    } else {
+        return false;
+    }
+    m_Listener.OnValue(*this, type, m_Token);
+    EndValue();
+    return true;
+}
+
+void JsonStreamParser::EndString()
+{
+    if (m_IsKeyString) {
+        PathItem& pathItem = m_Path[m_Depth - 1];
+        const std::size_t keyLength = (m_TokenLength < MAX_KEY_LENGTH) ? m_TokenLength : MAX_KEY_LENGTH;
+        std::memcpy(pathItem.Key, m_Token, keyLength);
+        pathItem.Key[keyLength] = '\0';
+        m_State = STATE_COLON;
+        return;
+    }
+
+    m_Listener.OnValue(*this, VALUE_STRING, m_Token);
+    EndValue();
+}
+
+void JsonStreamParser::AppendToken(const char c)
+{
+    if (MAX_VALUE_LENGTH <= m_TokenLength) {
+        // Truncate
+        m_IsTruncated = true;
+        return;
+    }
+    m_Token[m_TokenLength++] = c;
+    m_Token[m_TokenLength] = '\0';
+}
+
+void JsonStreamParser::AppendUnicode(const std::uint32_t codePoint)
+{
+    // UTF-16 code unit to UTF-8 (surrogate pairs are stored as is)
+    if (codePoint < 0x80) {
+        AppendToken(static_cast<char>(codePoint));
+    } else if (codePoint < 0x800) {
+        AppendToken(static_cast<char>(0xC0 | (codePoint >> 6)));
+        AppendToken(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    } else {
+        AppendToken(static_cast<char>(0xE0 | (codePoint >> 12)));
+        AppendToken(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+        AppendToken(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    }
+}
+
+bool JsonStreamParser::IsWhitespace(const char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+} // IrrigationSystem
+
+// EOF
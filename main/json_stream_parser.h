@@ -0,0 +1,139 @@
+#ifndef JSON_STREAM_PARSER_H_
+#define JSON_STREAM_PARSER_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// Incremental (event driven) JSON parser with fixed size buffers
+
+// Include ----------------------
+#include <cstddef>
+#include <cstdint>
+
+namespace IrrigationSystem {
+
+/// Incremental JSON Parser
+/// The document is fed in arbitrary chunks and reported to the listener as events.
+/// No heap is used. Keys and values longer than the fixed buffers are truncated.
+class JsonStreamParser final
+{
+public:
+    static constexpr std::size_t MAX_DEPTH = 12;
+    static constexpr std::size_t MAX_KEY_LENGTH = 31;
+    static constexpr std::size_t MAX_VALUE_LENGTH = 47;
+
+    enum ContainerType : std::uint8_t {
+        CONTAINER_OBJECT,
+        CONTAINER_ARRAY,
+    };
+
+    enum ValueType : std::uint8_t {
+        VALUE_STRING,
+        VALUE_NUMBER,
+        VALUE_TRUE,
+        VALUE_FALSE,
+        VALUE_NULL,
+    };
+
+    /// Location of the current element in one container
+    struct PathItem
+    {
+        ContainerType Type;
+        /// Member key (CONTAINER_OBJECT)
+        char Key[MAX_KEY_LENGTH + 1];
+        /// Element index (CONTAINER_ARRAY)
+        std::int32_t Index;
+    };
+
+    /// Parse Event Listener
+    class Listener
+    {
+    public:
+        virtual ~Listener() {}
+
+        /// Begin object or array. (The path points to the location of the container)
+        virtual void OnBeginContainer(const JsonStreamParser& parser, const ContainerType type) {}
+
+        /// End object or array. (The path points to the location of the container)
+        virtual void OnEndContainer(const JsonStreamParser& parser, const ContainerType type) {}
+
+        /// Scalar value. (The path points to the location of the value)
+        virtual void OnValue(const JsonStreamParser& parser, const ValueType type, const char *const pValue) {}
+    };
+
+public:
+    explicit JsonStreamParser(Listener& listener);
+
+    /// Feed a part of the document
+    bool Feed(const char *const pData, const std::size_t length);
+
+    /// Notify the end of the document
+    bool Finish();
+
+    bool IsError() const;
+    bool IsComplete() const;
+
+    /// The value of OnValue was longer than MAX_VALUE_LENGTH and has been truncated
+    bool IsTruncated() const;
+
+    /// Number of open containers
+    std::size_t GetDepth() const;
+
+    /// Path item of the open container (0:root)
+    const PathItem& GetPathItem(const std::size_t depth) const;
+
+    /// The path item at depth is an object member named key
+    bool IsKey(const std::size_t depth, const char *const pKey) const;
+
+    /// The path item at depth is an array element at index
+    bool IsIndex(const std::size_t depth, const std::int32_t index) const;
+
+    /// Index of the array element at depth (-1 if it is not an array)
+    std::int32_t GetIndex(const std::size_t depth) const;
+
+private:
+    enum State : std::uint8_t {
+        STATE_VALUE,
+        STATE_VALUE_OR_END,
+        STATE_KEY,
+        STATE_KEY_OR_END,
+        STATE_COLON,
+        STATE_COMMA_OR_END,
+        STATE_STRING,
+        STATE_STRING_ESCAPE,
+        STATE_STRING_UNICODE,
+        STATE_NUMBER,
+        STATE_LITERAL,
+        STATE_DONE,
+        STATE_ERROR,
+    };
+
+    bool Process(const char c);
+
+    bool BeginValue(const char c);
+    bool BeginContainer(const ContainerType type);
+    bool EndContainer(const ContainerType type);
+    void EndValue();
+    bool EndLiteral();
+    void EndString();
+
+    void AppendToken(const char c);
+    void AppendUnicode(const std::uint32_t codePoint);
+
+    static bool IsWhitespace(const char c);
+
+private:
+    Listener& m_Listener;
+    State m_State;
+    bool m_IsKeyString;
+    bool m_IsTruncated;
+    std::uint8_t m_UnicodeDigits;
+    std::uint32_t m_UnicodeValue;
+    std::size_t m_Depth;
+    PathItem m_Path[MAX_DEPTH];
+    std::size_t m_TokenLength;
+    char m_Token[MAX_VALUE_LENGTH + 1];
+};
+
+} // IrrigationSystem
+
+#endif // JSON_STREAM_PARSER_H_
+// EOF
@@ -0,0 +1,336 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include "json_writer.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+namespace IrrigationSystem {
+
+namespace {
+
+constexpr char HEX_DIGIT[] = "0123456789abcdef";
+
+/// Short form of the escaped control characters (others are \u00XX)
+char ToShortEscape(const char character)
+{
+    switch (character) {
+    case '"':  return '"';
+    case '\\': return '\\';
+    case '\b': return 'b';
+    case '\f': return 'f';
+    case '\n': return 'n';
+    case '\r': return 'r';
+    case '\t': return 't';
+    default:
+        return '\0';
+    }
+}
+
+} // namespace
+
+JsonBufferSink::JsonBufferSink(char *const pBuffer, const std::size_t size)
+    :m_pBuffer(pBuffer)
+    ,m_Size(size)
+    ,m_Length(0)
+{
+    if (0 < m_Size) {
+        m_pBuffer[0] = '\0';
+    }
+}
+
+bool JsonBufferSink::Write(const char *const pData, const std::size_t length)
+{
+    // Room for the terminator
+    if (m_Size <= m_Length + length) {
+        return false;
+    }
+    std::memcpy(m_pBuffer + m_Length, pData, length);
+    m_Length += length;
+    m_pBuffer[m_Length] = '\0';
+    return true;
+}
+
+const char* JsonBufferSink::GetData() const
+{
+    return m_pBuffer;
+}
+
+std::size_t JsonBufferSink::GetLength() const
+{
+    return m_Length;
+}
+
+std::string_view JsonBufferSink::GetView() const
+{
+    return std::string_view(m_pBuffer, m_Length);
+}
+
+JsonStringSink::JsonStringSink(std::string& body)
+    :m_Body(body)
+{}
+
+bool JsonStringSink::Write(const char *const pData, const std::size_t length)
+{
+    m_Body.append(pData, length);
+    return true;
+}
+
+JsonWriter::JsonWriter(JsonSink& sink)
+    :m_Sink(sink)
+    ,m_Buffer()
+    ,m_Length(0)
+    ,m_TotalBytes(0)
+    ,m_HasValueBits(0)
+    ,m_Depth(0)
+    ,m_IsAfterKey(false)
+    ,m_IsError(false)
+{}
+
+JsonWriter& JsonWriter::BeginObject()
+{
+    return Open('{');
+}
+
+JsonWriter& JsonWriter::EndObject()
+{
+    return Close('}');
+}
+
+JsonWriter& JsonWriter::BeginArray()
+{
+    return Open('[');
+}
+
+JsonWriter& JsonWriter::EndArray()
+{
+    return Close(']');
+}
+
+JsonWriter& JsonWriter::Key(const std::string_view name)
+{
+    BeginValue();
+    AppendChar('"');
+    AppendEscaped(name);
+    Append("\":", 2);
+    m_IsAfterKey = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::String(const std::string_view text)
+{
+    BeginValue();
+    AppendChar('"');
+    AppendEscaped(text);
+    AppendChar('"');
+    return *this;
+}
+
+JsonWriter& JsonWriter::Int(const long long value)
+{
+    BeginValue();
+    if (value < 0) {
+        AppendChar('-');
+        // Negate in unsigned (LLONG_MIN)
+        AppendInteger(0ULL - static_cast<unsigned long long>(value), 0);
+    } else {
+        AppendInteger(static_cast<unsigned long long>(value), 0);
+    }
+    return *this;
+}
+
+JsonWriter& JsonWriter::Bool(const bool value)
+{
+    BeginValue();
+    if (value) {
+        Append("true", 4);
+    } else {
+        Append("false", 5);
+    }
+    return *this;
+}
+
+JsonWriter& JsonWriter::Null()
+{
+    BeginValue();
+    Append("null", 4);
+    return *this;
+}
+
+JsonWriter& JsonWriter::Scaled(const long long value, const int precision)
+{
+    if (precision <= 0) {
+        return Int(value);
+    }
+    unsigned long long scale = 1;
+    for (int i = 0; i < precision; ++i) {
+        scale *= 10;
+    }
+    BeginValue();
+    const unsigned long long absolute = (value < 0) ? 0ULL - static_cast<unsigned long long>(value) : static_cast<unsigned long long>(value);
+    if (value < 0) {
+        AppendChar('-');
+    }
+    AppendInteger(absolute / scale, 0);
+    AppendChar('.');
+    AppendInteger(absolute % scale, precision);
+    return *this;
+}
+
+JsonWriter& JsonWriter::Fixed(const float value, const int precision)
+{
+    if (!std::isfinite(value)) {
+        return Null();
+    }
+    float scale = 1.0f;
+    for (int i = 0; i < precision; ++i) {
+        scale *= 10.0f;
+    }
+    // Negative zero is written as 0.00
+    return Scaled(std::llround(value * scale), precision);
+}
+
+bool JsonWriter::Flush()
+{
+    if (m_IsError) {
+        return false;
+    }
+    if (m_Length == 0) {
+        return true;
+    }
+    if (!m_Sink.Write(m_Buffer, m_Length)) {
+        m_IsError = true;
+        m_Length = 0;
+        return false;
+    }
+    m_TotalBytes += m_Length;
+    m_Length = 0;
+    return true;
+}
+
+bool JsonWriter::Finish()
+{
+    return Flush() && m_Depth == 0 && !m_IsAfterKey;
+}
+
+bool JsonWriter::IsError() const
+{
+    return m_IsError;
+}
+
+std::size_t JsonWriter::GetTotalBytes() const
+{
+    return m_TotalBytes;
+}
+
+void JsonWriter::BeginValue()
+{
+    if (m_IsAfterKey) {
+        m_IsAfterKey = false;
+        return;
+    }
+    if (m_Depth == 0) {
+        return;
+    }
+    const std::uint32_t bit = 1U << (m_Depth - 1);
+    if (m_HasValueBits & bit) {
+        AppendChar(',');
+    }
+    m_HasValueBits |= bit;
+}
+
+JsonWriter& JsonWriter::Open(const char bracket)
+{
+    BeginValue();
+    if (MAX_DEPTH <= m_Depth) {
+        m_IsError = true;
+        return *this;
+    }
+    AppendChar(bracket);
+    ++m_Depth;
+    m_HasValueBits &= ~(1U << (m_Depth - 1));
+    return *this;
+}
+
+JsonWriter& JsonWriter::Close(const char bracket)
+{
+    if (m_Depth == 0 || m_IsAfterKey) {
+        m_IsError = true;
+        return *this;
+    }
+    --m_Depth;
+    AppendChar(bracket);
+    return *this;
+}
+
+void JsonWriter::Append(const char *const pData, const std::size_t length)
+{
+    std::size_t offset = 0;
+    while (!m_IsError && offset < length) {
+        if (m_Length == BUFFER_SIZE && !Flush()) {
+            return;
+        }
+        const std::size_t copySize = std::min(BUFFER_SIZE - m_Length, length - offset);
+        std::memcpy(m_Buffer + m_Length, pData + offset, copySize);
+        m_Length += copySize;
+        offset += copySize;
+    }
+}
+
+void JsonWriter::AppendChar(const char character)
+{
+    if (m_Length == BUFFER_SIZE && !Flush()) {
+        return;
+    }
+    if (!m_IsError) {
+        m_Buffer[m_Length++] = character;
+    }
+}
+
+void JsonWriter::AppendEscaped(const std::string_view text)
+{
+    // Runs without an escape are copied at once. (UTF-8 is passed as is)
+    std::size_t begin = 0;
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        const char character = text[i];
+        const bool isControl = static_cast<unsigned char>(character) < 0x20;
+        if (!isControl && character != '"' && character != '\\') {
+            continue;
+        }
+        Append(text.data() + begin, i - begin);
+        begin = i + 1;
+
+        const char shortEscape = ToShortEscape(character);
+        if (shortEscape != '\0') {
+            const char escape[] = {'\\', shortEscape};
+            Append(escape, sizeof(escape));
+        } else {
+            const unsigned char code = static_cast<unsigned char>(character);
+            const char escape[] = {'\\', 'u', '0', '0', HEX_DIGIT[code >> 4], HEX_DIGIT[code & 0x0F]};
+            Append(escape, sizeof(escape));
+        }
+    }
+    Append(text.data() + begin, text.size() - begin);
+}
+
+void JsonWriter::AppendInteger(unsigned long long value, const int width)
+{
+    // Digits from the end (printf may allocate)
+    char digits[24];
+    std::size_t position = sizeof(digits);
+    do {
+        digits[--position] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (0 < position && static_cast<int>(sizeof(digits) - position) < width) {
+        digits[--position] = '0';
+    }
+    Append(digits + position, sizeof(digits) - position);
+}
+
+} // IrrigationSystem
+
+// EOF
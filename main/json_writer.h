@@ -0,0 +1,134 @@
+#ifndef JSON_WRITER_H_
+#define JSON_WRITER_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// Streaming json writer
+
+// Include ----------------------
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace IrrigationSystem {
+
+/// Destination of the JsonWriter output
+class JsonSink
+{
+public:
+    virtual ~JsonSink() {}
+
+    /// Called for each part of the document. Return false when it can not be written (the rest is discarded)
+    virtual bool Write(const char *const pData, const std::size_t length) = 0;
+};
+
+/// Caller's fixed buffer (The document fails when it does not fit)
+class JsonBufferSink final : public JsonSink
+{
+public:
+    /// The data is kept null terminated
+    JsonBufferSink(char *const pBuffer, const std::size_t size);
+
+    /// (JsonSink:override)
+    bool Write(const char *const pData, const std::size_t length) override;
+
+    const char* GetData() const;
+    std::size_t GetLength() const;
+    std::string_view GetView() const;
+
+private:
+    char *const m_pBuffer;
+    const std::size_t m_Size;
+    std::size_t m_Length;
+};
+
+/// Appended to the string (The capacity of a reused string is kept)
+class JsonStringSink final : public JsonSink
+{
+public:
+    explicit JsonStringSink(std::string& body);
+
+    /// (JsonSink:override)
+    bool Write(const char *const pData, const std::size_t length) override;
+
+private:
+    std::string& m_Body;
+};
+
+/// Json document writer
+/// Tokens are formatted into a fixed buffer and passed to the sink whenever it fills up.
+/// Strings are escaped and numbers are formatted with integer arithmetic, so a document
+/// needs no heap and its cost only depends on its size. Separators are inserted automatically.
+///   writer.BeginObject().Key("voltage").Fixed(12.3f, 2).EndObject();
+class JsonWriter final
+{
+public:
+    static constexpr std::size_t BUFFER_SIZE = 128;
+    /// Nesting of objects and arrays
+    static constexpr std::size_t MAX_DEPTH = 32;
+
+public:
+    explicit JsonWriter(JsonSink& sink);
+
+    JsonWriter(const JsonWriter&) = delete;
+    JsonWriter& operator=(const JsonWriter&) = delete;
+
+    JsonWriter& BeginObject();
+    JsonWriter& EndObject();
+    JsonWriter& BeginArray();
+    JsonWriter& EndArray();
+
+    /// Member name (The value follows)
+    JsonWriter& Key(const std::string_view name);
+
+    /// Escaped string
+    JsonWriter& String(const std::string_view text);
+    JsonWriter& Int(const long long value);
+    JsonWriter& Bool(const bool value);
+    JsonWriter& Null();
+
+    /// Fixed point number. value / 10^precision (e.g. 1234, 2 -> 12.34)
+    JsonWriter& Scaled(const long long value, const int precision);
+
+    /// Rounded to the precision (e.g. 12.345f, 2 -> 12.35). NaN and infinity are null
+    JsonWriter& Fixed(const float value, const int precision);
+
+    /// Pass the buffered data to the sink
+    bool Flush();
+
+    /// Flush. Return false when the document failed or is not closed
+    bool Finish();
+
+    /// The sink failed, the buffer of the caller overflowed or the nesting is too deep
+    bool IsError() const;
+
+    /// Bytes passed to the sink
+    std::size_t GetTotalBytes() const;
+
+private:
+    /// Separator before a value
+    void BeginValue();
+    JsonWriter& Open(const char bracket);
+    JsonWriter& Close(const char bracket);
+
+    void Append(const char *const pData, const std::size_t length);
+    void AppendChar(const char character);
+    void AppendEscaped(const std::string_view text);
+    void AppendInteger(unsigned long long value, const int width);
+
+private:
+    JsonSink& m_Sink;
+    char m_Buffer[BUFFER_SIZE];
+    std::size_t m_Length;
+    std::size_t m_TotalBytes;
+    /// Bit per depth. A value has been written in the object or the array
+    std::uint32_t m_HasValueBits;
+    std::size_t m_Depth;
+    bool m_IsAfterKey;
+    bool m_IsError;
+};
+
+} // IrrigationSystem
+
+#endif // JSON_WRITER_H_
+// EOF
@@ -0,0 +1,108 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// Fixed bucket latency histogram
+
+// Include ----------------------
+#include "latency_histogram.h"
+
+namespace IrrigationSystem {
+
+namespace {
+
+constexpr std::uint32_t UNBOUNDED = UINT32_MAX;
+
+constexpr std::uint32_t BUCKET_BOUND[LatencyHistogram::BUCKET_COUNT] = {
+    500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, UNBOUNDED,
+};
+
+constexpr const char* BUCKET_LABEL[LatencyHistogram::BUCKET_COUNT] = {
+    "0.0005", "0.001", "0.0025", "0.005", "0.01", "0.025", "0.05", "0.1", "0.25", "0.5", "1", "2.5", "5", "+Inf",
+};
+
+} // namespace
+
+std::uint32_t LatencyHistogram::GetBucketBound(const std::size_t index)
+{
+    return BUCKET_BOUND[index];
+}
+
+const char* LatencyHistogram::GetBucketLabel(const std::size_t index)
+{
+    return BUCKET_LABEL[index];
+}
+
+LatencyHistogram::LatencyHistogram()
+    :m_Bucket()
+    ,m_SumMicrosecond(0)
+{}
+
+void LatencyHistogram::Record(const std::uint32_t microsecond)
+{
+    std::size_t index = 0;
+    while (BUCKET_BOUND[index] < microsecond) {
+        ++index;
+    }
+    m_Bucket[index].fetch_add(1, std::memory_order_relaxed);
+    m_SumMicrosecond.fetch_add(microsecond, std::memory_order_relaxed);
+}
+
+std::uint32_t LatencyHistogram::GetCount() const
+{
+    std::uint32_t count = 0;
+    for (const std::atomic<std::uint32_t>& bucket : m_Bucket) {
+        count += bucket.load(std::memory_order_relaxed);
+    }
+    return count;
+}
+
+std::uint32_t LatencyHistogram::GetBucketCount(const std::size_t index) const
+{
+    return m_Bucket[index].load(std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::GetSumMicrosecond() const
+{
+    return m_SumMicrosecond.load(std::memory_order_relaxed);
+}
+
+std::uint32_t LatencyHistogram::GetQuantileMicrosecond(const std::uint32_t percent) const
+{
+    std::uint32_t bucketCount[BUCKET_COUNT];
+    std::uint32_t count = 0;
+    for (std::size_t i = 0; i < BUCKET_COUNT; ++i) {
+        bucketCount[i] = m_Bucket[i].load(std::memory_order_relaxed);
+        count += bucketCount[i];
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    // Rank of the quantile (1 origin)
+    static constexpr std::uint64_t PERCENT = 100;
+    const std::uint32_t rank = static_cast<std::uint32_t>((static_cast<std::uint64_t>(count) * percent + PERCENT - 1) / PERCENT);
+    std::uint32_t cumulative = 0;
+    for (std::size_t i = 0; i < BUCKET_COUNT; ++i) {
+        if (rank <= cumulative + bucketCount[i]) {
+            const std::uint32_t lower = (i == 0) ? 0 : BUCKET_BOUND[i - 1];
+            if (BUCKET_BOUND[i] == UNBOUNDED) {
+                return lower;
+            }
+            const std::uint64_t width = BUCKET_BOUND[i] - lower;
+            return lower + static_cast<std::uint32_t>(width * (rank - cumulative) / bucketCount[i]);
+        }
+        cumulative += bucketCount[i];
+    }
+    return BUCKET_BOUND[BUCKET_COUNT - 2];
+}
+
+void LatencyHistogram::Reset()
+{
+    for (std::atomic<std::uint32_t>& bucket : m_Bucket) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_SumMicrosecond.store(0, std::memory_order_relaxed);
+}
+
+} // IrrigationSystem
+
+// EOF
@@ -0,0 +1,51 @@
+#ifndef LATENCY_HISTOGRAM_H_
+#define LATENCY_HISTOGRAM_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// Fixed bucket latency histogram
+
+// Include ----------------------
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace IrrigationSystem {
+
+/// Fixed bucket latency histogram
+/// Recording is a bucket search over a constant table and two relaxed atomic additions (no heap).
+class LatencyHistogram final
+{
+public:
+    /// Buckets up to 5 s and the overflow bucket
+    static constexpr std::size_t BUCKET_COUNT = 14;
+
+    /// Upper bound of the bucket (microsecond. The last one is unbounded)
+    static std::uint32_t GetBucketBound(const std::size_t index);
+
+    /// Upper bound of the bucket in seconds for the "le" label
+    static const char* GetBucketLabel(const std::size_t index);
+
+public:
+    LatencyHistogram();
+
+    void Record(const std::uint32_t microsecond);
+
+    std::uint32_t GetCount() const;
+    std::uint32_t GetBucketCount(const std::size_t index) const;
+    std::uint64_t GetSumMicrosecond() const;
+
+    /// Estimated quantile (linear in the bucket. 0 if empty)
+    std::uint32_t GetQuantileMicrosecond(const std::uint32_t percent) const;
+
+    void Reset();
+
+private:
+    std::atomic<std::uint32_t> m_Bucket[BUCKET_COUNT];
+    /// Sum of the recorded values (not rounded, so *_sum stays exact)
+    std::atomic<std::uint64_t> m_SumMicrosecond;
+};
+
+} // IrrigationSystem
+
+#endif // LATENCY_HISTOGRAM_H_
+// EOF
@@ -4,17 +4,29 @@
 // Include ----------------------
 #include "management_task.h"
 
+#include <esp_timer.h>
+
+#include <algorithm>
+
 #include "logger.h"
-#include "util.h"
 #include "irrigation_controller.h"
 #include "http_request.h"
 #include "schedule_manager.h"
 
 namespace IrrigationSystem {
 
+namespace {
+
+constexpr std::int64_t MICRO_TO_MILLI = 1000;
+/// Schedule execution interval
+constexpr std::int64_t EXECUTE_INTERVAL_MICROSECOND = 10 * 1000 * 1000;
+
+} // namespace
+
 ManagementTask::ManagementTask(const IrrigationInterfaceWeakPtr pIrrigationInterface)
     :Task(TASK_NAME, PRIORITY, CORE_ID)
     ,m_pIrrigationInterface(pIrrigationInterface)
+    ,m_NextExecuteTime(0)
 {}
 
 void ManagementTask::Update()
@@ -32,8 +44,19 @@ void ManagementTask::Update()
         return;
     }
 
-    scheduleManager->Execute(); 
-    Util::SleepMillisecond(10 * 1000);
+    const std::int64_t nowTime = esp_timer_get_time();
+    if (m_NextExecuteTime <= nowTime) {
+        scheduleManager->Execute();
+        m_NextExecuteTime = nowTime + EXECUTE_INTERVAL_MICROSECOND;
+    }
+
+    // The status is serialized only here. The handlers send the current document
+    StatusSnapshot& statusSnapshot = irrigationInterface->GetStatusSnapshot();
+    statusSnapshot.Refresh(*irrigationInterface);
+
+    // Next execution, or earlier when the status has been invalidated
+    const std::int64_t waitMillisecond = (m_NextExecuteTime - esp_timer_get_time()) / MICRO_TO_MILLI;
+    statusSnapshot.WaitInvalidate(static_cast<int>(std::max<std::int64_t>(waitMillisecond, 0)));
 }
 
 
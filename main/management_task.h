@@ -7,6 +7,7 @@
 #include <soc/soc.h>
 
 #include <chrono>
+#include <cstdint>
 
 #include "task.h"
 #include "irrigation_interface.h"
@@ -27,6 +28,8 @@ public:
 
 private:
     const IrrigationInterfaceWeakPtr m_pIrrigationInterface;
+    /// esp_timer time of the next schedule execution
+    std::int64_t m_NextExecuteTime;
 };
 
 } // IrrigationSystem
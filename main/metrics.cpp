@@ -0,0 +1,119 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// Runtime metrics (/metrics Prometheus text exposition)
+
+// Include ----------------------
+#include "metrics.h"
+
+#include <cstring>
+
+#include "html_chunk_writer.h"
+
+namespace IrrigationSystem {
+
+namespace {
+
+/// Registry head (constant initialized before any static Metric)
+std::atomic<const Metric*> s_pFirstMetric(nullptr);
+
+} // namespace
+
+Metric::Metric(const char *const name, const char *const help, const Type type, const char *const label)
+    :m_Name(name)
+    ,m_Help(help)
+    ,m_Type(type)
+    ,m_Label(label)
+    ,m_Value(0)
+    ,m_pNext(nullptr)
+{
+    const Metric* pFirst = s_pFirstMetric.load(std::memory_order_relaxed);
+    do {
+        m_pNext = pFirst;
+    } while (!s_pFirstMetric.compare_exchange_weak(pFirst, this, std::memory_order_release, std::memory_order_relaxed));
+}
+
+const char* Metric::GetName() const
+{
+    return m_Name;
+}
+
+const char* Metric::GetHelp() const
+{
+    return m_Help;
+}
+
+Metric::Type Metric::GetType() const
+{
+    return m_Type;
+}
+
+const char* Metric::GetLabel() const
+{
+    return m_Label;
+}
+
+long long Metric::GetValue() const
+{
+    const std::uint32_t value = m_Value.load(std::memory_order_relaxed);
+    if (m_Type == TYPE_GAUGE) {
+        return static_cast<std::int32_t>(value);
+    }
+    return value;
+}
+
+const Metric* Metric::GetFirst()
+{
+    return s_pFirstMetric.load(std::memory_order_acquire);
+}
+
+const Metric* Metric::GetNext() const
+{
+    return m_pNext;
+}
+
+namespace Metrics {
+
+void WriteHeader(HtmlChunkWriter& writer, const char *const name, const char *const help, const Metric::Type type)
+{
+    writer
+        << "# HELP " << name << ' ' << help << '\n'
+        << "# TYPE " << name << ' ' << ((type == Metric::TYPE_COUNTER) ? "counter" : "gauge") << '\n';
+}
+
+void WriteSample(HtmlChunkWriter& writer, const char *const name, const char *const label, const long long value)
+{
+    writer << name;
+    if (label) {
+        writer << '{' << label << '}';
+    }
+    writer << ' ' << value << '\n';
+}
+
+void WriteRegistry(HtmlChunkWriter& writer)
+{
+    for (const Metric* pMetric = Metric::GetFirst(); pMetric; pMetric = pMetric->GetNext()) {
+        // The first metric of a name writes the whole group
+        bool isWritten = false;
+        for (const Metric* pPrevious = Metric::GetFirst(); pPrevious != pMetric; pPrevious = pPrevious->GetNext()) {
+            if (std::strcmp(pPrevious->GetName(), pMetric->GetName()) == 0) {
+                isWritten = true;
+                break;
+            }
+        }
+        if (isWritten) {
+            continue;
+        }
+
+        WriteHeader(writer, pMetric->GetName(), pMetric->GetHelp(), pMetric->GetType());
+        for (const Metric* pSample = pMetric; pSample; pSample = pSample->GetNext()) {
+            if (std::strcmp(pSample->GetName(), pMetric->GetName()) == 0) {
+                WriteSample(writer, pSample->GetName(), pSample->GetLabel(), pSample->GetValue());
+            }
+        }
+    }
+}
+
+} // Metrics
+} // IrrigationSystem
+
+// EOF
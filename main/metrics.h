@@ -0,0 +1,79 @@
+#ifndef METRICS_H_
+#define METRICS_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// Runtime metrics (/metrics Prometheus text exposition)
+
+// Include ----------------------
+#include <atomic>
+#include <cstdint>
+
+namespace IrrigationSystem {
+
+class HtmlChunkWriter;
+
+/// Counter or gauge of the metrics registry
+/// Defined as a static object. It is linked into the registry when constructed (lock-free) and never removed.
+/// Updating is a relaxed atomic operation.
+class Metric final
+{
+public:
+    enum Type : std::uint8_t {
+        TYPE_COUNTER,
+        TYPE_GAUGE,
+    };
+
+public:
+    /// label is the label set without braces (e.g. "outcome=\"success\"") or nullptr
+    Metric(const char *const name, const char *const help, const Type type, const char *const label = nullptr);
+
+    Metric(const Metric&) = delete;
+    Metric& operator=(const Metric&) = delete;
+
+    /// Counter
+    void Add(const std::uint32_t value = 1)
+    {
+        m_Value.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    /// Gauge
+    void Set(const std::int32_t value)
+    {
+        m_Value.store(static_cast<std::uint32_t>(value), std::memory_order_relaxed);
+    }
+
+    const char* GetName() const;
+    const char* GetHelp() const;
+    Type GetType() const;
+    const char* GetLabel() const;
+    long long GetValue() const;
+
+    /// Registry (latest registered first)
+    static const Metric* GetFirst();
+    const Metric* GetNext() const;
+
+private:
+    const char *const m_Name;
+    const char *const m_Help;
+    const Type m_Type;
+    const char *const m_Label;
+    std::atomic<std::uint32_t> m_Value;
+    const Metric* m_pNext;
+};
+
+namespace Metrics {
+
+/// # HELP and # TYPE lines
+void WriteHeader(HtmlChunkWriter& writer, const char *const name, const char *const help, const Metric::Type type);
+
+/// Sample line. label is the label set without braces or nullptr
+void WriteSample(HtmlChunkWriter& writer, const char *const name, const char *const label, const long long value);
+
+/// Every metric of the registry (grouped by name)
+void WriteRegistry(HtmlChunkWriter& writer);
+
+} // Metrics
+} // IrrigationSystem
+
+#endif // METRICS_H_
+// EOF
@@ -0,0 +1,212 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// Incremental multipart/form-data parser with fixed size buffers
+
+// Include ----------------------
+#include "multipart_parser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <strings.h>
+
+#include "logger.h"
+#include "request_parser.h"
+
+namespace IrrigationSystem {
+
+namespace {
+
+constexpr char DELIMITER_PREFIX[] = "\r\n--";
+constexpr std::size_t DELIMITER_PREFIX_LENGTH = sizeof(DELIMITER_PREFIX) - 1;
+/// The first delimiter has no leading CRLF
+constexpr std::size_t FIRST_DELIMITER_OFFSET = 2;
+
+constexpr char CONTENT_DISPOSITION[] = "Content-Disposition:";
+
+} // namespace
+
+MultipartParser::MultipartParser(Listener& listener)
+    :m_Listener(listener)
+    ,m_State(STATE_ERROR)
+    ,m_Delimiter()
+    ,m_DelimiterLength(0)
+    ,m_MatchLength(0)
+    ,m_Header()
+    ,m_HeaderLength(0)
+    ,m_Name()
+{}
+
+bool MultipartParser::SetContentType(const std::string_view contentType)
+{
+    m_State = STATE_ERROR;
+
+    // boundary=xxx or boundary="xxx" (followed by other parameters)
+    std::string_view boundary;
+    if (!RequestParser::FindHeaderParameter(contentType, "boundary", boundary)) {
+        return false;
+    }
+    const std::size_t boundaryLength = boundary.size();
+    if (boundaryLength == 0 || MAX_BOUNDARY_LENGTH < boundaryLength) {
+        ESP_LOGE(TAG, "Invalid multipart boundary. length:%u", boundaryLength);
+        return false;
+    }
+
+    std::memcpy(m_Delimiter, DELIMITER_PREFIX, DELIMITER_PREFIX_LENGTH);
+    std::memcpy(m_Delimiter + DELIMITER_PREFIX_LENGTH, boundary.data(), boundaryLength);
+    m_DelimiterLength = DELIMITER_PREFIX_LENGTH + boundaryLength;
+    m_Delimiter[m_DelimiterLength] = '\0';
+
+    m_State = STATE_PREAMBLE;
+    m_MatchLength = FIRST_DELIMITER_OFFSET;
+    return true;
+}
+
+bool MultipartParser::Feed(const char *const pData, const std::size_t length)
+{
+    std::size_t index = 0;
+    while (index < length && m_State != STATE_ERROR) {
+        switch (m_State) {
+        case STATE_PREAMBLE:
+        case STATE_BODY:
+            index += ScanDelimiter(pData + index, length - index, m_State == STATE_BODY);
+            break;
+        case STATE_BOUNDARY_END:
+            // "--" closes the body. Transport padding is allowed before CRLF
+            if (pData[index] == '-') {
+                m_State = STATE_CLOSE_DASH;
+            } else if (pData[index] == '\r') {
+                m_State = STATE_BOUNDARY_LF;
+            } else if (pData[index] != ' ' && pData[index] != '\t') {
+                m_State = STATE_ERROR;
+            }
+            ++index;
+            break;
+        case STATE_BOUNDARY_LF:
+            m_State = (pData[index] == '\n') ? STATE_HEADER : STATE_ERROR;
+            m_HeaderLength = 0;
+            m_Name[0] = '\0';
+            ++index;
+            break;
+        case STATE_CLOSE_DASH:
+            m_State = (pData[index] == '-') ? STATE_EPILOGUE : STATE_ERROR;
+            ++index;
+            break;
+        case STATE_HEADER:
+            if (pData[index] == '\n') {
+                if (0 < m_HeaderLength && m_Header[m_HeaderLength - 1] == '\r') {
+                    --m_HeaderLength;
+                }
+                if (m_HeaderLength == 0) {
+                    // The empty line ends the headers
+                    m_Listener.OnPartBegin(m_Name);
+                    m_State = STATE_BODY;
+                    m_MatchLength = 0;
+                } else {
+                    ParseHeaderLine();
+                    m_HeaderLength = 0;
+                }
+            } else if (m_HeaderLength < MAX_HEADER_LENGTH) {
+                // Longer lines are truncated (only the name parameter is needed)
+                m_Header[m_HeaderLength++] = pData[index];
+            }
+            ++index;
+            break;
+        case STATE_EPILOGUE:
+            index = length;
+            break;
+        default:
+            m_State = STATE_ERROR;
+            break;
+        }
+    }
+    return m_State != STATE_ERROR;
+}
+
+bool MultipartParser::Finish()
+{
+    if (m_State != STATE_EPILOGUE) {
+        m_State = STATE_ERROR;
+        return false;
+    }
+    return true;
+}
+
+bool MultipartParser::IsError() const
+{
+    return m_State == STATE_ERROR;
+}
+
+std::size_t MultipartParser::ScanDelimiter(const char *const pData, const std::size_t length, const bool isBody)
+{
+    // Start of the bytes not yet passed to the listener. (A boundary has no CR,
+    // so a mismatch never restarts inside the held back bytes)
+    std::size_t dataBegin = 0;
+    for (std::size_t index = 0; index < length; ++index) {
+        const char c = pData[index];
+        if (c == m_Delimiter[m_MatchLength]) {
+            if (m_MatchLength == 0 && isBody && !Emit(pData + dataBegin, index - dataBegin)) {
+                return length;
+            }
+            ++m_MatchLength;
+            dataBegin = index + 1;
+            if (m_MatchLength == m_DelimiterLength) {
+                if (isBody) {
+                    m_Listener.OnPartEnd();
+                }
+                m_MatchLength = 0;
+                m_State = STATE_BOUNDARY_END;
+                return index + 1;
+            }
+            continue;
+        }
+
+        if (0 < m_MatchLength) {
+            // The held back bytes were part data
+            if (isBody && !Emit(m_Delimiter, m_MatchLength)) {
+                return length;
+            }
+            m_MatchLength = 0;
+            dataBegin = index;
+            if (c == m_Delimiter[0]) {
+                m_MatchLength = 1;
+                dataBegin = index + 1;
+            }
+        }
+    }
+    if (isBody) {
+        Emit(pData + dataBegin, length - dataBegin);
+    }
+    return length;
+}
+
+void MultipartParser::ParseHeaderLine()
+{
+    m_Header[m_HeaderLength] = '\0';
+    if (strncasecmp(m_Header, CONTENT_DISPOSITION, sizeof(CONTENT_DISPOSITION) - 1) != 0) {
+        return;
+    }
+
+    // Content-Disposition: form-data; name="setting_file"; filename="setting.json"
+    std::string_view name;
+    if (RequestParser::FindHeaderParameter(std::string_view(m_Header, m_HeaderLength), "name", name)) {
+        const std::size_t nameLength = std::min(name.size(), MAX_NAME_LENGTH);
+        std::memcpy(m_Name, name.data(), nameLength);
+        m_Name[nameLength] = '\0';
+    }
+}
+
+bool MultipartParser::Emit(const char *const pData, const std::size_t length)
+{
+    if (length == 0) {
+        return true;
+    }
+    if (!m_Listener.OnPartData(pData, length)) {
+        m_State = STATE_ERROR;
+        return false;
+    }
+    return true;
+}
+
+} // IrrigationSystem
+
+// EOF
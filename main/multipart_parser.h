@@ -0,0 +1,94 @@
+#ifndef MULTIPART_PARSER_H_
+#define MULTIPART_PARSER_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// Incremental multipart/form-data parser with fixed size buffers
+
+// Include ----------------------
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace IrrigationSystem {
+
+/// Incremental multipart/form-data Parser
+/// The body is fed in arbitrary chunks. The boundary is scanned byte by byte,
+/// so the part data is passed to the listener as it arrives without being buffered.
+class MultipartParser final
+{
+public:
+    /// RFC 2046
+    static constexpr std::size_t MAX_BOUNDARY_LENGTH = 70;
+    static constexpr std::size_t MAX_HEADER_LENGTH = 127;
+    static constexpr std::size_t MAX_NAME_LENGTH = 31;
+
+    /// Parse Event Listener
+    class Listener
+    {
+    public:
+        virtual ~Listener() {}
+
+        /// Begin a part. name is the form field name of Content-Disposition (empty if none)
+        virtual void OnPartBegin(const char *const pName) {}
+
+        /// Part data. Return false to abort
+        virtual bool OnPartData(const char *const pData, const std::size_t length) { return true; }
+
+        /// End a part
+        virtual void OnPartEnd() {}
+    };
+
+private:
+    enum State : std::uint8_t {
+        STATE_PREAMBLE,
+        STATE_BOUNDARY_END,
+        STATE_BOUNDARY_LF,
+        STATE_CLOSE_DASH,
+        STATE_HEADER,
+        STATE_BODY,
+        STATE_EPILOGUE,
+        STATE_ERROR,
+    };
+
+public:
+    explicit MultipartParser(Listener& listener);
+
+    /// Boundary from the Content-Type header value. Return false if it has no valid boundary
+    bool SetContentType(const std::string_view contentType);
+
+    /// Feed a part of the body
+    bool Feed(const char *const pData, const std::size_t length);
+
+    /// Notify the end of the body. Return true if the closing boundary has been found
+    bool Finish();
+
+    bool IsError() const;
+
+private:
+    /// Search the delimiter. The other bytes are part data (isBody) or discarded
+    std::size_t ScanDelimiter(const char *const pData, const std::size_t length, const bool isBody);
+
+    /// Parse a part header line
+    void ParseHeaderLine();
+
+    bool Emit(const char *const pData, const std::size_t length);
+
+private:
+    Listener& m_Listener;
+    State m_State;
+
+    /// "\r\n--" boundary
+    char m_Delimiter[MAX_BOUNDARY_LENGTH + 5];
+    std::size_t m_DelimiterLength;
+    /// Number of the delimiter bytes matched so far (held back from the part data)
+    std::size_t m_MatchLength;
+
+    char m_Header[MAX_HEADER_LENGTH + 1];
+    std::size_t m_HeaderLength;
+    char m_Name[MAX_NAME_LENGTH + 1];
+};
+
+} // IrrigationSystem
+
+#endif // MULTIPART_PARSER_H_
+// EOF
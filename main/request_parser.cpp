@@ -0,0 +1,213 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include "request_parser.h"
+
+#include <charconv>
+#include <cstring>
+
+namespace IrrigationSystem {
+namespace RequestParser {
+
+namespace {
+    int HexToInt(const char character)
+    {
+        if ('0' <= character && character <= '9') {
+            return character - '0';
+        } else if ('a' <= character && character <= 'f') {
+            return character - 'a' + 10;
+        } else if ('A' <= character && character <= 'F') {
+            return character - 'A' + 10;
+        }
+        return -1;
+    }
+
+    char ToLower(const char character)
+    {
+        return ('A' <= character && character <= 'Z') ? static_cast<char>(character - 'A' + 'a') : character;
+    }
+}
+
+std::size_t PercentDecode(char *const pData, const std::size_t length)
+{
+    // The output never gets ahead of the input
+    std::size_t readIndex = 0;
+    std::size_t writeIndex = 0;
+    while (readIndex < length) {
+        const char character = pData[readIndex];
+        if (character == '+') {
+            pData[writeIndex++] = ' ';
+            ++readIndex;
+            continue;
+        }
+        if (character == '%' && readIndex + 2 < length) {
+            const int high = HexToInt(pData[readIndex + 1]);
+            const int low = HexToInt(pData[readIndex + 2]);
+            if (0 <= high && 0 <= low) {
+                pData[writeIndex++] = static_cast<char>((high << 4) | low);
+                readIndex += 3;
+                continue;
+            }
+        }
+        pData[writeIndex++] = character;
+        ++readIndex;
+    }
+    return writeIndex;
+}
+
+
+FormReader::FormReader(char *const pData, const std::size_t length)
+    :m_pCurrent(pData)
+    ,m_pEnd(pData + length)
+{}
+
+bool FormReader::Next(std::string_view& key, std::string_view& value)
+{
+    while (m_pCurrent < m_pEnd) {
+        char *const pField = m_pCurrent;
+        char *pFieldEnd = static_cast<char*>(std::memchr(pField, '&', m_pEnd - pField));
+        if (!pFieldEnd) {
+            pFieldEnd = m_pEnd;
+        }
+        m_pCurrent = (pFieldEnd < m_pEnd) ? pFieldEnd + 1 : m_pEnd;
+        if (pField == pFieldEnd) {
+            continue;
+        }
+
+        // key=value (a field without "=" has an empty value)
+        char *pSeparator = static_cast<char*>(std::memchr(pField, '=', pFieldEnd - pField));
+        char *const pValue = pSeparator ? pSeparator + 1 : pFieldEnd;
+        if (!pSeparator) {
+            pSeparator = pFieldEnd;
+        }
+        key = std::string_view(pField, PercentDecode(pField, pSeparator - pField));
+        value = std::string_view(pValue, PercentDecode(pValue, pFieldEnd - pValue));
+        return true;
+    }
+    return false;
+}
+
+bool FormReader::Find(const std::string_view key, std::string_view& value)
+{
+    std::string_view fieldKey;
+    std::string_view fieldValue;
+    while (Next(fieldKey, fieldValue)) {
+        if (fieldKey == key) {
+            value = fieldValue;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool FindHeaderParameter(const std::string_view header, const std::string_view name, std::string_view& value)
+{
+    // The value itself is skipped. e.g. "multipart/form-data" of "multipart/form-data; boundary=xyz"
+    std::size_t position = header.find(';');
+    while (position != std::string_view::npos) {
+        const std::size_t nameBegin = position + 1;
+        const std::size_t equal = header.find('=', nameBegin);
+        if (equal == std::string_view::npos) {
+            return false;
+        }
+        const bool isMatch = EqualsIgnoreCase(Trim(header.substr(nameBegin, equal - nameBegin)), name);
+
+        std::size_t valueBegin = equal + 1;
+        while (valueBegin < header.size() && (header[valueBegin] == ' ' || header[valueBegin] == '\t')) {
+            ++valueBegin;
+        }
+        std::size_t valueEnd = 0;
+        if (valueBegin < header.size() && header[valueBegin] == '"') {
+            ++valueBegin;
+            valueEnd = header.find('"', valueBegin);
+            if (valueEnd == std::string_view::npos) {
+                return false;
+            }
+            position = header.find(';', valueEnd);
+        } else {
+            valueEnd = header.find(';', valueBegin);
+            position = valueEnd;
+            if (valueEnd == std::string_view::npos) {
+                valueEnd = header.size();
+            }
+        }
+        if (isMatch) {
+            value = Trim(header.substr(valueBegin, valueEnd - valueBegin));
+            return true;
+        }
+    }
+    return false;
+}
+
+bool NextListItem(std::string_view& list, std::string_view& item)
+{
+    while (!list.empty()) {
+        const std::size_t comma = list.find(',');
+        item = Trim(list.substr(0, comma));
+        list = (comma == std::string_view::npos) ? std::string_view() : list.substr(comma + 1);
+        if (!item.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string_view GetItemName(const std::string_view item)
+{
+    return Trim(item.substr(0, item.find(';')));
+}
+
+bool IsRefused(const std::string_view item)
+{
+    std::string_view quality;
+    if (!FindHeaderParameter(item, "q", quality)) {
+        return false;
+    }
+    // "0", "0.0", "0.000"
+    if (quality.empty() || quality[0] != '0') {
+        return false;
+    }
+    for (const char character : quality.substr(1)) {
+        if (character != '.' && character != '0') {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ToInteger(const std::string_view text, long& value)
+{
+    const char *const pEnd = text.data() + text.size();
+    const std::from_chars_result result = std::from_chars(text.data(), pEnd, value);
+    return result.ec == std::errc() && result.ptr == pEnd && !text.empty();
+}
+
+bool EqualsIgnoreCase(const std::string_view left, const std::string_view right)
+{
+    if (left.size() != right.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < left.size(); ++i) {
+        if (ToLower(left[i]) != ToLower(right[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string_view Trim(const std::string_view text)
+{
+    const std::size_t begin = text.find_first_not_of(" \t");
+    if (begin == std::string_view::npos) {
+        return std::string_view();
+    }
+    const std::size_t end = text.find_last_not_of(" \t");
+    return text.substr(begin, end - begin + 1);
+}
+
+} // RequestParser
+} // IrrigationSystem
+
+// EOF
@@ -0,0 +1,61 @@
+#ifndef REQUEST_PARSER_H_
+#define REQUEST_PARSER_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// Form, query and header parsing without allocation
+
+// Include ----------------------
+#include <cstddef>
+#include <string_view>
+
+namespace IrrigationSystem {
+namespace RequestParser {
+
+/// Percent-decode in place ("+" is a space). Return the decoded length.
+/// A malformed escape is left as it is
+std::size_t PercentDecode(char *const pData, const std::size_t length);
+
+/// application/x-www-form-urlencoded body or query string Reader
+/// The fields are percent-decoded in place as they are read, so the views point into the buffer
+class FormReader final
+{
+public:
+    FormReader(char *const pData, const std::size_t length);
+
+    /// Next field. false at the end
+    bool Next(std::string_view& key, std::string_view& value);
+
+    /// Value of the first field of the key (the fields before it are decoded)
+    bool Find(const std::string_view key, std::string_view& value);
+
+private:
+    char* m_pCurrent;
+    char *const m_pEnd;
+};
+
+/// Parameter of a header value. e.g. boundary of "multipart/form-data; boundary=xyz" (quotes are removed)
+bool FindHeaderParameter(const std::string_view header, const std::string_view name, std::string_view& value);
+
+/// Next item of a comma separated header value. e.g. "ja" then "en-US;q=0.9" of "ja,en-US;q=0.9"
+bool NextListItem(std::string_view& list, std::string_view& item);
+
+/// Item without its parameters. e.g. "en-US" of "en-US;q=0.9"
+std::string_view GetItemName(const std::string_view item);
+
+/// The item has "q=0" (refused)
+bool IsRefused(const std::string_view item);
+
+/// Decimal integer (the whole text). No exception
+bool ToInteger(const std::string_view text, long& value);
+
+/// Case insensitive ASCII compare
+bool EqualsIgnoreCase(const std::string_view left, const std::string_view right);
+
+/// Remove spaces and tabs of both ends
+std::string_view Trim(const std::string_view text);
+
+} // RequestParser
+} // IrrigationSystem
+
+#endif // REQUEST_PARSER_H_
+// EOF
@@ -0,0 +1,46 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include "retry_backoff.h"
+
+#include <esp_random.h>
+
+namespace IrrigationSystem {
+
+RetryBackoff::RetryBackoff(const std::uint32_t baseSecond, const std::uint32_t maxSecond)
+    :m_BaseSecond(baseSecond)
+    ,m_MaxSecond(maxSecond)
+    ,m_RetryCount(0)
+{}
+
+void RetryBackoff::Reset()
+{
+    m_RetryCount = 0;
+}
+
+std::uint32_t RetryBackoff::NextDelaySecond()
+{
+    // Stop doubling before the shift overflows
+    static constexpr std::uint32_t MAX_SHIFT = 16;
+    const std::uint32_t shift = (m_RetryCount < MAX_SHIFT) ? m_RetryCount : MAX_SHIFT;
+    std::uint64_t backoff = static_cast<std::uint64_t>(m_BaseSecond) << shift;
+    if (m_MaxSecond < backoff) {
+        backoff = m_MaxSecond;
+    }
+    ++m_RetryCount;
+
+    // Jitter spreads the retries of devices that failed at the same time
+    const std::uint32_t halfBackoff = static_cast<std::uint32_t>(backoff / 2);
+    const std::uint32_t jitterRange = static_cast<std::uint32_t>(backoff) - halfBackoff + 1;
+    return halfBackoff + (esp_random() % jitterRange);
+}
+
+std::uint32_t RetryBackoff::GetRetryCount() const
+{
+    return m_RetryCount;
+}
+
+} // IrrigationSystem
+
+// EOF
@@ -0,0 +1,35 @@
+#ifndef RETRY_BACKOFF_H_
+#define RETRY_BACKOFF_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include <cstdint>
+
+namespace IrrigationSystem {
+
+/// Bounded exponential backoff with jitter
+/// delay = random(backoff / 2 ... backoff), backoff = min(base * 2^retry, max)
+class RetryBackoff final
+{
+public:
+    RetryBackoff(const std::uint32_t baseSecond, const std::uint32_t maxSecond);
+
+    /// Start a new sequence
+    void Reset();
+
+    /// Delay before the next retry (counts up the retry)
+    std::uint32_t NextDelaySecond();
+
+    std::uint32_t GetRetryCount() const;
+
+private:
+    std::uint32_t m_BaseSecond;
+    std::uint32_t m_MaxSecond;
+    std::uint32_t m_RetryCount;
+};
+
+} // IrrigationSystem
+
+#endif // RETRY_BACKOFF_H_
+// EOF
@@ -39,7 +39,7 @@ void ScheduleAdjust::Exec()
         return;
     }
 
-    scheduleManager->AdjustSchedule();
+    scheduleManager->RequestAdjustSchedule();
 }
 
 } // IrrigationSystem
@@ -7,7 +7,6 @@
 #include <algorithm>
 #include <limits>
 #include <chrono>
-#include <sstream>
 
 #include "logger.h"
 #include "util.h"
@@ -18,15 +17,26 @@
 #include "schedule_watering.h"
 #include "watering_record.h"
 #include "watering_setting.h"
+#include "status_snapshot.h"
+#include "event_stream.h"
+#include "json_writer.h"
 
 
 namespace IrrigationSystem {
 
+namespace {
+    /// Schedule event (name, time and status)
+    constexpr std::size_t EVENT_DATA_SIZE = 128;
+}
+
 ScheduleManager::ScheduleManager(const IrrigationInterfaceWeakPtr pIrrigationInterface)
     :m_pIrrigationInterface(pIrrigationInterface)
     ,m_ScheduleList()
     ,m_CurrentMonth(0)
     ,m_CurrentDay(0)
+    ,m_AdjustState(ADJUST_STATE_NONE)
+    ,m_AdjustDeadlineEpoch(0)
+    ,m_WateringPlan()
 {}
 
 void ScheduleManager::Execute()
@@ -39,12 +49,21 @@ void ScheduleManager::Execute()
         InitializeNewDay(nowTimeInfo);
     }
 
+    // Forecast fetched in WeatherForecastTask
+    CheckPendingAdjust();
+
     // Run the schedule 
+    bool isExecuted = false;
     for (auto&& pScheduleItem : m_ScheduleList) {
         if (pScheduleItem->CanExecute(nowTimeInfo)) {
             pScheduleItem->Exec();
+            isExecuted = true;
+            PublishScheduleStatus(*pScheduleItem);
         }
     }
+    if (isExecuted) {
+        InvalidateStatus();
+    }
 }
 
 const ScheduleManager::ScheduleBaseList& ScheduleManager::GetScheduleList() const
@@ -52,10 +71,95 @@ const ScheduleManager::ScheduleBaseList& ScheduleManager::GetScheduleList() cons
     return m_ScheduleList;
 }
 
+const ScheduleManager::DailyPlanList& ScheduleManager::GetWateringPlan() const
+{
+    return m_WateringPlan;
+}
+
+void ScheduleManager::RequestAdjustSchedule()
+{
+    const IrrigationInterfaceSharedPtr irrigationInterface = m_pIrrigationInterface.lock();
+    if (!irrigationInterface) {
+        ESP_LOGE(TAG, "Failed IrrigationInterface is null");
+        return;
+    }
+
+    const WateringSetting& wateringSetting = irrigationInterface->GetWateringSetting();
+    if (!wateringSetting.IsActive() || wateringSetting.GetWateringMode() != WateringSetting::WATERING_MODE_ADVANCE) {
+        AdjustSchedule();
+        return;
+    }
+
+    // The request runs in WeatherForecastTask. AdjustSchedule is called from Execute when it is finished
+    const std::time_t retryDeadlineEpoch = CalcRetryDeadlineEpoch(wateringSetting);
+    irrigationInterface->WeatherForecastFetch(wateringSetting.GetJMAAreaPathCode(), wateringSetting.GetJMALocalCode(), wateringSetting.GetJMAAMeDAS(), retryDeadlineEpoch);
+    m_AdjustState = ADJUST_STATE_WAIT_FORECAST;
+    m_AdjustDeadlineEpoch = Util::GetEpoch() + CONFIG_WEATHER_FORECAST_FETCH_DEADLINE_SECOND;
+    ESP_LOGI(TAG, "Request Weather Forecast. Deadline:%s RetryDeadline:%s",
+        Util::TimeToStr(Util::EpochToLocalTime(m_AdjustDeadlineEpoch)).c_str(),
+        Util::TimeToStr(Util::EpochToLocalTime(retryDeadlineEpoch)).c_str());
+}
+
+void ScheduleManager::CheckPendingAdjust()
+{
+    if (m_AdjustState == ADJUST_STATE_NONE) {
+        return;
+    }
+
+    const IrrigationInterfaceSharedPtr irrigationInterface = m_pIrrigationInterface.lock();
+    if (!irrigationInterface) {
+        ESP_LOGE(TAG, "Failed IrrigationInterface is null");
+        return;
+    }
+
+    const bool isFetchComplete = irrigationInterface->WeatherForecastIsFetchComplete();
+    if (m_AdjustState == ADJUST_STATE_WAIT_FORECAST) {
+        if (isFetchComplete) {
+            m_AdjustState = ADJUST_STATE_NONE;
+            AdjustSchedule();
+        } else if (m_AdjustDeadlineEpoch <= Util::GetEpoch()) {
+            // Use the fallback now, and adjust again if a retry succeeds later
+            ESP_LOGW(TAG, "Weather forecast deadline exceeded. Waiting for the retry.");
+            m_AdjustState = ADJUST_STATE_WAIT_RETRY;
+            AdjustSchedule();
+        }
+    } else if (m_AdjustState == ADJUST_STATE_WAIT_RETRY) {
+        if (!isFetchComplete) {
+            return;
+        }
+        m_AdjustState = ADJUST_STATE_NONE;
+        if (irrigationInterface->GetWeatherForecast().GetRequestStatus() == WeatherForecast::ACQUIRED) {
+            ESP_LOGI(TAG, "Weather forecast acquired by retry. Adjust again.");
+            AdjustSchedule();
+        }
+    }
+}
+
+/// Retries must end before the earliest watering of the day
+std::time_t ScheduleManager::CalcRetryDeadlineEpoch(const WateringSetting& wateringSetting)
+{
+    static constexpr std::int32_t NOT_FOUND_HOUR = 24;
+    std::int32_t firstHour = NOT_FOUND_HOUR;
+    for (const auto& wateringTypePair : wateringSetting.GetWateringTypeDict()) {
+        for (const std::int32_t hour : wateringTypePair.second.WateringHours) {
+            firstHour = std::min(firstHour, hour);
+        }
+    }
+
+    std::tm deadlineTimeInfo = Util::GetLocalTime();
+    deadlineTimeInfo.tm_hour = firstHour;
+    deadlineTimeInfo.tm_min = -CONFIG_WEATHER_FORECAST_RETRY_MARGIN_MINUTE;
+    deadlineTimeInfo.tm_sec = 0;
+    return std::mktime(&deadlineTimeInfo);
+}
+
 void ScheduleManager::AdjustSchedule()
 {
     ESP_LOGI(TAG, "Start Schedule Adjust. %s", Util::GetNowTimeStr().c_str());
 
+    // Adjusting again replaces the schedules that have not been executed yet
+    RemoveUnexecutedSchedule();
+
     const IrrigationInterfaceSharedPtr irrigationInterface = m_pIrrigationInterface.lock();
     if (!irrigationInterface) {
         ESP_LOGE(TAG, "Failed IrrigationInterface is null");
@@ -82,77 +186,33 @@ void ScheduleManager::AdjustSchedule()
             );
         }
     } else if (wateringSetting.GetWateringMode() == WateringSetting::WATERING_MODE_ADVANCE) {
-        // Read History 
-        const std::tm wateringTm = Util::EpochToLocalTime(irrigationInterface->GetLastWateringEpoch());
-
-        /// WateringWeather
-        enum WateringWeather : int {
-            WATERING_WEATHER_NONE,
-            WATERING_WEATHER_NORMAL,
-            WATERING_WEATHER_RAIN,
-            MAX_WATERING_WEATHER,
-        };
-
-        // Request weather forecast
-        WateringWeather wateringWeather = WATERING_WEATHER_NONE;
-        std::int32_t maxTemperature = 0;
-
-        WeatherForecast &weatherForecast = irrigationInterface->GetWeatherForecast();
-        weatherForecast.SetJMAParamter(wateringSetting.GetJMAAreaPathCode(), wateringSetting.GetJMALocalCode(), wateringSetting.GetJMAAMeDAS());
-        weatherForecast.Request();
+        // Acquired weather forecast (fetched by WeatherForecastTask)
+        const WeatherForecast &weatherForecast = irrigationInterface->GetWeatherForecast();
+        const WeatherForecastDaily daily = weatherForecast.GetDailyForecast();
         if (weatherForecast.GetRequestStatus() == WeatherForecast::ACQUIRED) {   
-            wateringWeather = (weatherForecast.IsRain()) ? WATERING_WEATHER_RAIN : WATERING_WEATHER_NORMAL;
-            maxTemperature = weatherForecast.GetCurrentMaxTemperature();
-            ESP_LOGI(TAG, "Weather OK. Weather:%s MaxTemperature:%d°C", WeatherForecast::WeatherCodeToStr(weatherForecast.GetCurrentWeatherCode()), maxTemperature);
+            ESP_LOGI(TAG, "Weather OK. Weather:%s MaxTemperature:%d°C Days:%u", WeatherForecast::WeatherCodeToStr(weatherForecast.GetCurrentWeatherCode()), weatherForecast.GetCurrentMaxTemperature(), daily.DayCount);
+        } else if (daily.HasWeatherCode(0)) {
+            // Network outage. The forecast of the previous fetch still covers today
+            ESP_LOGW(TAG, "Failed to get the weather forecast. Use the forecast fetched earlier. Days:%u", daily.DayCount);
         } else {
             ESP_LOGW(TAG, "Failed to get the weather forecast.");
         }
 
-        // Match WateringType   
-        std::string wateringTypeStr;
-        if (wateringWeather == WATERING_WEATHER_NONE) {
-            // could not Get Weather
-            const int month = nowTimeInfo.tm_mon + 1;
-    
-            // Reference from the monthly table and treat it as normal weather
-            const WateringSetting::MonthToTypeDict& monthToTypeDict = wateringSetting.GetMonthToTypeDict();
-            WateringSetting::MonthToTypeDict::const_iterator iter = monthToTypeDict.find(std::to_string(month));
-            if (iter != monthToTypeDict.end()) {
-                wateringTypeStr = iter->second;
-            }
-            wateringWeather = WATERING_WEATHER_NORMAL;
-        } else {
-            const WateringSetting::TemperatureWateringList& temperatureWateringList = wateringSetting.GetTemperatureWateringList();
-            for (const WateringSetting::TemperatureWatering& temperatureWatering : temperatureWateringList) {
-                if (temperatureWatering.Temperature <= maxTemperature) {
-                    wateringTypeStr = (wateringWeather == WATERING_WEATHER_RAIN) ?
-                       temperatureWatering.RainType : temperatureWatering.NormalType;
-                }
-            }
-        }
+        PlanWatering(wateringSetting, daily, nowTimeInfo, irrigationInterface->GetLastWateringEpoch());
 
-        ESP_LOGI(TAG, "Watering Type:%s wateringWeather:%d", wateringTypeStr.c_str(), wateringWeather);
-   
-        // WateringType To Schedule
+        // Today's plan to Schedule
+        const DailyPlan& todayPlan = m_WateringPlan.front();
         const WateringSetting::WateringTypeDict& wateringTypeDict = wateringSetting.GetWateringTypeDict();
-        WateringSetting::WateringTypeDict::const_iterator iter = wateringTypeDict.find(wateringTypeStr);
-        if (iter != wateringTypeDict.end()) {
-            const WateringSetting::WateringType& wateringType = iter->second;
-
-            const std::int32_t lastWateringDuration = Util::GregToMJD(nowTimeInfo) - Util::GregToMJD(wateringTm);
-            ESP_LOGI(TAG, "Watering DaysDuration:%d", lastWateringDuration);
-
-            if (wateringType.DaySpan <= lastWateringDuration) {
-                for (const std::int32_t& hour : wateringType.WateringHours) {
-                    AddSchedule(
-                        std::make_unique<ScheduleWatering>(irrigationInterface, hour, 0, wateringSetting.GetWateringSec())
-                    );
-                }
-            } else { 
-                ESP_LOGI(TAG, "Skip DaysDuration");
+        WateringSetting::WateringTypeDict::const_iterator iter = wateringTypeDict.find(todayPlan.WateringTypeName);
+        if (todayPlan.IsWatering && iter != wateringTypeDict.end()) {
+            for (const std::int32_t& hour : iter->second.WateringHours) {
+                AddSchedule(
+                    std::make_unique<ScheduleWatering>(irrigationInterface, hour, 0, wateringSetting.GetWateringSec())
+                );
             }
+        } else { 
+            ESP_LOGI(TAG, "Skip DaysDuration");
         }
-
     } 
 
 #if CONFIG_DEBUG != 0
@@ -171,11 +231,84 @@ void ScheduleManager::AdjustSchedule()
     DebugOutputSchedules();
 #endif
 
+    InvalidateStatus();
+    PublishReload();
+
     ESP_LOGI(TAG, "Finish Schedule Adjust.");
     
     return;
 }
 
+void ScheduleManager::PlanWatering(const WateringSetting& wateringSetting, const WeatherForecastDaily& daily, const std::tm& nowTimeInfo, const std::time_t lastWateringEpoch)
+{
+    m_WateringPlan.clear();
+
+    const std::int32_t today = Util::DateToDayNumber(nowTimeInfo);
+    std::int32_t lastWateringDay = Util::DateToDayNumber(Util::EpochToLocalTime(lastWateringEpoch));
+
+    // Days without the temperature (e.g. the first day of the weekly forecast) use the nearest known one
+    bool isFoundTemperature = false;
+    std::int32_t maxTemperature = 0;
+    for (std::size_t i = 0; i < daily.DayCount && !isFoundTemperature; ++i) {
+        if (daily.HasMaxTemperature(i)) {
+            maxTemperature = daily.MaxTemperature[i];
+            isFoundTemperature = true;
+        }
+    }
+
+    const WateringSetting::WateringTypeDict& wateringTypeDict = wateringSetting.GetWateringTypeDict();
+    const std::size_t planDays = std::max<std::size_t>(daily.DayCount, 1);
+    for (std::size_t i = 0; i < planDays; ++i) {
+        std::tm dayTimeInfo = nowTimeInfo;
+        dayTimeInfo.tm_mday += static_cast<int>(i);
+        std::mktime(&dayTimeInfo);
+
+        if (daily.HasMaxTemperature(i)) {
+            maxTemperature = daily.MaxTemperature[i];
+        }
+        DailyPlan dailyPlan = {};
+        dailyPlan.Day = today + static_cast<std::int32_t>(i);
+        dailyPlan.IsForecast = daily.HasWeatherCode(i) && isFoundTemperature;
+        dailyPlan.WateringTypeName = FindWateringType(wateringSetting, dailyPlan.IsForecast,
+            dailyPlan.IsForecast && WeatherForecast::IsRainWeatherCode(daily.WeatherCode[i]), maxTemperature, dayTimeInfo.tm_mon + 1);
+
+        WateringSetting::WateringTypeDict::const_iterator iter = wateringTypeDict.find(dailyPlan.WateringTypeName);
+        if (iter != wateringTypeDict.end()) {
+            const std::int32_t lastWateringDuration = dailyPlan.Day - lastWateringDay;
+            dailyPlan.IsWatering = (iter->second.DaySpan <= lastWateringDuration);
+            if (dailyPlan.IsWatering) {
+                lastWateringDay = dailyPlan.Day;
+            }
+        }
+
+        ESP_LOGI(TAG, "Watering Plan Day+%u Type:%s Forecast:%d Watering:%d",
+            static_cast<unsigned int>(i), dailyPlan.WateringTypeName.c_str(), dailyPlan.IsForecast, dailyPlan.IsWatering);
+        m_WateringPlan.emplace_back(std::move(dailyPlan));
+    }
+}
+
+std::string ScheduleManager::FindWateringType(const WateringSetting& wateringSetting, const bool isForecast, const bool isRain, const std::int32_t maxTemperature, const int month)
+{
+    std::string wateringTypeStr;
+    if (!isForecast) {
+        // Reference from the monthly table and treat it as normal weather
+        const WateringSetting::MonthToTypeDict& monthToTypeDict = wateringSetting.GetMonthToTypeDict();
+        WateringSetting::MonthToTypeDict::const_iterator iter = monthToTypeDict.find(std::to_string(month));
+        if (iter != monthToTypeDict.end()) {
+            wateringTypeStr = iter->second;
+        }
+        return wateringTypeStr;
+    }
+
+    const WateringSetting::TemperatureWateringList& temperatureWateringList = wateringSetting.GetTemperatureWateringList();
+    for (const WateringSetting::TemperatureWatering& temperatureWatering : temperatureWateringList) {
+        if (temperatureWatering.Temperature <= maxTemperature) {
+            wateringTypeStr = isRain ? temperatureWatering.RainType : temperatureWatering.NormalType;
+        }
+    }
+    return wateringTypeStr;
+}
+
 int ScheduleManager::GetCurrentMonth() const
 {   
     return m_CurrentMonth;
@@ -195,14 +328,65 @@ void ScheduleManager::InitializeNewDay(const std::tm& nowTimeInfo)
         return;
     }
 
+    // The first day after the boot
+    const bool isBoot = (m_CurrentDay == 0);
     m_CurrentMonth = nowTimeInfo.tm_mon + 1;
     m_CurrentDay = nowTimeInfo.tm_mday;
 
     m_ScheduleList.clear();
+    m_WateringPlan.clear();
+    m_AdjustState = ADJUST_STATE_NONE;
     AddSchedule(std::make_unique<ScheduleAdjust>(irrigationInterface, 0, 30));
 
     WeatherForecast &weatherForecast = irrigationInterface->GetWeatherForecast();
     weatherForecast.Initialize();
+
+    // Restore the weather forecast snapshot after the reset, so the console has it before the first request
+    const WateringSetting& wateringSetting = irrigationInterface->GetWateringSetting();
+    if (isBoot && wateringSetting.IsActive() && wateringSetting.GetWateringMode() == WateringSetting::WATERING_MODE_ADVANCE) {
+        weatherForecast.WarmLoad(wateringSetting.GetJMAAreaPathCode(), wateringSetting.GetJMALocalCode(), wateringSetting.GetJMAAMeDAS());
+    }
+
+    irrigationInterface->GetStatusSnapshot().Invalidate();
+    PublishReload();
+}
+
+void ScheduleManager::InvalidateStatus()
+{
+    const IrrigationInterfaceSharedPtr irrigationInterface = m_pIrrigationInterface.lock();
+    if (irrigationInterface) {
+        irrigationInterface->GetStatusSnapshot().Invalidate();
+    }
+}
+
+void ScheduleManager::PublishScheduleStatus(const ScheduleBase& scheduleItem)
+{
+    const IrrigationInterfaceSharedPtr irrigationInterface = m_pIrrigationInterface.lock();
+    if (!irrigationInterface || !scheduleItem.IsVisible()) {
+        return;
+    }
+    char data[EVENT_DATA_SIZE];
+    JsonBufferSink sink(data, sizeof(data));
+    JsonWriter writer(sink);
+    writer.BeginObject()
+        .Key("name").String(scheduleItem.GetName())
+        .Key("hour").Int(scheduleItem.GetHour())
+        .Key("minute").Int(scheduleItem.GetMinute())
+        .Key("status").String(ScheduleBase::StatusToStr(scheduleItem.GetStatus()))
+    .EndObject();
+    if (!writer.Finish()) {
+        ESP_LOGW(TAG, "Schedule event is too long. %s", scheduleItem.GetName().c_str());
+        return;
+    }
+    irrigationInterface->GetEventStream().Publish(EventStream::EVENT_SCHEDULE, sink.GetView());
+}
+
+void ScheduleManager::PublishReload()
+{
+    const IrrigationInterfaceSharedPtr irrigationInterface = m_pIrrigationInterface.lock();
+    if (irrigationInterface) {
+        irrigationInterface->GetEventStream().Publish(EventStream::EVENT_RELOAD, "{}");
+    }
 }
 
 /// Add a schedule to the list
@@ -212,6 +396,22 @@ void ScheduleManager::AddSchedule(ScheduleBaseUniquePtr&& scheduleItem)
 }
 
 
+/// Remove the schedules except executed ones and Adjust
+void ScheduleManager::RemoveUnexecutedSchedule()
+{
+    m_ScheduleList.erase(
+        std::remove_if(
+            m_ScheduleList.begin(),
+            m_ScheduleList.end(),
+            [](const ScheduleBaseUniquePtr& pScheduleItem){
+                return pScheduleItem->GetStatus() != ScheduleBase::STATUS_EXECUTED &&
+                       pScheduleItem->GetName() != ScheduleAdjust::SCHEDULE_NAME;
+            }
+        ),
+        m_ScheduleList.end()
+    );
+}
+
 /// Disable a schedule whose execution time has already expired.
 void ScheduleManager::DisableExpiredSchedule(const std::tm& timeInfo)
 {
@@ -7,20 +7,44 @@
 #include "schedule_base.h"
 
 #include <chrono>
+#include <cstdint>
+#include <string>
 #include <vector>
 #include <memory>
 
 #include "irrigation_interface.h"
+#include "weather_forecast_daily.h"
 
 #include "schedule_base.h"
 
 namespace IrrigationSystem {
 
+class WateringSetting;
+
 class ScheduleManager final
 {
 public:
     using ScheduleBaseList = std::vector<ScheduleBaseUniquePtr>;
 
+    /// Watering plan of a day (advance mode)
+    struct DailyPlan
+    {
+        /// Util::DateToDayNumber
+        std::int32_t Day;
+        std::string WateringTypeName;
+        /// The weather forecast of the day was used (otherwise the monthly table)
+        bool IsForecast;
+        bool IsWatering;
+    };
+    using DailyPlanList = std::vector<DailyPlan>;
+
+    /// Waiting state of the weather forecast fetch
+    enum AdjustState : int {
+        ADJUST_STATE_NONE,
+        ADJUST_STATE_WAIT_FORECAST,
+        ADJUST_STATE_WAIT_RETRY,
+    };
+
 public:
     explicit ScheduleManager(const IrrigationInterfaceWeakPtr pIrrigationInterface);
 
@@ -31,6 +55,13 @@ public:
 
     const ScheduleBaseList& GetScheduleList() const;
 
+    /// Plan from today over the forecast horizon
+    const DailyPlanList& GetWateringPlan() const;
+
+    /// Start the schedule adjustment. (The weather forecast is fetched asynchronously in advance mode)
+    void RequestAdjustSchedule();
+
+    /// Create the day's schedule from the acquired (cached) weather forecast
     void AdjustSchedule();
 
     int GetCurrentMonth() const;
@@ -38,6 +69,31 @@ public:
 
 private:
 
+    /// Run AdjustSchedule when the forecast fetch has completed or its deadline has passed.
+    /// Adjust again when a retry succeeds after the deadline
+    void CheckPendingAdjust();
+
+    /// Retries must end before the earliest watering of the day
+    static std::time_t CalcRetryDeadlineEpoch(const WateringSetting& wateringSetting);
+
+    /// Plan the watering of the days covered by the daily forecast. (Planned watering is counted for DaySpan)
+    void PlanWatering(const WateringSetting& wateringSetting, const WeatherForecastDaily& daily, const std::tm& nowTimeInfo, const std::time_t lastWateringEpoch);
+
+    /// Watering type of the weather. (The monthly table when there is no forecast)
+    static std::string FindWateringType(const WateringSetting& wateringSetting, const bool isForecast, const bool isRain, const std::int32_t maxTemperature, const int month);
+
+    /// Remove the schedules except executed ones and Adjust
+    void RemoveUnexecutedSchedule();
+
+    /// The schedule or the plan changed (/api/status)
+    void InvalidateStatus();
+
+    /// Notify the console of the executed schedule (/api/events)
+    void PublishScheduleStatus(const ScheduleBase& scheduleItem);
+
+    /// Notify the console that the whole schedule has been replaced (/api/events)
+    void PublishReload();
+
     /// Add a schedule to the list
     void AddSchedule(ScheduleBaseUniquePtr&& scheduleItem);
 
@@ -55,7 +111,12 @@ private:
     ScheduleBaseList m_ScheduleList;
     int m_CurrentMonth;
     int m_CurrentDay;
-    
+
+    /// Waiting for the weather forecast fetch
+    AdjustState m_AdjustState;
+    std::time_t m_AdjustDeadlineEpoch;
+
+    DailyPlanList m_WateringPlan;
 };
 
 using ScheduleManagerSharedPtr = std::shared_ptr<ScheduleManager>;
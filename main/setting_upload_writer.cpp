@@ -0,0 +1,84 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include "setting_upload_writer.h"
+
+#include "logger.h"
+
+namespace IrrigationSystem {
+
+SettingUploadWriter::SettingUploadWriter(const char *const pFilePath, const char *const pFieldName, const std::size_t maxSize)
+    :m_FilePath(pFilePath)
+    ,m_FieldName(pFieldName)
+    ,m_MaxSize(maxSize)
+    ,m_File()
+    ,m_IsTarget(false)
+    ,m_IsComplete(false)
+    ,m_IsTooLarge(false)
+    ,m_WrittenSize(0)
+{}
+
+void SettingUploadWriter::Close()
+{
+    m_File.Close();
+}
+
+bool SettingUploadWriter::IsComplete() const
+{
+    return m_IsComplete;
+}
+
+bool SettingUploadWriter::IsTooLarge() const
+{
+    return m_IsTooLarge;
+}
+
+std::size_t SettingUploadWriter::GetWrittenSize() const
+{
+    return m_WrittenSize;
+}
+
+void SettingUploadWriter::OnPartBegin(const char *const pName)
+{
+    // The first field of the name is used
+    m_IsTarget = !m_IsComplete && m_FieldName == pName;
+    if (m_IsTarget) {
+        m_WrittenSize = 0;
+        m_IsTarget = m_File.Open(m_FilePath, "wb");
+    }
+}
+
+bool SettingUploadWriter::OnPartData(const char *const pData, const std::size_t length)
+{
+    if (!m_IsTarget) {
+        return true;
+    }
+    if (m_MaxSize < m_WrittenSize + length) {
+        ESP_LOGE(TAG, "Upload too large. max:%u", m_MaxSize);
+        m_IsTooLarge = true;
+        return false;
+    }
+    if (!m_File.Write(pData, length)) {
+        ESP_LOGE(TAG, "Failed to write the upload file");
+        return false;
+    }
+    m_WrittenSize += length;
+    return true;
+}
+
+void SettingUploadWriter::OnPartEnd()
+{
+    if (m_IsTarget) {
+        // The last block is flushed by the close
+        m_IsComplete = m_File.Close();
+        m_IsTarget = false;
+        if (!m_IsComplete) {
+            ESP_LOGE(TAG, "Failed to close the upload file");
+        }
+    }
+}
+
+} // IrrigationSystem
+
+// EOF
@@ -0,0 +1,56 @@
+#ifndef SETTING_UPLOAD_WRITER_H_
+#define SETTING_UPLOAD_WRITER_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include <cstddef>
+#include <string>
+
+#include "file_system.h"
+#include "multipart_parser.h"
+
+namespace IrrigationSystem {
+
+/// Writes a form field of the multipart upload to a file as it is received
+class SettingUploadWriter final : public MultipartParser::Listener
+{
+public:
+    SettingUploadWriter(const char *const pFilePath, const char *const pFieldName, const std::size_t maxSize);
+
+    /// Close the file
+    void Close();
+
+    /// The field has been written completely
+    bool IsComplete() const;
+
+    /// The field exceeded maxSize
+    bool IsTooLarge() const;
+
+    std::size_t GetWrittenSize() const;
+
+private:
+    /// (MultipartParser::Listener:override)
+    void OnPartBegin(const char *const pName) override;
+
+    /// (MultipartParser::Listener:override)
+    bool OnPartData(const char *const pData, const std::size_t length) override;
+
+    /// (MultipartParser::Listener:override)
+    void OnPartEnd() override;
+
+private:
+    const std::string m_FilePath;
+    const std::string m_FieldName;
+    const std::size_t m_MaxSize;
+    FileSystem::File m_File;
+    bool m_IsTarget;
+    bool m_IsComplete;
+    bool m_IsTooLarge;
+    std::size_t m_WrittenSize;
+};
+
+} // IrrigationSystem
+
+#endif // SETTING_UPLOAD_WRITER_H_
+// EOF
@@ -0,0 +1,135 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include "static_asset.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include <esp_rom_crc.h>
+
+#include "logger.h"
+
+// Web console assets (gzip. Only the ones of the console in use are linked)
+#if CONFIG_HTTPD_SERVER_RENDERED_CONSOLE
+extern const std::uint8_t CONSOLE_CSS_GZ_START[] asm("_binary_console_css_gz_start");
+extern const std::uint8_t CONSOLE_CSS_GZ_END[] asm("_binary_console_css_gz_end");
+extern const std::uint8_t CONSOLE_JS_GZ_START[] asm("_binary_console_js_gz_start");
+extern const std::uint8_t CONSOLE_JS_GZ_END[] asm("_binary_console_js_gz_end");
+#else
+extern const std::uint8_t CONSOLE_HTML_GZ_START[] asm("_binary_console_html_gz_start");
+extern const std::uint8_t CONSOLE_HTML_GZ_END[] asm("_binary_console_html_gz_end");
+#endif
+
+namespace {
+    /// The uri does not change between firmware versions, the query does
+    constexpr char CACHE_CONTROL[] = "public, max-age=31536000, immutable";
+    /// The uri of the page does not change. The ETag is checked (304) on every load
+    constexpr char CACHE_CONTROL_REVALIDATE[] = "no-cache";
+    constexpr std::size_t IF_NONE_MATCH_LENGTH = 128;
+}
+
+namespace IrrigationSystem {
+
+namespace {
+#if CONFIG_HTTPD_SERVER_RENDERED_CONSOLE
+    const StaticAsset STYLE_SHEET("/console.css", "text/css", CONSOLE_CSS_GZ_START, CONSOLE_CSS_GZ_END, true);
+    const StaticAsset SCRIPT("/console.js", "application/javascript", CONSOLE_JS_GZ_START, CONSOLE_JS_GZ_END, true);
+    const StaticAsset *const ASSET_TABLE[] = {
+        &STYLE_SHEET,
+        &SCRIPT,
+    };
+#else
+    const StaticAsset CONSOLE_PAGE("/", "text/html", CONSOLE_HTML_GZ_START, CONSOLE_HTML_GZ_END, false);
+    const StaticAsset *const ASSET_TABLE[] = {
+        &CONSOLE_PAGE,
+    };
+#endif
+}
+
+StaticAsset::StaticAsset(const char *const uri, const char *const contentType, const std::uint8_t *const pBegin, const std::uint8_t *const pEnd, const bool isVersioned)
+    :m_Uri(uri)
+    ,m_ContentType(contentType)
+    ,m_pBegin(pBegin)
+    ,m_Size(pEnd - pBegin)
+    ,m_IsVersioned(isVersioned)
+    ,m_ETag()
+{
+    // Content hash. (Computed once at startup)
+    const std::uint32_t crc = esp_rom_crc32_le(0, m_pBegin, m_Size);
+    std::snprintf(m_ETag, sizeof(m_ETag), "\"%08x%04x\"", static_cast<unsigned int>(crc), static_cast<unsigned int>(m_Size & 0xFFFF));
+}
+
+const char* StaticAsset::GetUri() const
+{
+    return m_Uri;
+}
+
+const char* StaticAsset::GetETag() const
+{
+    return m_ETag;
+}
+
+const char* StaticAsset::GetVersion() const
+{
+    return m_ETag + 1;
+}
+
+esp_err_t StaticAsset::Send(httpd_req_t *const pHttpRequestData) const
+{
+    httpd_resp_set_hdr(pHttpRequestData, "ETag", m_ETag);
+    httpd_resp_set_hdr(pHttpRequestData, "Cache-Control", m_IsVersioned ? CACHE_CONTROL : CACHE_CONTROL_REVALIDATE);
+    if (IsNotModified(pHttpRequestData)) {
+        httpd_resp_set_status(pHttpRequestData, "304 Not Modified");
+        return httpd_resp_send(pHttpRequestData, nullptr, 0);
+    }
+
+    // Only the compressed form is embedded (every browser accepts gzip)
+    httpd_resp_set_type(pHttpRequestData, m_ContentType);
+    httpd_resp_set_hdr(pHttpRequestData, "Content-Encoding", "gzip");
+    httpd_resp_set_hdr(pHttpRequestData, "Vary", "Accept-Encoding");
+    return httpd_resp_send(pHttpRequestData, reinterpret_cast<const char*>(m_pBegin), m_Size);
+}
+
+const StaticAsset* StaticAsset::Find(const char *const uri)
+{
+    const std::size_t uriLength = std::strcspn(uri, "?");
+    for (const StaticAsset *const pAsset : ASSET_TABLE) {
+        if (std::strlen(pAsset->m_Uri) == uriLength && std::strncmp(pAsset->m_Uri, uri, uriLength) == 0) {
+            return pAsset;
+        }
+    }
+    return nullptr;
+}
+
+#if CONFIG_HTTPD_SERVER_RENDERED_CONSOLE
+const StaticAsset& StaticAsset::GetStyleSheet()
+{
+    return STYLE_SHEET;
+}
+
+const StaticAsset& StaticAsset::GetScript()
+{
+    return SCRIPT;
+}
+#else
+const StaticAsset& StaticAsset::GetConsolePage()
+{
+    return CONSOLE_PAGE;
+}
+#endif
+
+bool StaticAsset::IsNotModified(httpd_req_t *const pHttpRequestData) const
+{
+    char ifNoneMatch[IF_NONE_MATCH_LENGTH] = {};
+    if (httpd_req_get_hdr_value_str(pHttpRequestData, "If-None-Match", ifNoneMatch, sizeof(ifNoneMatch)) != ESP_OK) {
+        return false;
+    }
+    // A list of ETags or "*"
+    return std::strstr(ifNoneMatch, m_ETag) != nullptr || std::strcmp(ifNoneMatch, "*") == 0;
+}
+
+} // IrrigationSystem
+
+// EOF
@@ -0,0 +1,64 @@
+#ifndef STATIC_ASSET_H_
+#define STATIC_ASSET_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// Web console assets embedded at build time
+
+// Include ----------------------
+#include <cstddef>
+#include <cstdint>
+
+#include <esp_http_server.h>
+
+namespace IrrigationSystem {
+
+/// gzip precompressed asset (target_add_binary_data)
+/// It is served as is with a strong ETag of its content. A versioned asset is linked with the ETag
+/// in the query (e.g. /console.css?v=...), so browsers may keep it for a long time.
+/// The others (the console page) are revalidated on every load.
+class StaticAsset final
+{
+public:
+    static constexpr std::size_t ETAG_LENGTH = 24;
+
+public:
+    StaticAsset(const char *const uri, const char *const contentType, const std::uint8_t *const pBegin, const std::uint8_t *const pEnd, const bool isVersioned);
+
+    const char* GetUri() const;
+
+    /// Quoted strong ETag
+    const char* GetETag() const;
+
+    /// Version query for the link (the ETag without quotes)
+    const char* GetVersion() const;
+
+    /// Send the asset or 304 Not Modified (If-None-Match)
+    esp_err_t Send(httpd_req_t *const pHttpRequestData) const;
+
+    /// Asset of the request uri (the query is ignored)
+    static const StaticAsset* Find(const char *const uri);
+
+#if CONFIG_HTTPD_SERVER_RENDERED_CONSOLE
+    static const StaticAsset& GetStyleSheet();
+    static const StaticAsset& GetScript();
+#else
+    /// Single page console (the stylesheet and the script are inlined)
+    static const StaticAsset& GetConsolePage();
+#endif
+
+private:
+    bool IsNotModified(httpd_req_t *const pHttpRequestData) const;
+
+private:
+    const char *const m_Uri;
+    const char *const m_ContentType;
+    const std::uint8_t *const m_pBegin;
+    const std::size_t m_Size;
+    const bool m_IsVersioned;
+    char m_ETag[ETAG_LENGTH];
+};
+
+} // IrrigationSystem
+
+#endif // STATIC_ASSET_H_
+// EOF
@@ -0,0 +1,231 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include "status_snapshot.h"
+
+#include <esp_random.h>
+
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+
+#include "logger.h"
+#include "wait_scope.h"
+#include "util.h"
+#include "irrigation_interface.h"
+#include "schedule_manager.h"
+#include "weather_forecast.h"
+#include "watering_setting.h"
+#include "json_writer.h"
+
+namespace IrrigationSystem {
+
+namespace {
+
+/// Reserved size of the body (Typical document fits without a reallocation)
+constexpr std::size_t BODY_RESERVE_SIZE = 1024;
+
+std::int32_t ToCenti(const float value)
+{
+    return static_cast<std::int32_t>(std::lround(value * 100.0f));
+}
+
+} // namespace
+
+StatusSnapshot::StatusSnapshot()
+    :m_IsInvalid(true)
+    ,m_EventGroup(xEventGroupCreate())
+    ,m_Mutex()
+    ,m_pDocument()
+    ,m_BootId(esp_random())
+    ,m_Fingerprint()
+    ,m_SerializeEpoch(0)
+    ,m_RenderBody()
+{}
+
+StatusSnapshot::~StatusSnapshot()
+{
+    if (m_EventGroup) {
+        vEventGroupDelete(m_EventGroup);
+    }
+}
+
+void StatusSnapshot::Invalidate()
+{
+    m_IsInvalid.store(true, std::memory_order_release);
+    xEventGroupSetBits(m_EventGroup, INVALIDATE_BIT);
+}
+
+bool StatusSnapshot::WaitInvalidate(const int waitMillisecond)
+{
+    const EventBits_t bits = xEventGroupWaitBits(m_EventGroup, INVALIDATE_BIT, pdTRUE, pdFALSE, pdMS_TO_TICKS(waitMillisecond));
+    return (bits & INVALIDATE_BIT) != 0;
+}
+
+StatusSnapshot::DocumentConstSharedPtr StatusSnapshot::GetDocument() const
+{
+    std::unique_lock<std::mutex> lock(m_Mutex, std::defer_lock);
+    {
+        // Held only to copy the pointer
+        const WaitScope waitScope;
+        lock.lock();
+    }
+    return m_pDocument;
+}
+
+StatusSnapshot::DocumentConstSharedPtr StatusSnapshot::Refresh(IrrigationInterface& irrigationInterface)
+{
+    // m_pDocument is replaced only here, so it is read without the lock
+    const std::time_t nowEpoch = Util::GetEpoch();
+    const Fingerprint fingerprint = MakeFingerprint(irrigationInterface);
+    const bool isChanged = fingerprint.ValveCloseEpoch != m_Fingerprint.ValveCloseEpoch
+        || fingerprint.VoltageCenti != m_Fingerprint.VoltageCenti
+        || fingerprint.WaterLevelPercent != m_Fingerprint.WaterLevelPercent;
+    const bool isExpired = CONFIG_STATUS_SNAPSHOT_MAX_AGE_SECOND <= nowEpoch - m_SerializeEpoch;
+    const bool isInvalid = m_IsInvalid.exchange(false, std::memory_order_acq_rel);
+    if (m_pDocument && !isInvalid && !isChanged && !isExpired) {
+        return m_pDocument;
+    }
+
+    // Rendered with the next generation into the reused buffer (no allocation while the content stays the same)
+    const std::uint32_t generation = m_pDocument ? m_pDocument->Generation + 1 : 1;
+    m_RenderBody.clear();
+    m_RenderBody.reserve(BODY_RESERVE_SIZE);
+    JsonStringSink sink(m_RenderBody);
+    JsonWriter writer(sink);
+    writer.BeginObject()
+        .Key("generation").Int(generation)
+        .Key("updated_epoch").Int(nowEpoch);
+    writer.Flush();
+    const std::size_t payloadOffset = m_RenderBody.size();
+    Serialize(irrigationInterface, writer);
+    writer.EndObject();
+    if (!writer.Finish()) {
+        ESP_LOGE(TAG, "Failed StatusSnapshot json");
+        return m_pDocument;
+    }
+    m_Fingerprint = fingerprint;
+    m_SerializeEpoch = nowEpoch;
+
+    // The generation (and the ETag) changes only when the content has changed
+    if (m_pDocument && m_pDocument->Body.compare(m_pDocument->PayloadOffset, std::string::npos, m_RenderBody, payloadOffset, std::string::npos) == 0) {
+        return m_pDocument;
+    }
+
+    std::shared_ptr<Document> pDocument = std::make_shared<Document>();
+    pDocument->Generation = generation;
+    pDocument->Body = m_RenderBody;
+    pDocument->PayloadOffset = payloadOffset;
+    std::snprintf(pDocument->ETag, sizeof(pDocument->ETag), "\"%08" PRIx32 "-%" PRIu32 "\"", m_BootId, pDocument->Generation);
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_pDocument = std::move(pDocument);
+    }
+    ESP_LOGD(TAG, "StatusSnapshot generation:%" PRIu32 " size:%u", m_pDocument->Generation, m_pDocument->Body.size());
+
+    return m_pDocument;
+}
+
+StatusSnapshot::Fingerprint StatusSnapshot::MakeFingerprint(const IrrigationInterface& irrigationInterface)
+{
+    Fingerprint fingerprint = {};
+    fingerprint.ValveCloseEpoch = irrigationInterface.ValveCloseEpoch();
+    fingerprint.VoltageCenti = ToCenti(irrigationInterface.GetMainVoltage());
+    fingerprint.WaterLevelPercent = ToCenti(irrigationInterface.GetWaterLevel());
+    return fingerprint;
+}
+
+void StatusSnapshot::Serialize(IrrigationInterface& irrigationInterface, JsonWriter& writer)
+{
+    // Setting
+    const WateringSetting& wateringSetting = irrigationInterface.GetWateringSetting();
+    writer.Key("setting").BeginObject()
+        .Key("active").Bool(wateringSetting.IsActive())
+        .Key("mode").Int(wateringSetting.GetWateringMode())
+    .EndObject();
+
+    // Schedule
+    writer.Key("schedule").BeginObject();
+    const ScheduleManagerSharedPtr scheduleManager = irrigationInterface.GetScheduleManager().lock();
+    if (scheduleManager) {
+        writer
+            .Key("month").Int(scheduleManager->GetCurrentMonth())
+            .Key("day").Int(scheduleManager->GetCurrentDay())
+            .Key("last_watering_epoch").Int(irrigationInterface.GetLastWateringEpoch());
+
+        writer.Key("items").BeginArray();
+        for (const ScheduleBaseUniquePtr& pScheduleItem : scheduleManager->GetScheduleList()) {
+            if (!pScheduleItem->IsVisible()) {
+                continue;
+            }
+            writer.BeginObject()
+                .Key("name").String(pScheduleItem->GetName())
+                .Key("hour").Int(pScheduleItem->GetHour())
+                .Key("minute").Int(pScheduleItem->GetMinute())
+                .Key("status").String(ScheduleBase::StatusToStr(pScheduleItem->GetStatus()))
+            .EndObject();
+        }
+        writer.EndArray();
+
+        writer.Key("plan").BeginArray();
+        const ScheduleManager::DailyPlanList& wateringPlan = scheduleManager->GetWateringPlan();
+        for (const ScheduleManager::DailyPlan& dailyPlan : wateringPlan) {
+            writer.BeginObject()
+                .Key("day_offset").Int(dailyPlan.Day - wateringPlan.front().Day)
+                .Key("type").String(dailyPlan.WateringTypeName)
+                .Key("watering").Bool(dailyPlan.IsWatering)
+                .Key("forecast").Bool(dailyPlan.IsForecast)
+            .EndObject();
+        }
+        writer.EndArray();
+    }
+    writer.EndObject();
+
+    // Valve
+    const std::time_t closeEpoch = irrigationInterface.ValveCloseEpoch();
+    writer.Key("valve").BeginObject()
+        .Key("open").Bool(closeEpoch != 0)
+        .Key("close_epoch").Int(closeEpoch)
+    .EndObject();
+
+    // Weather forecast
+    const WeatherForecast& weatherForecast = irrigationInterface.GetWeatherForecast();
+    const int weatherCode = weatherForecast.GetCurrentWeatherCode();
+    writer.Key("forecast").BeginObject()
+        .Key("status").Int(weatherForecast.GetRequestStatus())
+        .Key("weather_code").Int(weatherCode)
+        // Names for the console (rendered by the browser)
+        .Key("weather_name").BeginObject()
+            .Key("en").String(WeatherForecast::WeatherCodeToStr(weatherCode, WeatherForecast::LANGUAGE_EN))
+            .Key("ja").String(WeatherForecast::WeatherCodeToStr(weatherCode, WeatherForecast::LANGUAGE_JA))
+        .EndObject()
+        .Key("max_temperature").Int(weatherForecast.GetCurrentMaxTemperature());
+    writer.Key("days").BeginArray();
+    const WeatherForecastDaily daily = weatherForecast.GetDailyForecast();
+    for (std::size_t i = 0; i < daily.DayCount; ++i) {
+        writer.BeginObject().Key("weather_code");
+        if (daily.HasWeatherCode(i)) {
+            writer.Int(daily.WeatherCode[i]);
+        } else {
+            writer.Null();
+        }
+        writer.Key("max_temperature");
+        if (daily.HasMaxTemperature(i)) {
+            writer.Int(daily.MaxTemperature[i]);
+        } else {
+            writer.Null();
+        }
+        writer.EndObject();
+    }
+    writer.EndArray().EndObject();
+
+    // Sensor
+    writer
+        .Key("voltage").Scaled(ToCenti(irrigationInterface.GetMainVoltage()), 2)
+        .Key("water_level").Scaled(ToCenti(irrigationInterface.GetWaterLevel()), 2);
+}
+
+} // IrrigationSystem
+
+// EOF
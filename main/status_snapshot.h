@@ -0,0 +1,95 @@
+#ifndef STATUS_SNAPSHOT_H_
+#define STATUS_SNAPSHOT_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// Pre-serialized system status (/api/status)
+
+// Include ----------------------
+#include <esp_bit_defs.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace IrrigationSystem {
+
+class IrrigationInterface;
+class JsonWriter;
+
+/// System status json
+/// The document is serialized once per state change by the management task and shared by all readers.
+/// A reader gets the current immutable body and sends it without a render or a copy.
+class StatusSnapshot final
+{
+public:
+    static constexpr std::size_t ETAG_LENGTH = 24;
+
+    /// Event bits
+    static constexpr EventBits_t INVALIDATE_BIT = BIT0;
+
+    /// Serialized document
+    struct Document
+    {
+        std::string Body;
+        /// Start of the state members in the body (after generation and updated_epoch)
+        std::size_t PayloadOffset;
+        /// Incremented when the body changes
+        std::uint32_t Generation;
+        /// Quoted strong ETag (boot id and generation)
+        char ETag[ETAG_LENGTH];
+    };
+    using DocumentConstSharedPtr = std::shared_ptr<const Document>;
+
+private:
+    /// Values that change without a notification (compared on every refresh)
+    struct Fingerprint
+    {
+        std::time_t ValveCloseEpoch;
+        std::int32_t VoltageCenti;
+        std::int32_t WaterLevelPercent;
+    };
+
+public:
+    StatusSnapshot();
+    ~StatusSnapshot();
+
+    /// Mark the document outdated and wake the management task (schedule, forecast, setting, record or valve changed). Any task
+    void Invalidate();
+
+    /// Wait until invalidated or timed out. Return true if invalidated (management task)
+    bool WaitInvalidate(const int waitMillisecond);
+
+    /// Serialize again if outdated. Return the current document (management task only)
+    DocumentConstSharedPtr Refresh(IrrigationInterface& irrigationInterface);
+
+    /// Current document (nullptr until the first refresh). Any task
+    DocumentConstSharedPtr GetDocument() const;
+
+private:
+    static Fingerprint MakeFingerprint(const IrrigationInterface& irrigationInterface);
+    /// State members of the document (into the open object)
+    static void Serialize(IrrigationInterface& irrigationInterface, JsonWriter& writer);
+
+private:
+    std::atomic<bool> m_IsInvalid;
+    EventGroupHandle_t m_EventGroup;
+    /// Guards the replacement of m_pDocument (the render runs outside)
+    mutable std::mutex m_Mutex;
+    DocumentConstSharedPtr m_pDocument;
+    const std::uint32_t m_BootId;
+    // Used only by the refresh (management task)
+    Fingerprint m_Fingerprint;
+    std::time_t m_SerializeEpoch;
+    /// Render buffer (compared with the current document)
+    std::string m_RenderBody;
+};
+
+} // IrrigationSystem
+
+#endif // STATUS_SNAPSHOT_H_
+// EOF
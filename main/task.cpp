@@ -7,19 +7,33 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 
+#include <cstdio>
+#include <mutex>
+
 namespace IrrigationSystem {
 
+namespace {
+
+/// Held while a task is removed (and its handle cleared) and while a stack is sampled,
+/// so a handle is never used after vTaskDelete
+std::mutex s_RunningTaskMutex;
+Task* s_RunningTaskList[Task::MAX_RUNNING_TASK] = {};
+
+} // namespace
+
 
 Task::Task(const std::string& taskName, const int priority, const int coreId)
     :m_Status(TASK_STATUS_READY)
     ,m_TaskName(taskName)
     ,m_Priority(priority)
     ,m_CoreId(coreId)
+    ,m_TaskHandle(nullptr)
 {}
 
 Task::~Task()
 {
     Stop();
+    Unregister();
 }
 
 void Task::Start()
@@ -28,7 +42,11 @@ void Task::Start()
         return;
     }
     m_Status = TASK_STATUS_RUN;
-    xTaskCreatePinnedToCore(this->Listener, m_TaskName.c_str(), TASK_STAC_DEPTH, this, m_Priority, nullptr, m_CoreId);
+    // Listed before the task can end (the task sets its handle)
+    Register();
+    if (xTaskCreatePinnedToCore(this->Listener, m_TaskName.c_str(), TASK_STAC_DEPTH, this, m_Priority, nullptr, m_CoreId) != pdPASS) {
+        Unregister();
+    }
 }
 
 void Task::Stop()
@@ -48,14 +66,67 @@ void Task::Run()
 }
 
 
+const std::string& Task::GetTaskName() const
+{
+    return m_TaskName;
+}
+
+bool Task::SampleRunningTask(const std::size_t index, char *const pTaskName, const std::size_t taskNameSize, std::uint32_t& stackHighWaterMark)
+{
+    if (MAX_RUNNING_TASK <= index || taskNameSize == 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(s_RunningTaskMutex);
+    const Task *const pTask = s_RunningTaskList[index];
+    if (!pTask) {
+        return false;
+    }
+    const TaskHandle_t taskHandle = pTask->m_TaskHandle.load();
+    if (!taskHandle) {
+        // Not started yet or ending
+        return false;
+    }
+    // Copied (the task may be destroyed after the lock)
+    std::snprintf(pTaskName, taskNameSize, "%s", pTask->m_TaskName.c_str());
+    // ESP-IDF counts the stack in bytes
+    stackHighWaterMark = uxTaskGetStackHighWaterMark(taskHandle);
+    return true;
+}
+
 void Task::Listener(void *const pParam)
 {
     if (pParam) {
-        static_cast<Task*>(pParam)->Run();
+        Task *const pTask = static_cast<Task*>(pParam);
+        pTask->m_TaskHandle.store(xTaskGetCurrentTaskHandle());
+        pTask->Run();
+        // Off the list before the handle becomes invalid
+        pTask->Unregister();
     }
     vTaskDelete(nullptr);
 }
 
+void Task::Register()
+{
+    std::lock_guard<std::mutex> lock(s_RunningTaskMutex);
+    for (Task*& pRunningTask : s_RunningTaskList) {
+        if (!pRunningTask) {
+            pRunningTask = this;
+            return;
+        }
+    }
+}
+
+void Task::Unregister()
+{
+    std::lock_guard<std::mutex> lock(s_RunningTaskMutex);
+    for (Task*& pRunningTask : s_RunningTaskList) {
+        if (pRunningTask == this) {
+            pRunningTask = nullptr;
+        }
+    }
+    m_TaskHandle.store(nullptr);
+}
+
 
 } // IrrigationSystem
 
@@ -4,6 +4,12 @@
 // (C)2021 bekki.jp
 
 // Include ----------------------
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 namespace IrrigationSystem {
@@ -20,6 +26,9 @@ public:
 
     static constexpr int TASK_STAC_DEPTH = 8192;
 
+    /// Number of the running tasks listed for the metrics
+    static constexpr std::size_t MAX_RUNNING_TASK = 16;
+
     /// Task Priority
     static constexpr int PRIORITY_LOW = 0;
     static constexpr int PRIORITY_NORMAL = 1;
@@ -44,6 +53,12 @@ public:
     /// (override) sub class processing
     virtual void Update() = 0;
 
+    const std::string& GetTaskName() const;
+
+    /// Name and minimum free stack since the start (byte) of the running task of the slot.
+    /// Return false if the slot is empty or the task is ending (sampled under the running task list lock)
+    static bool SampleRunningTask(const std::size_t index, char *const pTaskName, const std::size_t taskNameSize, std::uint32_t& stackHighWaterMark);
+
 public:
     /// Task Running
     void Run();
@@ -51,6 +66,11 @@ public:
     /// Task Listener
     static void Listener(void *const pParam);
 
+private:
+    /// Add to / Remove from the running task list
+    void Register();
+    void Unregister();
+
 protected:
     /// Task Status
     TaskStatus m_Status;
@@ -63,6 +83,9 @@ protected:
 
     /// Use Core Id
     int m_CoreId;
+
+    /// FreeRTOS task (set by the task itself, nullptr once it is ending)
+    std::atomic<TaskHandle_t> m_TaskHandle;
 };
 
 } // IrrigationSystem
@@ -113,23 +113,27 @@ int32_t GregToMJD(const std::tm& timeInfo)
          - 678912;
 }
 
-/// Get ChronoMinutes from hours and minutes.
-std::chrono::minutes GetChronoHourMinutes(const std::tm& timeInfo)
+/// Date to the number of days since 1970-01-01 (proleptic Gregorian calendar)
+int32_t DateToDayNumber(const int year, const int month, const int day)
 {
-    return std::chrono::hours(timeInfo.tm_hour) + std::chrono::minutes(timeInfo.tm_min);
+    // The year starts in March so that the leap day is the last day
+    const int32_t y = (month <= 2) ? year - 1 : year;
+    const int32_t era = ((0 <= y) ? y : y - 399) / 400;
+    const int32_t yearOfEra = y - era * 400;
+    const int32_t dayOfYear = (153 * (month + ((2 < month) ? -3 : 9)) + 2) / 5 + day - 1;
+    const int32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
 }
 
-std::vector<std::string> SplitString(const std::string &str, const char delim)
+int32_t DateToDayNumber(const std::tm& timeInfo)
 {
-    std::vector<std::string> elements;
-    std::stringstream ss(str);
-    std::string item;
-    while (getline(ss, item, delim)) {
-        if (!item.empty()) {
-            elements.push_back(item);
-        }
-    }
-    return elements;
+    return DateToDayNumber(timeInfo.tm_year + 1900, timeInfo.tm_mon + 1, timeInfo.tm_mday);
+}
+
+/// Get ChronoMinutes from hours and minutes.
+std::chrono::minutes GetChronoHourMinutes(const std::tm& timeInfo)
+{
+    return std::chrono::hours(timeInfo.tm_hour) + std::chrono::minutes(timeInfo.tm_min);
 }
 
 
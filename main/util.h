@@ -39,12 +39,13 @@ void InitTimeZone();
 /// Gregorian calendar to Modified Julian Date(修正ユリウス日)
 int32_t GregToMJD(const std::tm& timeInfo);
 
+/// Date to the number of days since 1970-01-01 (The time of day is ignored)
+int32_t DateToDayNumber(const int year, const int month, const int day);
+int32_t DateToDayNumber(const std::tm& timeInfo);
+
 /// Get ChronoMinutes from hours and minutes.
 std::chrono::minutes GetChronoHourMinutes(const std::tm& timeInfo);
 
-/// Split Text
-std::vector<std::string> SplitString(const std::string &str, const char delim);
-
 /// GetVoltage
 float GetVoltage();
 
@@ -4,22 +4,38 @@
 // Include ----------------------
 #include "valve_task.h"
 
+#include <esp_timer.h>
+
 #include <cmath>
 
 #include "logger.h"
 #include "util.h"
+#include "json_writer.h"
 #include "watering_setting.h"
 #include "gpio_control.h"
 #include "irrigation_interface.h"
+#include "event_stream.h"
+#include "status_snapshot.h"
+#include "metrics.h"
 
 namespace IrrigationSystem {
 
+namespace {
+
+Metric s_ValveOpenMetric("irrigation_valve_open_total", "Valve openings", Metric::TYPE_COUNTER);
+Metric s_ValveOpenSecondMetric("irrigation_valve_open_seconds_total", "Time the valve has been open", Metric::TYPE_COUNTER);
+
+} // namespace
+
 ValveTask::ValveTask(const IrrigationInterfaceWeakPtr pIrrigationInterface)
     :Task(TASK_NAME, PRIORITY, CORE_ID)
     ,m_pIrrigationInterface(pIrrigationInterface)
     ,m_IsTimerOpen(false)
     ,m_IsForceOpen(false)
     ,m_CloseEpoch(0)
+    ,m_IsOpen(false)
+    ,m_OpenTime(0)
+    ,m_OpenRemainderMicrosecond(0)
 {
     constexpr uint32_t VALVE_FREQUENCY = 10000; // 10kHz
     constexpr ledc_timer_t VALVE_LEDC_TIMER = LEDC_TIMER_0;
@@ -83,8 +99,8 @@ std::time_t ValveTask::GetCloseEpoch() const
 void ValveTask::SetValve()
 {
     ESP_LOGI(TAG, "Valve: TimerOpen:%d Force:%d", m_IsTimerOpen, m_IsForceOpen);
-#if CONFIG_IS_ENABLE_VOLTAGE_CHECK
     const IrrigationInterfaceSharedPtr irrigationInterface = m_pIrrigationInterface.lock();
+#if CONFIG_IS_ENABLE_VOLTAGE_CHECK
     if (!irrigationInterface) {
         return;
     }
@@ -103,12 +119,52 @@ void ValveTask::SetValve()
     const float rate = (m_IsTimerOpen || m_IsForceOpen) ? 1.0f : 0.0f;
 #endif
     m_pwm.SetRate(rate);
+    CountOpenTime(0.0f < rate);
+
+    if (!irrigationInterface) {
+        return;
+    }
+
+    char data[64];
+    JsonBufferSink sink(data, sizeof(data));
+    JsonWriter writer(sink);
+    writer.BeginObject()
+        .Key("open").Bool(0.0f < rate)
+        .Key("force").Bool(m_IsForceOpen)
+        .Key("close_epoch").Int(GetCloseEpoch())
+    .EndObject();
+    // Serialized before the clients reload the status on the event
+    irrigationInterface->GetStatusSnapshot().Invalidate();
+    if (writer.Finish()) {
+        irrigationInterface->GetEventStream().Publish(EventStream::EVENT_VALVE, sink.GetView());
+    }
 
 #if CONFIG_IS_ENABLE_WATER_LEVEL_CHECK
     irrigationInterface->CheckWaterLevel();
 #endif
 }
 
+void ValveTask::CountOpenTime(const bool isOpen)
+{
+    if (isOpen == m_IsOpen) {
+        return;
+    }
+    m_IsOpen = isOpen;
+
+    const std::int64_t nowTime = esp_timer_get_time();
+    if (isOpen) {
+        s_ValveOpenMetric.Add();
+        m_OpenTime = nowTime;
+        return;
+    }
+
+    // The fraction of a second is carried over to the next opening
+    static constexpr std::int64_t SECOND_TO_MICRO = 1000 * 1000;
+    const std::int64_t openMicrosecond = nowTime - m_OpenTime + m_OpenRemainderMicrosecond;
+    s_ValveOpenSecondMetric.Add(static_cast<std::uint32_t>(openMicrosecond / SECOND_TO_MICRO));
+    m_OpenRemainderMicrosecond = openMicrosecond % SECOND_TO_MICRO;
+}
+
 } // IrrigationSystem
 
 // EOF
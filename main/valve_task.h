@@ -7,6 +7,7 @@
 #include <soc/soc.h>
 
 #include <chrono>
+#include <cstdint>
 #include <memory>
 
 #include "task.h"
@@ -40,11 +41,18 @@ public:
 private:
     void SetValve();
 
+    /// Valve open time metrics
+    void CountOpenTime(const bool isOpen);
+
 private:
     const IrrigationInterfaceWeakPtr m_pIrrigationInterface;
     bool m_IsTimerOpen;
     bool m_IsForceOpen;
     std::time_t m_CloseEpoch;
+    bool m_IsOpen;
+    /// esp_timer time of the opening
+    std::int64_t m_OpenTime;
+    std::int64_t m_OpenRemainderMicrosecond;
     Pwm m_pwm;
 };
 
@@ -4,31 +4,112 @@
 // Include ----------------------
 #include "voltage_check_task.h"
 
+#include <esp_timer.h>
+
 #include "logger.h"
 #include "util.h"
+#include "json_writer.h"
 
 namespace IrrigationSystem {
 
-VoltageCheckTask::VoltageCheckTask()
+namespace {
+
+constexpr std::int64_t MICRO_TO_MILLI = 1000;
+constexpr std::int64_t SECOND_TO_MICRO = 1000 * 1000;
+
+} // namespace
+
+VoltageCheckTask::VoltageCheckTask(EventStream& eventStream)
     :Task(TASK_NAME, PRIORITY, CORE_ID)
+    ,m_EventStream(eventStream)
+    ,m_EventGroup(xEventGroupCreate())
+    ,m_Mutex()
     ,m_Voltage(0.0f)
+    ,m_SampleTime(0)
+    ,m_NextSampleTime(0)
+    ,m_IsSampleRequested(false)
 {}
 
+VoltageCheckTask::~VoltageCheckTask()
+{
+    if (m_EventGroup) {
+        vEventGroupDelete(m_EventGroup);
+    }
+}
+
 void VoltageCheckTask::Initialize() {}
 
 void VoltageCheckTask::Update()
 {
-    m_Voltage = Util::GetVoltage();
+    // Hourly, or earlier when a reader found the sample stale
+    static constexpr int WAIT_MILLISECOND = 1000;
+    const EventBits_t bits = xEventGroupWaitBits(m_EventGroup, SAMPLE_REQUEST_BIT, pdTRUE, pdFALSE, pdMS_TO_TICKS(WAIT_MILLISECOND));
+    const std::int64_t nowTime = esp_timer_get_time();
+    if ((bits & SAMPLE_REQUEST_BIT) == 0 && nowTime < m_NextSampleTime) {
+        return;
+    }
+
+    const float voltage = Util::GetVoltage();
+    const std::int64_t sampleTime = esp_timer_get_time();
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Voltage = voltage;
+        m_SampleTime = sampleTime;
+    }
+    m_IsSampleRequested.store(false);
 
-    static const int32_t NEXT_CHECK_MILLISECOND = 60 * 60 * 1000;
-    Util::SleepMillisecond(NEXT_CHECK_MILLISECOND);
+    static constexpr std::int64_t NEXT_CHECK_MICROSECOND = 60 * 60 * SECOND_TO_MICRO;
+    m_NextSampleTime = sampleTime + NEXT_CHECK_MICROSECOND;
+
+    char data[32];
+    JsonBufferSink sink(data, sizeof(data));
+    JsonWriter writer(sink);
+    writer.BeginObject().Key("voltage").Fixed(voltage, 2).EndObject();
+    if (writer.Finish()) {
+        m_EventStream.Publish(EventStream::EVENT_VOLTAGE, sink.GetView());
+    }
 }
 
 float VoltageCheckTask::GetVoltage() const
 {
+    std::lock_guard<std::mutex> lock(m_Mutex);
     return m_Voltage;
 }
 
+VoltageSample VoltageCheckTask::GetSample()
+{
+    VoltageSample sample = {};
+    std::int64_t sampleTime = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        sample.Voltage = m_Voltage;
+        sampleTime = m_SampleTime;
+    }
+
+    static constexpr std::int64_t MAX_AGE_MICROSECOND = CONFIG_VOLTAGE_CACHE_MAX_AGE_SECOND * SECOND_TO_MICRO;
+    if (sampleTime == 0) {
+        sample.AgeMillisecond = -1;
+        sample.IsStale = true;
+    } else {
+        const std::int64_t age = esp_timer_get_time() - sampleTime;
+        sample.AgeMillisecond = age / MICRO_TO_MILLI;
+        sample.IsStale = (MAX_AGE_MICROSECOND < age);
+    }
+
+    if (sample.IsStale) {
+        RequestSample();
+    }
+    return sample;
+}
+
+void VoltageCheckTask::RequestSample()
+{
+    // Only the first caller wakes the task. The others share the pending sample
+    bool isRequested = false;
+    if (m_IsSampleRequested.compare_exchange_strong(isRequested, true)) {
+        xEventGroupSetBits(m_EventGroup, SAMPLE_REQUEST_BIT);
+    }
+}
 
 } // IrrigationSystem
 
@@ -5,11 +5,32 @@
 
 // Include ----------------------
 #include <soc/soc.h>
+#include <esp_bit_defs.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
 
 #include "task.h"
+#include "event_stream.h"
 
 namespace IrrigationSystem {
 
+/// Cached main voltage
+struct VoltageSample
+{
+    float Voltage;
+    /// Time since the sample was taken (-1 if not sampled yet)
+    std::int64_t AgeMillisecond;
+    /// Older than CONFIG_VOLTAGE_CACHE_MAX_AGE_SECOND (a new sample has been requested)
+    bool IsStale;
+};
+
+/// Main voltage sampler
+/// The ADC is read only by this task. Readers get the cached sample and never wait for the hardware.
+/// Requests made while a sample is pending are coalesced into that sample.
 class VoltageCheckTask final : public Task
 {
 public:
@@ -17,8 +38,12 @@ public:
     static constexpr int PRIORITY = Task::PRIORITY_LOW;
     static constexpr int CORE_ID = APP_CPU_NUM;
 
+    /// Event bits
+    static constexpr EventBits_t SAMPLE_REQUEST_BIT = BIT0;
+
 public:
-    VoltageCheckTask();
+    explicit VoltageCheckTask(EventStream& eventStream);
+    ~VoltageCheckTask();
 
     void Initialize() override;
 
@@ -26,12 +51,25 @@ public:
 
     float GetVoltage() const;
 
+    /// Cached sample. A new sample is requested (not blocking) if it is older than the max age
+    VoltageSample GetSample();
+
+    /// Sample again (not blocking)
+    void RequestSample();
+
 private:
+    EventStream& m_EventStream;
+    EventGroupHandle_t m_EventGroup;
+    mutable std::mutex m_Mutex;
     float m_Voltage;
+    /// esp_timer time of the sample (0 if not sampled yet)
+    std::int64_t m_SampleTime;
+    std::int64_t m_NextSampleTime;
+    /// A sample is pending or in progress
+    std::atomic<bool> m_IsSampleRequested;
 };
 
 } // IrrigationSystem
 
-
 #endif // VOLTAGE_CHECKER_TASK_H_
 // EOF
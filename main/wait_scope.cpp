@@ -0,0 +1,40 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// Wait time of the current task
+
+// Include ----------------------
+#include "wait_scope.h"
+
+#include <esp_timer.h>
+
+namespace IrrigationSystem {
+
+namespace {
+
+/// WaitScope total of the task
+thread_local std::uint32_t t_WaitMicrosecond = 0;
+
+} // namespace
+
+WaitScope::WaitScope()
+    :m_BeginTime(esp_timer_get_time())
+{}
+
+WaitScope::~WaitScope()
+{
+    t_WaitMicrosecond += static_cast<std::uint32_t>(esp_timer_get_time() - m_BeginTime);
+}
+
+void WaitScope::Reset()
+{
+    t_WaitMicrosecond = 0;
+}
+
+std::uint32_t WaitScope::GetTotalMicrosecond()
+{
+    return t_WaitMicrosecond;
+}
+
+} // IrrigationSystem
+
+// EOF
@@ -0,0 +1,37 @@
+#ifndef WAIT_SCOPE_H_
+#define WAIT_SCOPE_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// Wait time of the current task
+
+// Include ----------------------
+#include <cstdint>
+
+namespace IrrigationSystem {
+
+/// Time the current task waits on a lock or hardware
+/// The elapsed time of each scope is added to a thread local total, so the request dispatcher
+/// can tell how much of the handler time was spent waiting.
+class WaitScope final
+{
+public:
+    WaitScope();
+    ~WaitScope();
+
+    WaitScope(const WaitScope&) = delete;
+    WaitScope& operator=(const WaitScope&) = delete;
+
+    /// Start a new total for the current task
+    static void Reset();
+
+    /// Total of the current task since Reset
+    static std::uint32_t GetTotalMicrosecond();
+
+private:
+    const std::int64_t m_BeginTime;
+};
+
+} // IrrigationSystem
+
+#endif // WAIT_SCOPE_H_
+// EOF
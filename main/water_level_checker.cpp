@@ -8,6 +8,7 @@
 
 #include "logger.h"
 #include "util.h"
+#include "json_writer.h"
 #include "gpio_control.h"
 
 namespace {
@@ -16,8 +17,9 @@ namespace {
 
 namespace IrrigationSystem {
 
-WaterLevelChecker::WaterLevelChecker()
+WaterLevelChecker::WaterLevelChecker(EventStream& eventStream)
     :Task(TASK_NAME, PRIORITY, CORE_ID)
+    ,m_EventStream(eventStream)
     ,m_CheckSec(0)
     ,m_WaterLevel(0.0f)
     ,m_pwm()
@@ -55,6 +57,14 @@ void WaterLevelChecker::Update()
                      ((static_cast<float>(adcVoltage) - minVoltage) / (float)(maxVoltage - minVoltage))));
       ESP_LOGI(TAG, "WaterLevelCheck adcVolt:%dmV min:%dmv max:%dmv rate:%0.2f", adcVoltage, minVoltage, maxVoltage, m_WaterLevel);
 
+      char data[32];
+      JsonBufferSink sink(data, sizeof(data));
+      JsonWriter writer(sink);
+      writer.BeginObject().Key("water_level").Fixed(m_WaterLevel, 2).EndObject();
+      if (writer.Finish()) {
+        m_EventStream.Publish(EventStream::EVENT_WATER_LEVEL, sink.GetView());
+      }
+
       m_CheckSec = Util::GetEpoch() + CHECK_WATER_LEVEL_INTERVAL_SEC;
     }
 
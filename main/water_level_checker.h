@@ -9,6 +9,7 @@
 
 #include "pwm.h"
 #include "task.h"
+#include "event_stream.h"
 
 namespace IrrigationSystem {
 
@@ -20,7 +21,7 @@ public:
     static constexpr int CORE_ID = APP_CPU_NUM;
 
 public:
-    WaterLevelChecker();
+    explicit WaterLevelChecker(EventStream& eventStream);
 
     void Initialize() override;
     void Update() override;
@@ -30,6 +31,7 @@ public:
     float GetWaterLevel() const;
 
 private:
+    EventStream& m_EventStream;
     std::time_t m_CheckSec;
     float m_WaterLevel;
     Pwm m_pwm;
@@ -5,13 +5,21 @@
 #include "watering_record.h"
 
 #include <stdexcept>
-#include <sstream>
+#include <ctime>
 
 #include <cJSON.h>
 
 #include "logger.h"
+#include "json_arena.h"
 #include "util.h"
 #include "file_system.h"
+#include "json_writer.h"
+#include "json_sink.h"
+
+namespace {
+    /// yyyy/mm/dd hh:mm:ss (Util::TimeToStr)
+    constexpr std::size_t DATE_LENGTH = 24;
+}
 
 namespace IrrigationSystem {
 
@@ -22,11 +30,18 @@ WateringRecord::WateringRecord()
 bool WateringRecord::Save() const
 {
     // Write History
-    std::stringstream historyBody;
-    historyBody << "{\"last_watering_date\":\""
-                << Util::TimeToStr(Util::EpochToLocalTime(m_LastWateringEpoch))
-                << "\"}";
-    return FileSystem::Write(WateringRecord::RECORD_FILE_NAME, historyBody.str());
+    char lastWateringDate[DATE_LENGTH] = {};
+    const std::tm timeInfo = Util::EpochToLocalTime(m_LastWateringEpoch);
+    std::strftime(lastWateringDate, sizeof(lastWateringDate), "%Y/%m/%d %H:%M:%S", &timeInfo);
+
+    JsonFileSink sink;
+    if (!sink.Open(WateringRecord::RECORD_FILE_NAME)) {
+        ESP_LOGE(TAG, "Failed Open File.");
+        return false;
+    }
+    JsonWriter writer(sink);
+    writer.BeginObject().Key("last_watering_date").String(lastWateringDate).EndObject();
+    return writer.Finish() && sink.Close();
 }
 
 bool WateringRecord::Load() noexcept
@@ -42,6 +57,8 @@ bool WateringRecord::Load() noexcept
     ESP_LOGV(TAG, "Log Body:%s", recordBody.c_str());
  
     // Parse 
+    // The DOM is released with the arena
+    JsonArena jsonArena("WateringRecord", recordBody.length() * JsonArena::DOM_SIZE_RATE);
     cJSON* pJsonRoot = nullptr;
     try {
         pJsonRoot = cJSON_Parse(recordBody.c_str());
@@ -9,17 +9,20 @@
 #include <string>
 #include <unordered_map>
 
-#include <cJSON.h>
-
-
 namespace IrrigationSystem {
 
 class WateringSetting final
 {
-private:
-    static constexpr char *const SETTING_FILE_NAME = (char*)"watering_setting.json";
+    /// Fills the members while the file is streamed
+    friend class WateringSettingParser;
 
 public:
+    /// Installed setting (/download_setting)
+    static constexpr char *const SETTING_FILE_NAME = (char*)"watering_setting.json";
+
+    /// Uploaded setting before validation
+    static constexpr char *const UPLOAD_FILE_NAME = (char*)"watering_setting.tmp";
+
     using WateringHourList = std::vector<std::int32_t>;
 
     enum WateringMode : std::int32_t
@@ -52,6 +55,9 @@ public:
     WateringSetting();
 
     bool SetSettingData(const std::string& body);
+
+    /// Parse the setting file in blocks (the file is not read into memory). The setting is kept when it is invalid
+    bool LoadFile(const std::string& filePath);
     
     bool IsActive() const;
 
@@ -68,16 +74,15 @@ public:
     float GetValvePowerBaseVoltage() const;
     float GetValvePowerVoltageRate() const;
 
-private:
-    bool Parse(const std::string& body) noexcept;
-
-    bool ParseSimple(cJSON* pJsonRoot) noexcept(false);
-    bool ParseAdvance(cJSON* pJsonRoot) noexcept(false);
-
 public:
     static bool Save(const std::string& body);
-    static bool Load(std::string& body);
     static bool Delete();
+
+    /// Replace the setting file with the validated upload file
+    static bool InstallUpload();
+
+    /// Delete the rejected upload file
+    static bool DeleteUpload();
     
 private:
     /// Is Read Setting
@@ -0,0 +1,443 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include "watering_setting_parser.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <algorithm>
+
+#include "logger.h"
+
+namespace {
+    // Setting json layout
+    //  {"watering_mode":"advance", "watering_sec":60, "watering_hour":[...],
+    //   "wether_forecast":{"service":"jma", ...}, "valve_power_control":{"base_voltage":12.0, ...},
+    //   "watering_type":[ {"type":"HOT", "day_span":1, "watering_hour":[7, 16]} ],
+    //   "temperature_watering":[ {"temperature":24, "normal_type":"HOT", "rain_type":"HOT_RAIN"} ],
+    //   "month_to_type":[ {"7":"HOT"} ]}
+    constexpr std::size_t DEPTH_ROOT_MEMBER = 0;
+    constexpr std::size_t DEPTH_GROUP_MEMBER = 1;
+    constexpr std::size_t DEPTH_ITEM_MEMBER = 2;
+
+    /// Location depth (number of path items)
+    constexpr std::size_t LOCATION_ROOT_MEMBER = DEPTH_ROOT_MEMBER + 1;
+    constexpr std::size_t LOCATION_LIST_ITEM = DEPTH_GROUP_MEMBER + 1;
+    constexpr std::size_t LOCATION_ITEM_MEMBER = DEPTH_ITEM_MEMBER + 1;
+    constexpr std::size_t LOCATION_ITEM_HOUR = LOCATION_ITEM_MEMBER + 1;
+
+    /// Indexed by Field (for the log)
+    const char *const FIELD_NAME_TABLE[] = {
+        "watering_mode",
+        "watering_sec",
+        "watering_hour",
+        "service",
+        "area_path_code",
+        "local_code",
+        "amedas_observation_point_number",
+        "watering_type",
+        "temperature_watering",
+        "month_to_type",
+        "base_voltage",
+        "base_rate",
+        "voltage_rate",
+    };
+
+    const char *const WATERING_MODE_TABLE[IrrigationSystem::WateringSetting::WATERING_MODE_MAX] = {
+        "",         // WATERING_MODE_NONE
+        "simple",   // WATERING_MODE_SIMPLE
+        "advance",  // WATERING_MODE_ADVANCE
+    };
+
+    constexpr std::uint32_t FieldBit(const int field)
+    {
+        return 1U << field;
+    }
+}
+
+namespace IrrigationSystem {
+
+WateringSettingParser::WateringSettingParser(WateringSetting& setting)
+    :m_JsonStreamParser(*this)
+    ,m_Setting(setting)
+    ,m_FoundMask(0)
+    ,m_ErrorField(FIELD_NONE)
+    ,m_ItemMask(0)
+    ,m_ItemMemberCount(0)
+    ,m_WateringType()
+    ,m_TemperatureWatering()
+    ,m_Month()
+{}
+
+bool WateringSettingParser::Feed(const char *const pData, const std::size_t length)
+{
+    return m_JsonStreamParser.Feed(pData, length);
+}
+
+bool WateringSettingParser::Finish()
+{
+    if (!m_JsonStreamParser.Finish()) {
+        ESP_LOGW(TAG, "Json Parse Error.");
+        return false;
+    }
+    if (m_ErrorField != FIELD_NONE) {
+        ESP_LOGW(TAG, "Illegal object type %s.", FIELD_NAME_TABLE[m_ErrorField]);
+        return false;
+    }
+    if ((m_FoundMask & FieldBit(FIELD_WATERING_MODE)) == 0) {
+        ESP_LOGW(TAG, "Illegal object type watering_mode.");
+        return false;
+    }
+
+    std::uint32_t requiredMask = FieldBit(FIELD_WATERING_SEC);
+    if (m_Setting.m_WateringMode == WateringSetting::WATERING_MODE_SIMPLE) {
+        ESP_LOGI(TAG, "Parse SimpleSetting");
+        requiredMask |= FieldBit(FIELD_WATERING_HOUR);
+    } else {
+        ESP_LOGI(TAG, "Parse AdvanceSetting");
+        requiredMask |= FieldBit(FIELD_SERVICE) | FieldBit(FIELD_AREA_PATH_CODE) | FieldBit(FIELD_LOCAL_CODE) | FieldBit(FIELD_AMEDAS) |
+                        FieldBit(FIELD_WATERING_TYPE) | FieldBit(FIELD_TEMPERATURE_WATERING) | FieldBit(FIELD_MONTH_TO_TYPE) |
+                        FieldBit(FIELD_BASE_VOLTAGE) | FieldBit(FIELD_BASE_RATE) | FieldBit(FIELD_VOLTAGE_RATE);
+    }
+    for (int field = 0; field < FIELD_MAX; ++field) {
+        if ((requiredMask & FieldBit(field)) != 0 && (m_FoundMask & FieldBit(field)) == 0) {
+            ESP_LOGW(TAG, "Illegal object type %s.", FIELD_NAME_TABLE[field]);
+            return false;
+        }
+    }
+
+    std::sort(m_Setting.m_TemperatureWateringList.begin(), m_Setting.m_TemperatureWateringList.end(),
+        [](const WateringSetting::TemperatureWatering& left, const WateringSetting::TemperatureWatering& right) {
+            return left.Temperature < right.Temperature;
+        }
+    );
+    m_Setting.m_IsActive = true;
+    return true;
+}
+
+void WateringSettingParser::OnBeginContainer(const JsonStreamParser& parser, const JsonStreamParser::ContainerType type)
+{
+    const std::size_t depth = parser.GetDepth();
+    const Field field = GetField(parser, depth);
+    switch (field) {
+    case FIELD_WATERING_HOUR:
+        if (depth != LOCATION_ROOT_MEMBER || type != JsonStreamParser::CONTAINER_ARRAY) {
+            SetError(field);
+        }
+        return;
+
+    case FIELD_WATERING_TYPE:
+    case FIELD_TEMPERATURE_WATERING:
+    case FIELD_MONTH_TO_TYPE:
+        if (depth == LOCATION_ROOT_MEMBER) {
+            if (type != JsonStreamParser::CONTAINER_ARRAY) {
+                SetError(field);
+            }
+        } else if (depth == LOCATION_LIST_ITEM) {
+            if (type != JsonStreamParser::CONTAINER_OBJECT) {
+                SetError(field);
+            }
+            // Begin list element
+            m_ItemMask = 0;
+            m_ItemMemberCount = 0;
+            m_WateringType = WateringSetting::WateringType();
+            m_TemperatureWatering = WateringSetting::TemperatureWatering();
+            m_Month.clear();
+        } else if (depth == LOCATION_ITEM_MEMBER) {
+            // Only the hours of a watering type are a container
+            if (field != FIELD_WATERING_TYPE || !parser.IsKey(DEPTH_ITEM_MEMBER, "watering_hour") || type != JsonStreamParser::CONTAINER_ARRAY) {
+                SetError(field);
+            }
+            ++m_ItemMemberCount;
+        } else {
+            SetError(field);
+        }
+        return;
+
+    case FIELD_NONE:
+        return;
+
+    default:
+        // A value is expected
+        SetError(field);
+        return;
+    }
+}
+
+void WateringSettingParser::OnEndContainer(const JsonStreamParser& parser, const JsonStreamParser::ContainerType type)
+{
+    const std::size_t depth = parser.GetDepth();
+    const Field field = GetField(parser, depth);
+    if (field == FIELD_NONE || m_ErrorField != FIELD_NONE) {
+        return;
+    }
+    if (depth == LOCATION_ROOT_MEMBER) {
+        SetFound(field);
+    } else if (depth == LOCATION_LIST_ITEM) {
+        EndItem(field);
+    } else if (depth == LOCATION_ITEM_MEMBER && field == FIELD_WATERING_TYPE) {
+        m_ItemMask |= ITEM_HOUR;
+    }
+}
+
+void WateringSettingParser::OnValue(const JsonStreamParser& parser, const JsonStreamParser::ValueType type, const char *const pValue)
+{
+    const std::size_t depth = parser.GetDepth();
+    const Field field = GetField(parser, depth);
+    if (field == FIELD_NONE) {
+        return;
+    }
+    if (parser.IsTruncated()) {
+        SetError(field);
+        return;
+    }
+
+    bool isValid = false;
+    switch (field) {
+    case FIELD_WATERING_MODE:
+        m_Setting.m_WateringMode = WateringSetting::WATERING_MODE_NONE;
+        if (type == JsonStreamParser::VALUE_STRING) {
+            for (std::int32_t idx = WateringSetting::WATERING_MODE_NONE + 1; idx < WateringSetting::WATERING_MODE_MAX; ++idx) {
+                if (std::strcmp(WATERING_MODE_TABLE[idx], pValue) == 0) {
+                    m_Setting.m_WateringMode = static_cast<WateringSetting::WateringMode>(idx);
+                    isValid = true;
+                    break;
+                }
+            }
+        }
+        break;
+
+    case FIELD_WATERING_SEC:
+        isValid = ToInt(type, pValue, m_Setting.m_WateringSec);
+        break;
+
+    case FIELD_WATERING_HOUR:
+        {
+            std::int32_t hour = 0;
+            if (depth == LOCATION_LIST_ITEM && ToInt(type, pValue, hour)) {
+                m_Setting.m_WateringHourList.push_back(hour);
+                return;
+            }
+        }
+        break;
+
+    case FIELD_SERVICE:
+        isValid = (type == JsonStreamParser::VALUE_STRING && std::strcmp(pValue, "jma") == 0);
+        break;
+
+    case FIELD_AREA_PATH_CODE:
+        isValid = ToInt(type, pValue, m_Setting.m_JMAAreaPathCode);
+        break;
+
+    case FIELD_LOCAL_CODE:
+        isValid = ToInt(type, pValue, m_Setting.m_JMALocalCode);
+        break;
+
+    case FIELD_AMEDAS:
+        isValid = ToInt(type, pValue, m_Setting.m_JMAAMeDAS);
+        break;
+
+    case FIELD_WATERING_TYPE:
+    case FIELD_TEMPERATURE_WATERING:
+    case FIELD_MONTH_TO_TYPE:
+        if (LOCATION_ITEM_MEMBER <= depth) {
+            OnItemValue(parser, field, type, pValue);
+            return;
+        }
+        break;
+
+    case FIELD_BASE_VOLTAGE:
+        isValid = ToFloat(type, pValue, m_Setting.m_BaseVoltage);
+        break;
+
+    case FIELD_BASE_RATE:
+        isValid = ToFloat(type, pValue, m_Setting.m_BaseRate);
+        break;
+
+    case FIELD_VOLTAGE_RATE:
+        isValid = ToFloat(type, pValue, m_Setting.m_VoltageRate);
+        break;
+
+    default:
+        break;
+    }
+
+    if (isValid) {
+        SetFound(field);
+    } else {
+        SetError(field);
+    }
+}
+
+void WateringSettingParser::OnItemValue(const JsonStreamParser& parser, const Field field, const JsonStreamParser::ValueType type, const char *const pValue)
+{
+    const std::size_t depth = parser.GetDepth();
+    const bool isString = (type == JsonStreamParser::VALUE_STRING);
+    bool isValid = true;
+    if (field == FIELD_WATERING_TYPE) {
+        if (depth == LOCATION_ITEM_HOUR) {
+            // watering_hour element
+            std::int32_t hour = 0;
+            isValid = ToInt(type, pValue, hour);
+            m_WateringType.WateringHours.push_back(hour);
+        } else if (parser.IsKey(DEPTH_ITEM_MEMBER, "type")) {
+            isValid = isString;
+            m_WateringType.WateringType = pValue;
+            m_ItemMask |= ITEM_NAME;
+        } else if (parser.IsKey(DEPTH_ITEM_MEMBER, "day_span")) {
+            isValid = ToInt(type, pValue, m_WateringType.DaySpan);
+            m_ItemMask |= ITEM_NUMBER;
+        } else if (parser.IsKey(DEPTH_ITEM_MEMBER, "watering_hour")) {
+            isValid = false;
+        }
+    } else if (field == FIELD_TEMPERATURE_WATERING) {
+        if (parser.IsKey(DEPTH_ITEM_MEMBER, "temperature")) {
+            isValid = ToInt(type, pValue, m_TemperatureWatering.Temperature);
+            m_ItemMask |= ITEM_NUMBER;
+        } else if (parser.IsKey(DEPTH_ITEM_MEMBER, "normal_type")) {
+            isValid = isString;
+            m_TemperatureWatering.NormalType = pValue;
+            m_ItemMask |= ITEM_NORMAL_TYPE;
+        } else if (parser.IsKey(DEPTH_ITEM_MEMBER, "rain_type")) {
+            isValid = isString;
+            m_TemperatureWatering.RainType = pValue;
+            m_ItemMask |= ITEM_RAIN_TYPE;
+        }
+    } else if (field == FIELD_MONTH_TO_TYPE) {
+        // The first member of the element ({"month":"type"})
+        if (m_ItemMemberCount == 0) {
+            isValid = isString;
+            m_Month = parser.GetPathItem(DEPTH_ITEM_MEMBER).Key;
+            m_WateringType.WateringType = pValue;
+            m_ItemMask |= ITEM_NAME;
+        }
+        ++m_ItemMemberCount;
+    }
+    if (!isValid) {
+        SetError(field);
+    }
+}
+
+void WateringSettingParser::EndItem(const Field field)
+{
+    if (field == FIELD_WATERING_TYPE) {
+        if (m_ItemMask != (ITEM_NAME | ITEM_NUMBER | ITEM_HOUR)) {
+            SetError(field);
+            return;
+        }
+        m_Setting.m_WateringTypeDict.insert(std::make_pair(m_WateringType.WateringType, m_WateringType));
+    } else if (field == FIELD_TEMPERATURE_WATERING) {
+        if (m_ItemMask != (ITEM_NUMBER | ITEM_NORMAL_TYPE | ITEM_RAIN_TYPE)) {
+            SetError(field);
+            return;
+        }
+        m_Setting.m_TemperatureWateringList.push_back(m_TemperatureWatering);
+    } else if (field == FIELD_MONTH_TO_TYPE) {
+        if (m_ItemMask != ITEM_NAME) {
+            SetError(field);
+            return;
+        }
+        m_Setting.m_MonthToTypeDict.insert(std::make_pair(m_Month, m_WateringType.WateringType));
+    }
+}
+
+void WateringSettingParser::SetFound(const Field field)
+{
+    if ((m_FoundMask & FieldBit(field)) != 0) {
+        SetError(field);
+        return;
+    }
+    m_FoundMask |= FieldBit(field);
+}
+
+void WateringSettingParser::SetError(const Field field)
+{
+    if (m_ErrorField == FIELD_NONE) {
+        m_ErrorField = field;
+    }
+}
+
+WateringSettingParser::Field WateringSettingParser::GetField(const JsonStreamParser& parser, const std::size_t depth)
+{
+    if (depth < LOCATION_ROOT_MEMBER) {
+        return FIELD_NONE;
+    }
+    if (parser.IsKey(DEPTH_ROOT_MEMBER, "watering_hour")) {
+        return FIELD_WATERING_HOUR;
+    } else if (parser.IsKey(DEPTH_ROOT_MEMBER, "watering_type")) {
+        return FIELD_WATERING_TYPE;
+    } else if (parser.IsKey(DEPTH_ROOT_MEMBER, "temperature_watering")) {
+        return FIELD_TEMPERATURE_WATERING;
+    } else if (parser.IsKey(DEPTH_ROOT_MEMBER, "month_to_type")) {
+        return FIELD_MONTH_TO_TYPE;
+    }
+
+    if (depth == LOCATION_ROOT_MEMBER) {
+        if (parser.IsKey(DEPTH_ROOT_MEMBER, "watering_mode")) {
+            return FIELD_WATERING_MODE;
+        } else if (parser.IsKey(DEPTH_ROOT_MEMBER, "watering_sec")) {
+            return FIELD_WATERING_SEC;
+        }
+    } else if (depth == LOCATION_LIST_ITEM) {
+        if (parser.IsKey(DEPTH_ROOT_MEMBER, "wether_forecast")) {
+            if (parser.IsKey(DEPTH_GROUP_MEMBER, "service")) {
+                return FIELD_SERVICE;
+            } else if (parser.IsKey(DEPTH_GROUP_MEMBER, "area_path_code")) {
+                return FIELD_AREA_PATH_CODE;
+            } else if (parser.IsKey(DEPTH_GROUP_MEMBER, "local_code")) {
+                return FIELD_LOCAL_CODE;
+            } else if (parser.IsKey(DEPTH_GROUP_MEMBER, "amedas_observation_point_number")) {
+                return FIELD_AMEDAS;
+            }
+        } else if (parser.IsKey(DEPTH_ROOT_MEMBER, "valve_power_control")) {
+            if (parser.IsKey(DEPTH_GROUP_MEMBER, "base_voltage")) {
+                return FIELD_BASE_VOLTAGE;
+            } else if (parser.IsKey(DEPTH_GROUP_MEMBER, "base_rate")) {
+                return FIELD_BASE_RATE;
+            } else if (parser.IsKey(DEPTH_GROUP_MEMBER, "voltage_rate")) {
+                return FIELD_VOLTAGE_RATE;
+            }
+        }
+    }
+    return FIELD_NONE;
+}
+
+bool WateringSettingParser::ToInt(const JsonStreamParser::ValueType type, const char *const pValue, std::int32_t& value)
+{
+    if (type != JsonStreamParser::VALUE_NUMBER) {
+        return false;
+    }
+    char* pEnd = nullptr;
+    const double number = std::strtod(pValue, &pEnd);
+    if (pEnd == pValue || *pEnd != '\0') {
+        return false;
+    }
+    if (INT_MAX <= number) {
+        value = INT_MAX;
+    } else if (number <= INT_MIN) {
+        value = INT_MIN;
+    } else {
+        value = static_cast<std::int32_t>(number);
+    }
+    return true;
+}
+
+bool WateringSettingParser::ToFloat(const JsonStreamParser::ValueType type, const char *const pValue, float& value)
+{
+    if (type != JsonStreamParser::VALUE_NUMBER) {
+        return false;
+    }
+    char* pEnd = nullptr;
+    const double number = std::strtod(pValue, &pEnd);
+    if (pEnd == pValue || *pEnd != '\0') {
+        return false;
+    }
+    value = static_cast<float>(number);
+    return true;
+}
+
+} // IrrigationSystem
+
+// EOF
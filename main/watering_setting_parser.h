@@ -0,0 +1,109 @@
+#ifndef WATERING_SETTING_PARSER_H_
+#define WATERING_SETTING_PARSER_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "json_stream_parser.h"
+#include "watering_setting.h"
+
+namespace IrrigationSystem {
+
+/// Watering setting json reader
+/// It is fed with the file in blocks and fills the setting as the values arrive, so the parse
+/// needs neither the whole text nor a DOM. The members required by the watering mode are checked
+/// at Finish. Names (types, months) are limited to JsonStreamParser::MAX_VALUE_LENGTH bytes.
+class WateringSettingParser final : public JsonStreamParser::Listener
+{
+private:
+    /// Members of the setting
+    enum Field : int {
+        FIELD_WATERING_MODE,
+        FIELD_WATERING_SEC,
+        FIELD_WATERING_HOUR,
+        FIELD_SERVICE,
+        FIELD_AREA_PATH_CODE,
+        FIELD_LOCAL_CODE,
+        FIELD_AMEDAS,
+        FIELD_WATERING_TYPE,
+        FIELD_TEMPERATURE_WATERING,
+        FIELD_MONTH_TO_TYPE,
+        FIELD_BASE_VOLTAGE,
+        FIELD_BASE_RATE,
+        FIELD_VOLTAGE_RATE,
+        FIELD_MAX,
+        FIELD_NONE = FIELD_MAX,
+    };
+
+    /// Members found in the current list element
+    enum ItemFlag : std::uint8_t {
+        ITEM_NAME = (1 << 0),
+        ITEM_NUMBER = (1 << 1),
+        ITEM_HOUR = (1 << 2),
+        ITEM_NORMAL_TYPE = (1 << 3),
+        ITEM_RAIN_TYPE = (1 << 4),
+    };
+
+public:
+    /// The setting is filled (it is usable only when Finish succeeds)
+    explicit WateringSettingParser(WateringSetting& setting);
+
+    /// Feed a part of the file
+    bool Feed(const char *const pData, const std::size_t length);
+
+    /// Notify the end of the file. Return true if the setting is valid
+    bool Finish();
+
+private:
+    /// (JsonStreamParser::Listener:override)
+    void OnBeginContainer(const JsonStreamParser& parser, const JsonStreamParser::ContainerType type) override;
+
+    /// (JsonStreamParser::Listener:override)
+    void OnEndContainer(const JsonStreamParser& parser, const JsonStreamParser::ContainerType type) override;
+
+    /// (JsonStreamParser::Listener:override)
+    void OnValue(const JsonStreamParser& parser, const JsonStreamParser::ValueType type, const char *const pValue) override;
+
+    /// Member value of the current list element
+    void OnItemValue(const JsonStreamParser& parser, const Field field, const JsonStreamParser::ValueType type, const char *const pValue);
+
+    /// End of a list element
+    void EndItem(const Field field);
+
+    /// A member of the root object was found (a duplicated one is an error)
+    void SetFound(const Field field);
+
+    /// Keep the first error
+    void SetError(const Field field);
+
+    /// Member at the location (depth: number of path items)
+    static Field GetField(const JsonStreamParser& parser, const std::size_t depth);
+
+    /// Number to int like cJSON valueint (saturated)
+    static bool ToInt(const JsonStreamParser::ValueType type, const char *const pValue, std::int32_t& value);
+    static bool ToFloat(const JsonStreamParser::ValueType type, const char *const pValue, float& value);
+
+private:
+    JsonStreamParser m_JsonStreamParser;
+    WateringSetting& m_Setting;
+
+    /// Bit per Field
+    std::uint32_t m_FoundMask;
+    Field m_ErrorField;
+
+    // Current list element
+    std::uint8_t m_ItemMask;
+    std::int32_t m_ItemMemberCount;
+    WateringSetting::WateringType m_WateringType;
+    WateringSetting::TemperatureWatering m_TemperatureWatering;
+    std::string m_Month;
+};
+
+} // IrrigationSystem
+
+#endif // WATERING_SETTING_PARSER_H_
+// EOF
@@ -4,277 +4,445 @@
 // Include ----------------------
 #include "weather_forecast.h"
 
-#include <cJSON.h>
-
-#include <stdexcept>
-#include <unordered_map>
+#include <cstddef>
 #include <sstream>
+#include <algorithm>
 
 #include "logger.h"
+#include "util.h"
 #include "http_request.h"
+#include "weather_forecast_parser.h"
 
 // Request Server Root Cert (PEM)
 extern const uint8_t CERT_JMA_ROOT_CA_PEM[] asm("_binary_DigiCertGlobalRootCA_cer_start");
 
+namespace {
+    /// JMA weather code names
+    struct WeatherCodeName
+    {
+        int Code;
+        const char* En;
+        const char* Ja;
+    };
+
+    /// Sorted by code
+    constexpr WeatherCodeName WEATHER_CODE_NAME_TABLE[] = {
+        {100, "CLEAR", "晴"},
+        {101, "PARTLY CLOUDY", "晴時々曇"},
+        {102, "CLEAR, OCCASIONAL SCATTERED SHOWERS", "晴一時雨"},
+        {103, "CLEAR, FREQUENT SCATTERED SHOWERS", "晴時々雨"},
+        {104, "CLEAR, SNOW FLURRIES", "晴一時雪"},
+        {105, "CLEAR, FREQUENT SNOW FLURRIES", "晴時々雪"},
+        {106, "CLEAR, OCCASIONAL SCATTERED SHOWERS OR SNOW FLURRIES", "晴一時雨か雪"},
+        {107, "CLEAR, FREQUENT SCATTERED SHOWERS OR SNOW FLURRIES", "晴時々雨か雪"},
+        {108, "CLEAR, OCCASIONAL SCATTERED SHOWERS AND/OR THUNDER", "晴一時雨か雷雨"},
+        {110, "CLEAR, PARTLY CLOUDY LATER", "晴後時々曇"},
+        {111, "CLEAR, CLOUDY LATER", "晴後曇"},
+        {112, "CLEAR, OCCASIONAL SCATTERED SHOWERS LATER", "晴後一時雨"},
+        {113, "CLEAR, FREQUENT SCATTERED SHOWERS LATER", "晴後時々雨"},
+        {114, "CLEAR,RAIN LATER", "晴後雨"},
+        {115, "CLEAR, OCCASIONAL SNOW FLURRIES LATER", "晴後一時雪"},
+        {116, "CLEAR, FREQUENT SNOW FLURRIES LATER", "晴後時々雪"},
+        {117, "CLEAR,SNOW LATER", "晴後雪"},
+        {118, "CLEAR, RAIN OR SNOW LATER", "晴後雨か雪"},
+        {119, "CLEAR, RAIN AND/OR THUNDER LATER", "晴後雨か雷雨"},
+        {120, "OCCASIONAL SCATTERED SHOWERS IN THE MORNING AND EVENING, CLEAR DURING THE DAY", "晴朝夕一時雨"},
+        {121, "OCCASIONAL SCATTERED SHOWERS IN THE MORNING, CLEAR DURING THE DAY", "晴朝の内一時雨"},
+        {122, "CLEAR, OCCASIONAL SCATTERED SHOWERS IN THE EVENING", "晴夕方一時雨"},
+        {123, "CLEAR IN THE PLAINS, RAIN AND THUNDER NEAR MOUTAINOUS AREAS", "晴山沿い雷雨"},
+        {124, "CLEAR IN THE PLAINS, SNOW NEAR MOUTAINOUS AREAS", "晴山沿い雪"},
+        {125, "CLEAR, RAIN AND THUNDER IN THE AFTERNOON", "晴午後は雷雨"},
+        {126, "CLEAR, RAIN IN THE AFTERNOON", "晴昼頃から雨"},
+        {127, "CLEAR, RAIN IN THE EVENING", "晴夕方から雨"},
+        {128, "CLEAR, RAIN IN THE NIGHT", "晴夜は雨"},
+        {130, "FOG IN THE MORNING, CLEAR LATER", "朝の内霧後晴"},
+        {131, "FOG AROUND DAWN, CLEAR LATER", "晴明け方霧"},
+        {132, "CLOUDY IN THE MORNING AND EVENING, CLEAR DURING THE DAY", "晴朝夕曇"},
+        {140, "CLEAR, FREQUENT SCATTERED SHOWERS AND THUNDER", "晴時々雨で雷を伴う"},
+        {160, "CLEAR, SNOW FLURRIES OR OCCASIONAL SCATTERED SHOWERS", "晴一時雪か雨"},
+        {170, "CLEAR, FREQUENT SNOW FLURRIES OR SCATTERED SHOWERS", "晴時々雪か雨"},
+        {181, "CLEAR, SNOW OR RAIN LATER", "晴後雪か雨"},
+        {200, "CLOUDY", "曇"},
+        {201, "MOSTLY CLOUDY", "曇時々晴"},
+        {202, "CLOUDY, OCCASIONAL SCATTERED SHOWERS", "曇一時雨"},
+        {203, "CLOUDY, FREQUENT SCATTERED SHOWERS", "曇時々雨"},
+        {204, "CLOUDY, OCCASIONAL SNOW FLURRIES", "曇一時雪"},
+        {205, "CLOUDY FREQUENT SNOW FLURRIES", "曇時々雪"},
+        {206, "CLOUDY, OCCASIONAL SCATTERED SHOWERS OR SNOW FLURRIES", "曇一時雨か雪"},
+        {207, "CLOUDY, FREQUENT SCCATERED SHOWERS OR SNOW FLURRIES", "曇時々雨か雪"},
+        {208, "CLOUDY, OCCASIONAL SCATTERED SHOWERS AND/OR THUNDER", "曇一時雨か雷雨"},
+        {209, "FOG", "霧"},
+        {210, "CLOUDY, PARTLY CLOUDY LATER", "曇後時々晴"},
+        {211, "CLOUDY, CLEAR LATER", "曇後晴"},
+        {212, "CLOUDY, OCCASIONAL SCATTERED SHOWERS LATER", "曇後一時雨"},
+        {213, "CLOUDY, FREQUENT SCATTERED SHOWERS LATER", "曇後時々雨"},
+        {214, "CLOUDY, RAIN LATER", "曇後雨"},
+        {215, "CLOUDY, SNOW FLURRIES LATER", "曇後一時雪"},
+        {216, "CLOUDY, FREQUENT SNOW FLURRIES LATER", "曇後時々雪"},
+        {217, "CLOUDY, SNOW LATER", "曇後雪"},
+        {218, "CLOUDY, RAIN OR SNOW LATER", "曇後雨か雪"},
+        {219, "CLOUDY, RAIN AND/OR THUNDER LATER", "曇後雨か雷雨"},
+        {220, "OCCASIONAL SCCATERED SHOWERS IN THE MORNING AND EVENING, CLOUDY DURING THE DAY", "曇朝夕一時雨"},
+        {221, "CLOUDY OCCASIONAL SCCATERED SHOWERS IN THE MORNING", "曇朝の内一時雨"},
+        {222, "CLOUDY, OCCASIONAL SCCATERED SHOWERS IN THE EVENING", "曇夕方一時雨"},
+        {223, "CLOUDY IN THE MORNING AND EVENING, PARTLY CLOUDY DURING THE DAY,", "曇日中時々晴"},
+        {224, "CLOUDY, RAIN IN THE AFTERNOON", "曇昼頃から雨"},
+        {225, "CLOUDY, RAIN IN THE EVENING", "曇夕方から雨"},
+        {226, "CLOUDY, RAIN IN THE NIGHT", "曇夜は雨"},
+        {228, "CLOUDY, SNOW IN THE AFTERNOON", "曇昼頃から雪"},
+        {229, "CLOUDY, SNOW IN THE EVENING", "曇夕方から雪"},
+        {230, "CLOUDY, SNOW IN THE NIGHT", "曇夜は雪"},
+        {231, "CLOUDY, FOG OR DRIZZLING ON THE SEA AND NEAR SEASHORE", "曇海上海岸は霧か霧雨"},
+        {240, "CLOUDY, FREQUENT SCCATERED SHOWERS AND THUNDER", "曇時々雨で雷を伴う"},
+        {250, "CLOUDY, FREQUENT SNOW AND THUNDER", "曇時々雪で雷を伴う"},
+        {260, "CLOUDY, SNOW FLURRIES OR OCCASIONAL SCATTERED SHOWERS", "曇一時雪か雨"},
+        {270, "CLOUDY, FREQUENT SNOW FLURRIES OR SCATTERED SHOWERS", "曇時々雪か雨"},
+        {281, "CLOUDY, SNOW OR RAIN LATER", "曇後雪か雨"},
+        {300, "RAIN", "雨"},
+        {301, "RAIN, PARTLY CLOUDY", "雨時々晴"},
+        {302, "SHOWERS THROUGHOUT THE DAY", "雨時々止む"},
+        {303, "RAIN,FREQUENT SNOW FLURRIES", "雨時々雪"},
+        {304, "RAINORSNOW", "雨か雪"},
+        {306, "HEAVYRAIN", "大雨"},
+        {308, "RAINSTORM", "雨で暴風を伴う"},
+        {309, "RAIN,OCCASIONAL SNOW", "雨一時雪"},
+        {311, "RAIN,CLEAR LATER", "雨後晴"},
+        {313, "RAIN,CLOUDY LATER", "雨後曇"},
+        {314, "RAIN, FREQUENT SNOW FLURRIES LATER", "雨後時々雪"},
+        {315, "RAIN,SNOW LATER", "雨後雪"},
+        {316, "RAIN OR SNOW, CLEAR LATER", "雨か雪後晴"},
+        {317, "RAIN OR SNOW, CLOUDY LATER", "雨か雪後曇"},
+        {320, "RAIN IN THE MORNING, CLEAR LATER", "朝の内雨後晴"},
+        {321, "RAIN IN THE MORNING, CLOUDY LATER", "朝の内雨後曇"},
+        {322, "OCCASIONAL SNOW IN THE MORNING AND EVENING, RAIN DURING THE DAY", "雨朝晩一時雪"},
+        {323, "RAIN, CLEAR IN THE AFTERNOON", "雨昼頃から晴"},
+        {324, "RAIN, CLEAR IN THE EVENING", "雨夕方から晴"},
+        {325, "RAIN, CLEAR IN THE NIGHT", "雨夜は晴"},
+        {326, "RAIN, SNOW IN THE EVENING", "雨夕方から雪"},
+        {327, "RAIN,SNOW IN THE NIGHT", "雨夜は雪"},
+        {328, "RAIN, EXPECT OCCASIONAL HEAVY RAINFALL", "雨一時強く降る"},
+        {329, "RAIN, OCCASIONAL SLEET", "雨一時みぞれ"},
+        {340, "SNOWORRAIN", "雪か雨"},
+        {350, "RAIN AND THUNDER", "雨で雷を伴う"},
+        {361, "SNOW OR RAIN, CLEAR LATER", "雪か雨後晴"},
+        {371, "SNOW OR RAIN, CLOUDY LATER", "雪か雨後曇"},
+        {400, "SNOW", "雪"},
+        {401, "SNOW, FREQUENT CLEAR", "雪時々晴"},
+        {402, "SNOWTHROUGHOUT THE DAY", "雪時々止む"},
+        {403, "SNOW,FREQUENT SCCATERED SHOWERS", "雪時々雨"},
+        {405, "HEAVYSNOW", "大雪"},
+        {406, "SNOWSTORM", "風雪強い"},
+        {407, "HEAVYSNOWSTORM", "暴風雪"},
+        {409, "SNOW, OCCASIONAL SCCATERED SHOWERS", "雪一時雨"},
+        {411, "SNOW,CLEAR LATER", "雪後晴"},
+        {413, "SNOW,CLOUDY LATER", "雪後曇"},
+        {414, "SNOW,RAIN LATER", "雪後雨"},
+        {420, "SNOW IN THE MORNING, CLEAR LATER", "朝の内雪後晴"},
+        {421, "SNOW IN THE MORNING, CLOUDY LATER", "朝の内雪後曇"},
+        {422, "SNOW, RAIN IN THE AFTERNOON", "雪昼頃から雨"},
+        {423, "SNOW, RAIN IN THE EVENING", "雪夕方から雨"},
+        {425, "SNOW, EXPECT OCCASIONAL HEAVY SNOWFALL", "雪一時強く降る"},
+        {426, "SNOW, SLEET LATER", "雪後みぞれ"},
+        {427, "SNOW, OCCASIONAL SLEET", "雪一時みぞれ"},
+        {450, "SNOW AND THUNDER", "雪で雷を伴う"},
+    };
+    constexpr std::size_t WEATHER_CODE_NAME_COUNT = sizeof(WEATHER_CODE_NAME_TABLE) / sizeof(WEATHER_CODE_NAME_TABLE[0]);
+
+    constexpr bool IsSortedWeatherCodeNameTable()
+    {
+        for (std::size_t i = 1; i < WEATHER_CODE_NAME_COUNT; ++i) {
+            if (WEATHER_CODE_NAME_TABLE[i].Code <= WEATHER_CODE_NAME_TABLE[i - 1].Code) {
+                return false;
+            }
+        }
+        return true;
+    }
+    static_assert(IsSortedWeatherCodeNameTable(), "WEATHER_CODE_NAME_TABLE must be sorted by code");
+}
+
 namespace IrrigationSystem {
 
 WeatherForecast::WeatherForecast()
     :m_RequestStatus(NOT_REQUEST)
     ,m_CurrentWeatherCode(0)
     ,m_CurrentMaxTemperature(0)
+    ,m_Daily()
     ,m_JMAAreaPathCode(0)
     ,m_JMAAreaForecastLocalCode(0)
     ,m_JMAAMeDASObservationPointNumber(0)
+    ,m_Cache()
+    ,m_CacheLoadFlag()
+    ,m_CacheStatistics()
+    ,m_LastRequestTiming()
+    ,m_Mutex()
+    ,m_CacheMutex()
 {}
 
 void WeatherForecast::Initialize()
 {
-    *this = WeatherForecast();
+    // The cache, statistics and daily forecast are kept across days
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_RequestStatus = NOT_REQUEST;
+    m_CurrentWeatherCode = 0;
+    m_CurrentMaxTemperature = 0;
+    m_JMAAreaPathCode = 0;
+    m_JMAAreaForecastLocalCode = 0;
+    m_JMAAMeDASObservationPointNumber = 0;
 }
 
 /// Set JMA Parameter
 void WeatherForecast::SetJMAParamter(const std::int32_t areaPathCode, const std::int32_t localCode, const std::int32_t AMeDASPoint) 
 {
+    std::lock_guard<std::mutex> lock(m_Mutex);
     m_JMAAreaPathCode = areaPathCode;
     m_JMAAreaForecastLocalCode = localCode;
     m_JMAAMeDASObservationPointNumber = AMeDASPoint;
 }
 
+/// Restore the persisted forecast snapshot (boot time)
+void WeatherForecast::WarmLoad(const std::int32_t areaPathCode, const std::int32_t localCode, const std::int32_t AMeDASPoint)
+{
+    SetJMAParamter(areaPathCode, localCode, AMeDASPoint);
+    LoadCache();
+    const CacheCopy cache = CopyCache(areaPathCode, localCode, AMeDASPoint, Util::GetEpoch());
+    if (ApplyFreshCache(cache)) {
+        ESP_LOGI(TAG, "WeatherForecast restored from snapshot. Fetched:%s", Util::TimeToStr(Util::EpochToLocalTime(cache.FetchEpoch)).c_str());
+    } else if (cache.IsMatch) {
+        // Expired, but the coming days are still usable if the network is down
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Daily = cache.Daily;
+    }
+}
+
 /// Obtaining weather forecast information via the JMA API
 void WeatherForecast::Request()
 {
+    // Parameters of this request (set by the management task)
+    std::int32_t areaPathCode = 0;
+    std::int32_t localCode = 0;
+    std::int32_t AMeDASPoint = 0;
+    GetJMAParamter(areaPathCode, localCode, AMeDASPoint);
+
+    // An unexpired snapshot (e.g. restored after reboot) does not need the network
+    LoadCache();
+    const std::time_t nowEpoch = Util::GetEpoch();
+    const CacheCopy cache = CopyCache(areaPathCode, localCode, AMeDASPoint, nowEpoch);
+    if (ApplyFreshCache(cache)) {
+        AddStatistics(&CacheStatistics::SnapshotCount);
+        ESP_LOGI(TAG, "WeatherForecast use snapshot. Fetched:%s", Util::TimeToStr(Util::EpochToLocalTime(cache.FetchEpoch)).c_str());
+        return;
+    }
+
     // Weather Forecast API by JMA
     std::stringstream requestUrl;
     requestUrl << "https://www.jma.go.jp/bosai/forecast/data/forecast/" 
-               << m_JMAAreaPathCode << ".json";
+               << areaPathCode << ".json";
+
+    // The response body is parsed as it arrives and is never buffered.
+    WeatherForecastParser parser(localCode, AMeDASPoint);
+
+    HttpCallbackSink responseSink([&parser](const char *const pData, const std::size_t length) {
+        // A parse error drops the rest of the body and fails the request
+        return parser.Feed(pData, length);
+    });
 
     HttpRequest httpRequest;
     httpRequest.EnableTLS(reinterpret_cast<const char*>(CERT_JMA_ROOT_CA_PEM));
+    httpRequest.SetTimeout(CONFIG_WEATHER_FORECAST_FETCH_TIMEOUT_SECOND * 1000);
+    httpRequest.SetResponseSink(&responseSink);
+    // Revalidate the cached result (If-None-Match / If-Modified-Since)
+    if (cache.IsMatch) {
+        httpRequest.SetValidator(cache.Validator);
+    }
     httpRequest.Request(requestUrl.str());
-    if (httpRequest.GetStatus() == HttpRequest::STATUS_OK) {
-        Parse(httpRequest.GetResponseBody());
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        ++m_CacheStatistics.RequestCount;
+        m_LastRequestTiming = httpRequest.GetTiming();
+    }
+
+    if (httpRequest.GetStatus() == HttpRequest::STATUS_NOT_MODIFIED && cache.IsMatch) {
+        AddStatistics(&CacheStatistics::HitCount);
+        SetResult(ACQUIRED, cache.Daily);
+        {
+            std::lock_guard<std::mutex> lock(m_CacheMutex);
+            m_Cache.Refresh(nowEpoch, CalcExpireEpoch(nowEpoch));
+        }
+        const CacheStatistics cacheStatistics = GetCacheStatistics();
+        ESP_LOGI(TAG, "WeatherForecast Not Modified. Use cache. hit:%u/%u", cacheStatistics.HitCount, cacheStatistics.RequestCount);
         return;
     }
-    ESP_LOGW(TAG, "Request NG");
+    if (httpRequest.GetStatus() != HttpRequest::STATUS_OK) {
+        ESP_LOGW(TAG, "Request NG");
+        SetFailed(cache);
+        return;
+    }
+    AddStatistics(&CacheStatistics::MissCount);
+
+    if (!parser.Finish()) {
+        ESP_LOGW(TAG, "WeatherForecast Parse NG.");
+        SetFailed(cache);
+        return;
+    }
+    SetResult(ACQUIRED, parser.GetDaily());
+    ESP_LOGD(TAG, "WeatherForecast Parse OK. Days:%u", parser.GetDaily().DayCount);
+
+    std::lock_guard<std::mutex> lock(m_CacheMutex);
+    m_Cache.Save(areaPathCode, localCode, AMeDASPoint,
+                 parser.GetDaily(), httpRequest.GetResponseValidator(),
+                 nowEpoch, CalcExpireEpoch(nowEpoch));
 }
 
-WeatherForecast::RequestStatus WeatherForecast::GetRequestStatus() const
+void WeatherForecast::GetJMAParamter(std::int32_t& areaPathCode, std::int32_t& localCode, std::int32_t& AMeDASPoint) const
 {
-    return m_RequestStatus;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    areaPathCode = m_JMAAreaPathCode;
+    localCode = m_JMAAreaForecastLocalCode;
+    AMeDASPoint = m_JMAAMeDASObservationPointNumber;
 }
 
-int WeatherForecast::GetCurrentWeatherCode() const
+void WeatherForecast::LoadCache()
 {
-    return m_CurrentWeatherCode;
+    // The first caller reads the file. The others wait for it
+    std::call_once(m_CacheLoadFlag, [this]() {
+        std::lock_guard<std::mutex> lock(m_CacheMutex);
+        m_Cache.Load();
+    });
 }
 
-int WeatherForecast::GetCurrentMaxTemperature() const
+WeatherForecast::CacheCopy WeatherForecast::CopyCache(const std::int32_t areaPathCode, const std::int32_t localCode, const std::int32_t AMeDASPoint, const std::time_t nowEpoch) const
 {
-    return m_CurrentMaxTemperature;
+    CacheCopy cache = {};
+    std::lock_guard<std::mutex> lock(m_CacheMutex);
+    cache.IsMatch = m_Cache.IsMatch(areaPathCode, localCode, AMeDASPoint);
+    if (cache.IsMatch) {
+        cache.IsFresh = m_Cache.IsFresh(nowEpoch);
+        cache.FetchEpoch = m_Cache.GetFetchEpoch();
+        cache.Daily = m_Cache.GetDaily();
+        cache.Validator = m_Cache.GetValidator();
+    }
+    return cache;
 }
 
-bool WeatherForecast::IsRain() const
+bool WeatherForecast::ApplyFreshCache(const CacheCopy& cache)
 {
-    static constexpr int WEATHER_TOP_CATEGORY_RAIN = 3;
-    static constexpr int WEATHER_TOP_CATEGORY_SNOW = 4;
-    static constexpr int WEATHER_TOP_CATEGORY_DIGITS = 100;
-    const int weatherCodeTopCategory = (m_CurrentWeatherCode / WEATHER_TOP_CATEGORY_DIGITS);
-    return (weatherCodeTopCategory == WEATHER_TOP_CATEGORY_RAIN ||
-            weatherCodeTopCategory == WEATHER_TOP_CATEGORY_SNOW);
+    if (!cache.IsMatch || !cache.IsFresh) {
+        return false;
+    }
+    SetResult(ACQUIRED, cache.Daily);
+    return GetRequestStatus() == ACQUIRED;
 }
 
-void WeatherForecast::Parse(const std::string& jsonStr)
+void WeatherForecast::AddStatistics(std::uint32_t CacheStatistics::*const pCounter)
 {
-    m_RequestStatus = FAILED;
-    cJSON* pJsonRoot = nullptr;
-
-    try {
-        pJsonRoot = cJSON_Parse(jsonStr.c_str());
-        if (!pJsonRoot){
-            const char *error_ptr = cJSON_GetErrorPtr();
-            if (error_ptr)
-            {
-                throw std::runtime_error(error_ptr);
-            }
-            throw std::runtime_error("Json Parse Error.");
-        }
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    ++(m_CacheStatistics.*pCounter);
+}
 
-        // JMA API Parse
-        if (!cJSON_IsArray(pJsonRoot)) { 
-            throw std::runtime_error("Illegal object type root.");
-        }
-        const int rootArraySize = cJSON_GetArraySize(pJsonRoot); 
-        if (rootArraySize != 2) {
-            throw std::runtime_error("Invalid Array Size root");
-        }
+void WeatherForecast::SetResult(const RequestStatus requestStatus, const WeatherForecastDaily& daily)
+{
+    const WeatherForecastDaily todayDaily = daily.From(Util::DateToDayNumber(Util::GetLocalTime()));
 
-        // Forecast
-        static constexpr int JSON_FORECAST_NEAR_IDX = 0;
-        //static constexpr int JSON_FORECAST_WEEK_IDX = 1;
-        const cJSON *const pJsonForecast = cJSON_GetArrayItem(pJsonRoot, JSON_FORECAST_NEAR_IDX);
-        if (!cJSON_IsObject(pJsonForecast)) {
-            throw std::runtime_error("Illegal object type forecast.");
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Daily = daily;
+    if (!todayDaily.HasWeatherCode(0)) {
+        ESP_LOGW(TAG, "WeatherForecast does not cover today.");
+        m_RequestStatus = FAILED;
+        return;
+    }
+    m_RequestStatus = requestStatus;
+    m_CurrentWeatherCode = todayDaily.WeatherCode[0];
+
+    // The near-term temperature is announced for the next day in the evening. Use the nearest one
+    m_CurrentMaxTemperature = 0;
+    for (std::size_t i = 0; i < todayDaily.DayCount; ++i) {
+        if (todayDaily.HasMaxTemperature(i)) {
+            m_CurrentMaxTemperature = todayDaily.MaxTemperature[i];
+            break;
         }
+    }
+}
 
-        // timeSeries
-        const cJSON *const pJsonTimeSeries = cJSON_GetObjectItemCaseSensitive(pJsonForecast, "timeSeries");
-        if (!cJSON_IsArray(pJsonTimeSeries)) {
-            throw std::runtime_error("Illegal object type timeSeries.");
-        }
-        static const int TIME_SERIES_WEATHER_NEWAR_LENGTH = 3;
-        const int timeSeriesArraySize = cJSON_GetArraySize(pJsonTimeSeries); 
-        if (timeSeriesArraySize != TIME_SERIES_WEATHER_NEWAR_LENGTH) {
-            throw std::runtime_error("Invalid Array Size timeSeries");
-        }
-        
-        {
-            // timeSeriesWeather
-            static constexpr int TIME_SERIES_WEATHER_INDEX = 0;
-            const cJSON *const pJsonTimeSeriesWeather = cJSON_GetArrayItem(pJsonTimeSeries, TIME_SERIES_WEATHER_INDEX);
-            if (!cJSON_IsObject(pJsonTimeSeriesWeather)) {
-                throw std::runtime_error("Illegal object type timeSeriesWeather.");
-            }
+void WeatherForecast::SetFailed(const CacheCopy& cache)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_RequestStatus = FAILED;
+    if (m_Daily.DayCount == 0 && cache.IsMatch) {
+        m_Daily = cache.Daily;
+    }
+}
 
-            // timeDefines
-            const cJSON *const pJsonTimeDefinesList = cJSON_GetObjectItemCaseSensitive(pJsonTimeSeriesWeather, "timeDefines");
-            if (!cJSON_IsArray(pJsonTimeDefinesList)) {
-                throw std::runtime_error("Illegal object type timeDefinesList.");
-            }
-            const int timeDefinesArraySize = cJSON_GetArraySize(pJsonTimeDefinesList); 
+std::time_t WeatherForecast::CalcExpireEpoch(const std::time_t fetchEpoch)
+{
+    // The daily forecast is keyed by date, so the snapshot stays valid across midnight
+    static constexpr std::time_t MINUTE_TO_SECOND = 60;
+    return fetchEpoch + CONFIG_WEATHER_FORECAST_SNAPSHOT_TTL_MINUTE * MINUTE_TO_SECOND;
+}
 
-            // weatherArea
-            const cJSON *const pJsonWeatherAreaList = cJSON_GetObjectItemCaseSensitive(pJsonTimeSeriesWeather, "areas");
-            if (!cJSON_IsArray(pJsonWeatherAreaList)) {
-                throw std::runtime_error("Illegal object type waatherAreaList.");
-            }
-            const cJSON* pJsonWeatherAreas = nullptr;
-            cJSON_ArrayForEach(pJsonWeatherAreas, pJsonWeatherAreaList) {
-                const cJSON *const pJsonArea = cJSON_GetObjectItemCaseSensitive(pJsonWeatherAreas, "area");
-                if (!cJSON_IsObject(pJsonArea)) {
-                    throw std::runtime_error("Illegal object type weatherArea.");
-                }
-
-                const cJSON *const pJsonCode = cJSON_GetObjectItemCaseSensitive(pJsonArea, "code");
-                if (!cJSON_IsString(pJsonCode)) {
-                    throw std::runtime_error("Illegal object type weaarherAreaCode.");
-                }
-
-                const int code = std::stoi(pJsonCode->valuestring);
-                if (code == m_JMAAreaForecastLocalCode) {
-                    const cJSON *const pJsonWeatherCodeList = cJSON_GetObjectItemCaseSensitive(pJsonWeatherAreas, "weatherCodes");
-                    if (!cJSON_IsArray(pJsonWeatherCodeList)) {
-                        throw std::runtime_error("Illegal object type WeatherCodeList.");
-                    }
-
-                    const int weatherCodeArraySize = cJSON_GetArraySize(pJsonWeatherCodeList); 
-                    if (timeDefinesArraySize != weatherCodeArraySize) {
-                        throw std::runtime_error("Invalid Array Size weatherCodeList");
-                    }
-                    
-                    static constexpr int FORECAST_TOMMORROW_INDEX = 1; // The next day (the forecast comes out at 09:00, so it corresponds to the day's forecast)
-                    const cJSON *const pJsonWeatherCode = cJSON_GetArrayItem(pJsonWeatherCodeList, FORECAST_TOMMORROW_INDEX);
-                    if (!cJSON_IsString(pJsonWeatherCode)) {
-                        throw std::runtime_error("Illegal object type TimeSeriesWeather.");
-                    }
-                    
-                    m_CurrentWeatherCode = std::stoi(pJsonWeatherCode->valuestring);
-
-                    break;
-                }
-            }
-        }
+WeatherForecast::RequestStatus WeatherForecast::GetRequestStatus() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_RequestStatus;
+}
 
-        {
-            // timeSeriesTemperature
-            static constexpr int TIME_SERIES_TEMPERATURE_INDEX = 2;
-            const cJSON *const pJsonTimeSeriesTemperature = cJSON_GetArrayItem(pJsonTimeSeries, TIME_SERIES_TEMPERATURE_INDEX);
-            if (!cJSON_IsObject(pJsonTimeSeriesTemperature)) {
-                throw std::runtime_error("Illegal object type timeSeriesTemperature.");
-            }
+int WeatherForecast::GetCurrentWeatherCode() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_CurrentWeatherCode;
+}
 
-            // temperatureArea
-            const cJSON *const pJsonTemperatureAreaList = cJSON_GetObjectItemCaseSensitive(pJsonTimeSeriesTemperature, "areas");
-            if (!cJSON_IsArray(pJsonTemperatureAreaList)) {
-                throw std::runtime_error("Illegal object type temperatureAreaList.");
-            }
-            const cJSON* pJsonTemperatureAreas = nullptr;
-            cJSON_ArrayForEach(pJsonTemperatureAreas, pJsonTemperatureAreaList) {
-                const cJSON *const pJsonArea = cJSON_GetObjectItemCaseSensitive(pJsonTemperatureAreas, "area");
-                if (!cJSON_IsObject(pJsonArea)) {
-                    throw std::runtime_error("Illegal object type weatherArea.");
-                }
-
-                const cJSON *const pJsonCode = cJSON_GetObjectItemCaseSensitive(pJsonArea, "code");
-                if (!cJSON_IsString(pJsonCode)) {
-                    throw std::runtime_error("Illegal object type weaarherAreaCode.");
-                }
-
-                const int code = std::stoi(pJsonCode->valuestring);
-                if (code == m_JMAAMeDASObservationPointNumber) {
-                    const cJSON *const pJsonTemperatureList = cJSON_GetObjectItemCaseSensitive(pJsonTemperatureAreas, "temps");
-                    if (!cJSON_IsArray(pJsonTemperatureList)) {
-                        throw std::runtime_error("Illegal object type WeatherCodeList.");
-                    }
-
-                    const int temperatureLength = cJSON_GetArraySize(pJsonTemperatureList); 
-                    if (temperatureLength != 2) {
-                        throw std::runtime_error("Invalid Array Size temperatureList");
-                    }
-                    
-                    //static constexpr int TEMPERATURE_MIN_INDEX = 0;
-                    static constexpr int TEMPERATURE_MAX_INDEX = 1;
-                    const cJSON *const pJsonTemperature = cJSON_GetArrayItem(pJsonTemperatureList, TEMPERATURE_MAX_INDEX);
-                    if (!cJSON_IsString(pJsonTemperature)) {
-                        throw std::runtime_error("Illegal object type temperature.");
-                    }
-                    
-                    m_CurrentMaxTemperature = std::stoi(pJsonTemperature->valuestring);
-                    break;
-                }
-            }
-        }
+int WeatherForecast::GetCurrentMaxTemperature() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_CurrentMaxTemperature;
+}
 
-        m_RequestStatus = ACQUIRED;
-        ESP_LOGD(TAG, "WeatherForecast Parse OK.");
-
-    } catch (const std::invalid_argument& e) {
-        ESP_LOGW(TAG, "Catch Exception. Invalid Argument String to Number.");
-    } catch (const std::out_of_range& e) {
-        ESP_LOGW(TAG, "Catch Exception. Out Of Range String to Number.");
-    } catch (const std::runtime_error& e) {
-        ESP_LOGW(TAG, "Catch Exception. Runtime Exception message:%s", e.what());
-    } catch(...) {
-        ESP_LOGW(TAG, "An error occurred.");
-    }
+WeatherForecast::CacheStatistics WeatherForecast::GetCacheStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_CacheStatistics;
+}
+
+HttpRequest::Timing WeatherForecast::GetLastRequestTiming() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_LastRequestTiming;
+}
 
-    cJSON_Delete(pJsonRoot);
+WeatherForecastDaily WeatherForecast::GetDailyForecast() const
+{
+    const std::int32_t today = Util::DateToDayNumber(Util::GetLocalTime());
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Daily.From(today);
 }
 
+bool WeatherForecast::IsRain() const
+{
+    return IsRainWeatherCode(GetCurrentWeatherCode());
+}
 
-const char* WeatherForecast::WeatherCodeToStr(const int weatherCode)
+bool WeatherForecast::IsRainWeatherCode(const int weatherCode)
 {
-    static const std::unordered_map<int, std::string> WEATHER_CODE_TO_STR_MAP = {
-        {100, "CLEAR"}, {101, "PARTLY CLOUDY"}, {102, "CLEAR, OCCASIONAL SCATTERED SHOWERS"}, {103, "CLEAR, FREQUENT SCATTERED SHOWERS"}, {104, "CLEAR, SNOW FLURRIES"}, {105, "CLEAR, FREQUENT SNOW FLURRIES"}, {106, "CLEAR, OCCASIONAL SCATTERED SHOWERS OR SNOW FLURRIES"}, {107, "CLEAR, FREQUENT SCATTERED SHOWERS OR SNOW FLURRIES"}, {108, "CLEAR, OCCASIONAL SCATTERED SHOWERS AND/OR THUNDER"}, {110, "CLEAR, PARTLY CLOUDY LATER"}, {111, "CLEAR, CLOUDY LATER"}, {112, "CLEAR, OCCASIONAL SCATTERED SHOWERS LATER"}, {113, "CLEAR, FREQUENT SCATTERED SHOWERS LATER"}, {114, "CLEAR,RAIN LATER"}, {115, "CLEAR, OCCASIONAL SNOW FLURRIES LATER"}, {116, "CLEAR, FREQUENT SNOW FLURRIES LATER"}, {117, "CLEAR,SNOW LATER"}, {118, "CLEAR, RAIN OR SNOW LATER"}, {119, "CLEAR, RAIN AND/OR THUNDER LATER"}, {120, "OCCASIONAL SCATTERED SHOWERS IN THE MORNING AND EVENING, CLEAR DURING THE DAY"}, {121, "OCCASIONAL SCATTERED SHOWERS IN THE MORNING, CLEAR DURING THE DAY"}, {122, "CLEAR, OCCASIONAL SCATTERED SHOWERS IN THE EVENING"}, {123, "CLEAR IN THE PLAINS, RAIN AND THUNDER NEAR MOUTAINOUS AREAS"}, {124, "CLEAR IN THE PLAINS, SNOW NEAR MOUTAINOUS AREAS"}, {125, "CLEAR, RAIN AND THUNDER IN THE AFTERNOON"}, {126, "CLEAR, RAIN IN THE AFTERNOON"}, {127, "CLEAR, RAIN IN THE EVENING"}, {128, "CLEAR, RAIN IN THE NIGHT"}, {130, "FOG IN THE MORNING, CLEAR LATER"}, {131, "FOG AROUND DAWN, CLEAR LATER"}, {132, "CLOUDY IN THE MORNING AND EVENING, CLEAR DURING THE DAY"}, {140, "CLEAR, FREQUENT SCATTERED SHOWERS AND THUNDER"}, {160, "CLEAR, SNOW FLURRIES OR OCCASIONAL SCATTERED SHOWERS"}, {170, "CLEAR, FREQUENT SNOW FLURRIES OR SCATTERED SHOWERS"}, {181, "CLEAR, SNOW OR RAIN LATER"},
-        {200, "CLOUDY"}, {201, "MOSTLY CLOUDY"}, {202, "CLOUDY, OCCASIONAL SCATTERED SHOWERS"}, {203, "CLOUDY, FREQUENT SCATTERED SHOWERS"}, {204, "CLOUDY, OCCASIONAL SNOW FLURRIES"}, {205, "CLOUDY FREQUENT SNOW FLURRIES"}, {206, "CLOUDY, OCCASIONAL SCATTERED SHOWERS OR SNOW FLURRIES"}, {207, "CLOUDY, FREQUENT SCCATERED SHOWERS OR SNOW FLURRIES"}, {208, "CLOUDY, OCCASIONAL SCATTERED SHOWERS AND/OR THUNDER"}, {209, "FOG"}, {210, "CLOUDY, PARTLY CLOUDY LATER"}, {211, "CLOUDY, CLEAR LATER"}, {212, "CLOUDY, OCCASIONAL SCATTERED SHOWERS LATER"}, {213, "CLOUDY, FREQUENT SCATTERED SHOWERS LATER"}, {214, "CLOUDY, RAIN LATER"}, {215, "CLOUDY, SNOW FLURRIES LATER"}, {216, "CLOUDY, FREQUENT SNOW FLURRIES LATER"}, {217, "CLOUDY, SNOW LATER"}, {218, "CLOUDY, RAIN OR SNOW LATER"}, {219, "CLOUDY, RAIN AND/OR THUNDER LATER"}, {220, "OCCASIONAL SCCATERED SHOWERS IN THE MORNING AND EVENING, CLOUDY DURING THE DAY"}, {221, "CLOUDY OCCASIONAL SCCATERED SHOWERS IN THE MORNING"}, {222, "CLOUDY, OCCASIONAL SCCATERED SHOWERS IN THE EVENING"}, {223, "CLOUDY IN THE MORNING AND EVENING, PARTLY CLOUDY DURING THE DAY,"}, {224, "CLOUDY, RAIN IN THE AFTERNOON"}, {225, "CLOUDY, RAIN IN THE EVENING"}, {226, "CLOUDY, RAIN IN THE NIGHT"}, {228, "CLOUDY, SNOW IN THE AFTERNOON"}, {229, "CLOUDY, SNOW IN THE EVENING"}, {230, "CLOUDY, SNOW IN THE NIGHT"}, {231, "CLOUDY, FOG OR DRIZZLING ON THE SEA AND NEAR SEASHORE"}, {240, "CLOUDY, FREQUENT SCCATERED SHOWERS AND THUNDER"}, {250, "CLOUDY, FREQUENT SNOW AND THUNDER"}, {260, "CLOUDY, SNOW FLURRIES OR OCCASIONAL SCATTERED SHOWERS"}, {270, "CLOUDY, FREQUENT SNOW FLURRIES OR SCATTERED SHOWERS"}, {281, "CLOUDY, SNOW OR RAIN LATER"},
-        {300, "RAIN"}, {301, "RAIN, PARTLY CLOUDY"}, {302, "SHOWERS THROUGHOUT THE DAY"}, {303, "RAIN,FREQUENT SNOW FLURRIES"}, {304, "RAINORSNOW"}, {306, "HEAVYRAIN"}, {308, "RAINSTORM"}, {309, "RAIN,OCCASIONAL SNOW"}, {311, "RAIN,CLEAR LATER"}, {313, "RAIN,CLOUDY LATER"}, {314, "RAIN, FREQUENT SNOW FLURRIES LATER"}, {315, "RAIN,SNOW LATER"}, {316, "RAIN OR SNOW, CLEAR LATER"}, {317, "RAIN OR SNOW, CLOUDY LATER"}, {320, "RAIN IN THE MORNING, CLEAR LATER"}, {321, "RAIN IN THE MORNING, CLOUDY LATER"}, {322, "OCCASIONAL SNOW IN THE MORNING AND EVENING, RAIN DURING THE DAY"}, {323, "RAIN, CLEAR IN THE AFTERNOON"}, {324, "RAIN, CLEAR IN THE EVENING"}, {325, "RAIN, CLEAR IN THE NIGHT"}, {326, "RAIN, SNOW IN THE EVENING"}, {327, "RAIN,SNOW IN THE NIGHT"}, {328, "RAIN, EXPECT OCCASIONAL HEAVY RAINFALL"}, {329, "RAIN, OCCASIONAL SLEET"}, {340, "SNOWORRAIN"}, {350, "RAIN AND THUNDER"}, {361, "SNOW OR RAIN, CLEAR LATER"}, {371, "SNOW OR RAIN, CLOUDY LATER"},
-        {400, "SNOW"}, {401, "SNOW, FREQUENT CLEAR"}, {402, "SNOWTHROUGHOUT THE DAY"}, {403, "SNOW,FREQUENT SCCATERED SHOWERS"}, {405, "HEAVYSNOW"}, {406, "SNOWSTORM"}, {407, "HEAVYSNOWSTORM"}, {409, "SNOW, OCCASIONAL SCCATERED SHOWERS"}, {411, "SNOW,CLEAR LATER"}, {413, "SNOW,CLOUDY LATER"}, {414, "SNOW,RAIN LATER"}, {420, "SNOW IN THE MORNING, CLEAR LATER"}, {421, "SNOW IN THE MORNING, CLOUDY LATER"}, {422, "SNOW, RAIN IN THE AFTERNOON"}, {423, "SNOW, RAIN IN THE EVENING"}, {425, "SNOW, EXPECT OCCASIONAL HEAVY SNOWFALL"}, {426, "SNOW, SLEET LATER"}, {427, "SNOW, OCCASIONAL SLEET"}, {450, "SNOW AND THUNDER"},
-    };
-/*
-    // JP
-    static const std::unordered_map<int, std::string> WEATHER_CODE_TO_STR_MAP = {
-        {100, "晴"}, {101, "晴時々曇"}, {102, "晴一時雨"}, {103, "晴時々雨"}, {104, "晴一時雪"}, {105, "晴時々雪"}, {106, "晴一時雨か雪"}, {107, "晴時々雨か雪"}, {108, "晴一時雨か雷雨"}, {110, "晴後時々曇"}, {111, "晴後曇"}, {112, "晴後一時雨"}, {113, "晴後時々雨"}, {114, "晴後雨"}, {115, "晴後一時雪"}, {116, "晴後時々雪"}, {117, "晴後雪"}, {118, "晴後雨か雪"}, {119, "晴後雨か雷雨"}, {120, "晴朝夕一時雨"}, {121, "晴朝の内一時雨"}, {122, "晴夕方一時雨"}, {123, "晴山沿い雷雨"}, {124, "晴山沿い雪"}, {125, "晴午後は雷雨"}, {126, "晴昼頃から雨"}, {127, "晴夕方から雨"}, {128, "晴夜は雨"}, {130, "朝の内霧後晴"}, {131, "晴明け方霧"}, {132, "晴朝夕曇"}, {140, "晴時々雨で雷を伴う"}, {160, "晴一時雪か雨"}, {170, "晴時々雪か雨"}, {181, "晴後雪か雨"},
-        {200, "曇"}, {201, "曇時々晴"}, {202, "曇一時雨"}, {203, "曇時々雨"}, {204, "曇一時雪"}, {205, "曇時々雪"}, {206, "曇一時雨か雪"}, {207, "曇時々雨か雪"}, {208, "曇一時雨か雷雨"}, {209, "霧"}, {210, "曇後時々晴"}, {211, "曇後晴"}, {212, "曇後一時雨"}, {213, "曇後時々雨"}, {214, "曇後雨"}, {215, "曇後一時雪"}, {216, "曇後時々雪"}, {217, "曇後雪"}, {218, "曇後雨か雪"}, {219, "曇後雨か雷雨"}, {220, "曇朝夕一時雨"}, {221, "曇朝の内一時雨"}, {222, "曇夕方一時雨"}, {223, "曇日中時々晴"}, {224, "曇昼頃から雨"}, {225, "曇夕方から雨"}, {226, "曇夜は雨"}, {228, "曇昼頃から雪"}, {229, "曇夕方から雪"}, {230, "曇夜は雪"}, {231, "曇海上海岸は霧か霧雨"}, {240, "曇時々雨で雷を伴う"}, {250, "曇時々雪で雷を伴う"}, {260, "曇一時雪か雨"}, {270, "曇時々雪か雨"}, {281, "曇後雪か雨"},
-        {300, "雨"}, {301, "雨時々晴"}, {302, "雨時々止む"}, {303, "雨時々雪"}, {304, "雨か雪"}, {306, "大雨"}, {308, "雨で暴風を伴う"}, {309, "雨一時雪"}, {311, "雨後晴"}, {313, "雨後曇"}, {314, "雨後時々雪"}, {315, "雨後雪"}, {316, "雨か雪後晴"}, {317, "雨か雪後曇"}, {320, "朝の内雨後晴"}, {321, "朝の内雨後曇"}, {322, "雨朝晩一時雪"}, {323, "雨昼頃から晴"}, {324, "雨夕方から晴"}, {325, "雨夜は晴"}, {326, "雨夕方から雪"}, {327, "雨夜は雪"}, {328, "雨一時強く降る"}, {329, "雨一時みぞれ"}, {340, "雪か雨"}, {350, "雨で雷を伴う"}, {361, "雪か雨後晴"}, {371, "雪か雨後曇"},
-        {400, "雪"}, {401, "雪時々晴"}, {402, "雪時々止む"}, {403, "雪時々雨"}, {405, "大雪"}, {406, "風雪強い"}, {407, "暴風雪"}, {409, "雪一時雨"}, {411, "雪後晴"}, {413, "雪後曇"}, {414, "雪後雨"}, {420, "朝の内雪後晴"}, {421, "朝の内雪後曇"}, {422, "雪昼頃から雨"}, {423, "雪夕方から雨"},{425, "雪一時強く降る"}, {426, "雪後みぞれ"}, {427, "雪一時みぞれ"}, {450, "雪で雷を伴う"}
-    };
-*/
+    static constexpr int WEATHER_TOP_CATEGORY_RAIN = 3;
+    static constexpr int WEATHER_TOP_CATEGORY_SNOW = 4;
+    static constexpr int WEATHER_TOP_CATEGORY_DIGITS = 100;
+    const int weatherCodeTopCategory = (weatherCode / WEATHER_TOP_CATEGORY_DIGITS);
+    return (weatherCodeTopCategory == WEATHER_TOP_CATEGORY_RAIN ||
+            weatherCodeTopCategory == WEATHER_TOP_CATEGORY_SNOW);
+}
 
-    static constexpr char EMPTY[] = "";
-    std::unordered_map<int, std::string>::const_iterator iter = WEATHER_CODE_TO_STR_MAP.find(weatherCode);
-    if (iter == WEATHER_CODE_TO_STR_MAP.end()) {
-        return EMPTY;;
+const char* WeatherForecast::WeatherCodeToStr(const int weatherCode, const Language language)
+{
+    // Binary search on the table in .rodata (no heap)
+    const WeatherCodeName *const pEnd = WEATHER_CODE_NAME_TABLE + WEATHER_CODE_NAME_COUNT;
+    const WeatherCodeName *const pFound = std::lower_bound(WEATHER_CODE_NAME_TABLE, pEnd, weatherCode,
+        [](const WeatherCodeName& weatherCodeName, const int code) {
+            return weatherCodeName.Code < code;
+        });
+    if (pFound == pEnd || pFound->Code != weatherCode) {
+        return "";
     }
-    return iter->second.c_str();
+    return (language == LANGUAGE_JA) ? pFound->Ja : pFound->En;
 }
 
 
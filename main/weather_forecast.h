@@ -6,6 +6,12 @@
 // Include ----------------------
 #include <string>
 #include <cstdint>
+#include <ctime>
+#include <mutex>
+
+#include "http_request.h"
+#include "weather_forecast_cache.h"
+#include "weather_forecast_daily.h"
 
 namespace IrrigationSystem {
 
@@ -18,6 +24,37 @@ public:
         FAILED,
     };
 
+    /// Language of the weather code name
+    enum Language {
+        LANGUAGE_EN,
+        LANGUAGE_JA,
+    };
+
+    /// Conditional request statistics
+    struct CacheStatistics
+    {
+        /// Number of requests
+        std::uint32_t RequestCount;
+        /// Number of responses reused from the cache (304 Not Modified)
+        std::uint32_t HitCount;
+        /// Number of downloaded and parsed responses
+        std::uint32_t MissCount;
+        /// Number of requests answered by the unexpired snapshot (no network)
+        std::uint32_t SnapshotCount;
+    };
+
+private:
+    /// Snapshot values copied out under the cache lock
+    struct CacheCopy
+    {
+        /// The snapshot was parsed with the requested parameters
+        bool IsMatch;
+        bool IsFresh;
+        std::time_t FetchEpoch;
+        WeatherForecastDaily Daily;
+        HttpRequest::Validator Validator;
+    };
+
 public:
     WeatherForecast();
 
@@ -25,7 +62,10 @@ public:
 
     void SetJMAParamter(const std::int32_t areaPathCode, const std::int32_t localCode, const std::int32_t AMeDASPoint);
 
-    /// Obtaining weather forecast information via the JMA API
+    /// Restore the persisted forecast snapshot (boot time. After the first Initialize, which resets the result)
+    void WarmLoad(const std::int32_t areaPathCode, const std::int32_t localCode, const std::int32_t AMeDASPoint);
+
+    /// Obtaining weather forecast information via the JMA API (blocking. Called from WeatherForecastTask)
     void Request();
 
     RequestStatus GetRequestStatus() const;
@@ -33,16 +73,49 @@ public:
     int GetCurrentMaxTemperature() const;
     bool IsRain() const;
 
+    /// Daily forecast from today. (The last acquired one is kept when the request fails)
+    WeatherForecastDaily GetDailyForecast() const;
+    CacheStatistics GetCacheStatistics() const;
+
+    /// Phase timings of the last JMA request
+    HttpRequest::Timing GetLastRequestTiming() const;
+
 private:
-    void Parse(const std::string& jsonStr);
+    /// JMA parameters set by the management task
+    void GetJMAParamter(std::int32_t& areaPathCode, std::int32_t& localCode, std::int32_t& AMeDASPoint) const;
+
+    /// Load the snapshot file once
+    void LoadCache();
+
+    /// Copy the snapshot for the parameters
+    CacheCopy CopyCache(const std::int32_t areaPathCode, const std::int32_t localCode, const std::int32_t AMeDASPoint, const std::time_t nowEpoch) const;
+
+    /// Use the snapshot if it is unexpired and matches the parameters
+    bool ApplyFreshCache(const CacheCopy& cache);
+
+    /// Snapshot expiry
+    static std::time_t CalcExpireEpoch(const std::time_t fetchEpoch);
+
+    /// Count up a statistics member (read by the httpd task)
+    void AddStatistics(std::uint32_t CacheStatistics::*const pCounter);
+
+    /// Publish the result to the other tasks. (FAILED unless the forecast covers today)
+    void SetResult(const RequestStatus requestStatus, const WeatherForecastDaily& daily);
+
+    /// Request failed. The snapshot is kept as the forecast of the coming days
+    void SetFailed(const CacheCopy& cache);
 
 public:
-    static const char* WeatherCodeToStr(const int weatherCode);
+    static const char* WeatherCodeToStr(const int weatherCode, const Language language = LANGUAGE_EN);
+
+    /// Rain or snow
+    static bool IsRainWeatherCode(const int weatherCode);
 
 private:
     RequestStatus m_RequestStatus;
     int m_CurrentWeatherCode;
     int m_CurrentMaxTemperature;
+    WeatherForecastDaily m_Daily;
 
     /// Area path code for weather forecast determination. Tokyo:130010 http://www.jma.go.jp/bosai/common/const/area.json
     std::int32_t m_JMAAreaPathCode;
@@ -50,6 +123,17 @@ private:
     std::int32_t m_JMAAreaForecastLocalCode;
     /// AMeDAS observation point number for weather forecast determination. Tokyo:44132
     std::int32_t m_JMAAMeDASObservationPointNumber;
+
+    /// Last parsed forecast and its validators
+    WeatherForecastCache m_Cache;
+    std::once_flag m_CacheLoadFlag;
+    CacheStatistics m_CacheStatistics;
+    HttpRequest::Timing m_LastRequestTiming;
+
+    /// The result, the statistics and the JMA parameters are shared between the tasks
+    mutable std::mutex m_Mutex;
+    /// The snapshot (management task, httpd workers and the forecast task). Not held with m_Mutex
+    mutable std::mutex m_CacheMutex;
 };
 
 } // IrrigationSystem
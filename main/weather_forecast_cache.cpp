@@ -0,0 +1,139 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include "weather_forecast_cache.h"
+
+#include <cstring>
+
+#include "logger.h"
+#include "file_system.h"
+
+namespace IrrigationSystem {
+
+WeatherForecastCache::WeatherForecastCache()
+    :m_IsValid(false)
+    ,m_Record()
+{}
+
+bool WeatherForecastCache::Load()
+{
+    m_IsValid = false;
+
+    FileSystem::File file;
+    if (!file.Open(CACHE_FILE_NAME, "rb")) {
+        return false;
+    }
+    Record record = {};
+    if (file.Read(&record, sizeof(record)) != sizeof(record) ||
+        record.Magic != RECORD_MAGIC ||
+        record.Version != RECORD_VERSION ||
+        record.Size != sizeof(record)) {
+        ESP_LOGW(TAG, "Invalid forecast cache record.");
+        return false;
+    }
+    // Terminate
+    record.ETag[ETAG_LENGTH - 1] = '\0';
+    record.LastModified[LAST_MODIFIED_LENGTH - 1] = '\0';
+    if (WeatherForecastDaily::MAX_DAYS < record.Daily.DayCount) {
+        record.Daily.DayCount = WeatherForecastDaily::MAX_DAYS;
+    }
+
+    m_Record = record;
+    m_IsValid = true;
+    return true;
+}
+
+bool WeatherForecastCache::Save(const std::int32_t areaPathCode, const std::int32_t localCode, const std::int32_t AMeDASPoint,
+                                const WeatherForecastDaily& daily, const HttpRequest::Validator& validator,
+                                const std::time_t fetchEpoch, const std::time_t expireEpoch)
+{
+    Record record = {};
+    record.Magic = RECORD_MAGIC;
+    record.Version = RECORD_VERSION;
+    record.Size = sizeof(record);
+    record.FetchEpoch = fetchEpoch;
+    record.ExpireEpoch = expireEpoch;
+    record.AreaPathCode = areaPathCode;
+    record.LocalCode = localCode;
+    record.AMeDASPoint = AMeDASPoint;
+    record.Daily = daily;
+    if (validator.ETag.length() < ETAG_LENGTH && validator.LastModified.length() < LAST_MODIFIED_LENGTH) {
+        std::strncpy(record.ETag, validator.ETag.c_str(), ETAG_LENGTH - 1);
+        std::strncpy(record.LastModified, validator.LastModified.c_str(), LAST_MODIFIED_LENGTH - 1);
+    } else {
+        ESP_LOGW(TAG, "Validator is too long to cache.");
+    }
+    return Write(record);
+}
+
+bool WeatherForecastCache::Refresh(const std::time_t fetchEpoch, const std::time_t expireEpoch)
+{
+    if (!m_IsValid) {
+        return false;
+    }
+    Record record = m_Record;
+    record.FetchEpoch = fetchEpoch;
+    record.ExpireEpoch = expireEpoch;
+    return Write(record);
+}
+
+bool WeatherForecastCache::Write(const Record& record)
+{
+    FileSystem::File file;
+    const bool isWritten = file.Open(CACHE_TEMP_FILE_NAME, "wb") && file.Write(&record, sizeof(record));
+    // fclose writes the rest of the record
+    if (!file.Close() || !isWritten) {
+        ESP_LOGW(TAG, "Failed to write forecast cache.");
+        FileSystem::Delete(CACHE_TEMP_FILE_NAME);
+        return false;
+    }
+    if (!FileSystem::Rename(CACHE_TEMP_FILE_NAME, CACHE_FILE_NAME)) {
+        ESP_LOGW(TAG, "Failed to replace forecast cache.");
+        FileSystem::Delete(CACHE_TEMP_FILE_NAME);
+        return false;
+    }
+
+    m_Record = record;
+    m_IsValid = true;
+    return true;
+}
+
+bool WeatherForecastCache::IsMatch(const std::int32_t areaPathCode, const std::int32_t localCode, const std::int32_t AMeDASPoint) const
+{
+    return m_IsValid &&
+           m_Record.AreaPathCode == areaPathCode &&
+           m_Record.LocalCode == localCode &&
+           m_Record.AMeDASPoint == AMeDASPoint;
+}
+
+bool WeatherForecastCache::IsFresh(const std::time_t nowEpoch) const
+{
+    return m_IsValid &&
+           m_Record.FetchEpoch <= nowEpoch &&
+           nowEpoch < m_Record.ExpireEpoch;
+}
+
+HttpRequest::Validator WeatherForecastCache::GetValidator() const
+{
+    HttpRequest::Validator validator;
+    if (m_IsValid) {
+        validator.ETag = m_Record.ETag;
+        validator.LastModified = m_Record.LastModified;
+    }
+    return validator;
+}
+
+const WeatherForecastDaily& WeatherForecastCache::GetDaily() const
+{
+    return m_Record.Daily;
+}
+
+std::time_t WeatherForecastCache::GetFetchEpoch() const
+{
+    return static_cast<std::time_t>(m_Record.FetchEpoch);
+}
+
+} // IrrigationSystem
+
+// EOF
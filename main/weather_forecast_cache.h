@@ -0,0 +1,83 @@
+#ifndef WEATHER_FORECAST_CACHE_H_
+#define WEATHER_FORECAST_CACHE_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include <cstdint>
+#include <ctime>
+
+#include "http_request.h"
+#include "weather_forecast_daily.h"
+
+namespace IrrigationSystem {
+
+/// Snapshot of the parsed weather forecast with its HTTP validators (stored on the FAT partition)
+/// It survives reboot and is used until the expiry without a network request.
+/// Not thread safe (WeatherForecast guards it with its cache mutex).
+class WeatherForecastCache final
+{
+private:
+    static constexpr char *const CACHE_FILE_NAME = (char*)"forecast_cache.bin";
+    /// Written first and renamed over the snapshot
+    static constexpr char *const CACHE_TEMP_FILE_NAME = (char*)"forecast_cache.tmp";
+    static constexpr std::uint32_t RECORD_MAGIC = 0x43464A57; // "WJFC"
+    static constexpr std::uint16_t RECORD_VERSION = 3;
+    static constexpr std::size_t ETAG_LENGTH = 64;
+    static constexpr std::size_t LAST_MODIFIED_LENGTH = 32;
+
+    /// File layout
+    struct Record
+    {
+        std::uint32_t Magic;
+        std::uint16_t Version;
+        std::uint16_t Size;
+        std::int64_t FetchEpoch;
+        std::int64_t ExpireEpoch;
+        std::int32_t AreaPathCode;
+        std::int32_t LocalCode;
+        std::int32_t AMeDASPoint;
+        WeatherForecastDaily Daily;
+        char ETag[ETAG_LENGTH];
+        char LastModified[LAST_MODIFIED_LENGTH];
+    };
+
+public:
+    WeatherForecastCache();
+
+    /// Read the record from the file
+    bool Load();
+
+    /// Store the parsed result and validators. (Validators too long to store are dropped)
+    bool Save(const std::int32_t areaPathCode, const std::int32_t localCode, const std::int32_t AMeDASPoint,
+              const WeatherForecastDaily& daily, const HttpRequest::Validator& validator,
+              const std::time_t fetchEpoch, const std::time_t expireEpoch);
+
+    /// Extend the expiry of the current record (304 Not Modified)
+    bool Refresh(const std::time_t fetchEpoch, const std::time_t expireEpoch);
+
+    /// The record was parsed with the same parameters
+    bool IsMatch(const std::int32_t areaPathCode, const std::int32_t localCode, const std::int32_t AMeDASPoint) const;
+
+    /// The snapshot can be used without a request
+    bool IsFresh(const std::time_t nowEpoch) const;
+
+    /// Validators for the conditional request
+    HttpRequest::Validator GetValidator() const;
+
+    const WeatherForecastDaily& GetDaily() const;
+    std::time_t GetFetchEpoch() const;
+
+private:
+    /// Replace the file. The old snapshot is kept when the new one can not be written
+    bool Write(const Record& record);
+
+private:
+    bool m_IsValid;
+    Record m_Record;
+};
+
+} // IrrigationSystem
+
+#endif // WEATHER_FORECAST_CACHE_H_
+// EOF
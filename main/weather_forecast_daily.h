@@ -0,0 +1,62 @@
+#ifndef WEATHER_FORECAST_DAILY_H_
+#define WEATHER_FORECAST_DAILY_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include <cstddef>
+#include <cstdint>
+
+namespace IrrigationSystem {
+
+/// Daily weather forecast of the near-term and weekly series (struct of arrays)
+/// Fixed size and trivially copyable. (It is stored in the forecast snapshot as is)
+struct WeatherForecastDaily
+{
+    /// The near-term forecast day and the 7 days of the weekly forecast
+    static constexpr std::size_t MAX_DAYS = 8;
+
+    static constexpr std::uint8_t FLAG_WEATHER_CODE = 0x01;
+    static constexpr std::uint8_t FLAG_MAX_TEMPERATURE = 0x02;
+
+    /// Date of index 0 (Util::DateToDayNumber)
+    std::int32_t BaseDay;
+    /// Number of days from index 0
+    std::uint8_t DayCount;
+    std::uint8_t Flags[MAX_DAYS];
+    std::int16_t WeatherCode[MAX_DAYS];
+    std::int8_t MaxTemperature[MAX_DAYS];
+
+    bool HasWeatherCode(const std::size_t index) const
+    {
+        return index < DayCount && (Flags[index] & FLAG_WEATHER_CODE) != 0;
+    }
+
+    bool HasMaxTemperature(const std::size_t index) const
+    {
+        return index < DayCount && (Flags[index] & FLAG_MAX_TEMPERATURE) != 0;
+    }
+
+    /// The forecast from the given date (index 0 becomes that day. Past days are dropped)
+    WeatherForecastDaily From(const std::int32_t day) const
+    {
+        WeatherForecastDaily daily = {};
+        daily.BaseDay = day;
+        const std::int32_t offset = day - BaseDay;
+        if (offset < 0 || DayCount <= offset) {
+            return daily;
+        }
+        daily.DayCount = static_cast<std::uint8_t>(DayCount - offset);
+        for (std::size_t i = 0; i < daily.DayCount; ++i) {
+            daily.Flags[i] = Flags[i + offset];
+            daily.WeatherCode[i] = WeatherCode[i + offset];
+            daily.MaxTemperature[i] = MaxTemperature[i + offset];
+        }
+        return daily;
+    }
+};
+
+} // IrrigationSystem
+
+#endif // WEATHER_FORECAST_DAILY_H_
+// EOF
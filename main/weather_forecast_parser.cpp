@@ -0,0 +1,314 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include "weather_forecast_parser.h"
+
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+#include <climits>
+
+#include "logger.h"
+#include "util.h"
+
+namespace {
+    // JMA forecast json layout
+    //  [ {"timeSeries":[ {"timeDefines":[...], "areas":[ {"area":{"code":"130010"}, "weatherCodes":[...]} ]}, {...}, {"timeDefines":[...], "areas":[ {"area":{"code":"44132"}, "temps":[...]} ]} ]},
+    //    {"timeSeries":[ {"timeDefines":[...], "areas":[ {"area":{"code":"130010"}, "weatherCodes":[...]} ]}, {"timeDefines":[...], "areas":[ {"area":{"code":"44132"}, "tempsMax":[...]} ]} ]} ]
+    constexpr std::size_t DEPTH_ROOT_ITEM = 0;
+    constexpr std::size_t DEPTH_TIME_SERIES = 1;
+    constexpr std::size_t DEPTH_TIME_SERIES_ITEM = 2;
+    constexpr std::size_t DEPTH_TIME_SERIES_MEMBER = 3;
+    constexpr std::size_t DEPTH_TIME_DEFINE_ITEM = 4;
+    constexpr std::size_t DEPTH_AREAS = 3;
+    constexpr std::size_t DEPTH_AREA_ITEM = 4;
+    constexpr std::size_t DEPTH_AREA_MEMBER = 5;
+    constexpr std::size_t DEPTH_AREA_MEMBER_ITEM = 6;
+
+    constexpr std::int32_t JSON_FORECAST_NEAR_IDX = 0;
+    constexpr std::int32_t JSON_FORECAST_WEEK_IDX = 1;
+    constexpr std::int32_t ROOT_ARRAY_SIZE = 2;
+    constexpr std::int32_t TIME_SERIES_WEATHER_NEAR_LENGTH = 3;
+    constexpr std::int32_t TIME_SERIES_WEATHER_INDEX = 0;
+    constexpr std::int32_t TIME_SERIES_TEMPERATURE_INDEX = 2;
+    constexpr std::int32_t TIME_SERIES_WEEK_WEATHER_INDEX = 0;
+    constexpr std::int32_t TIME_SERIES_WEEK_TEMPERATURE_INDEX = 1;
+    //constexpr std::int32_t TEMPERATURE_MIN_INDEX = 0;
+    constexpr std::int32_t TEMPERATURE_MAX_INDEX = 1;
+}
+
+namespace IrrigationSystem {
+
+WeatherForecastParser::WeatherForecastParser(const std::int32_t localCode, const std::int32_t AMeDASPoint)
+    :m_JsonStreamParser(*this)
+    ,m_LocalCode(localCode)
+    ,m_AMeDASPoint(AMeDASPoint)
+    ,m_RootArraySize(0)
+    ,m_TimeSeriesArraySize(0)
+    ,m_AreaCode(0)
+    ,m_AreaValue()
+    ,m_AreaValueMask(0)
+    ,m_SeriesData()
+    ,m_Daily()
+{}
+
+bool WeatherForecastParser::Feed(const char *const pData, const std::size_t length)
+{
+    return m_JsonStreamParser.Feed(pData, length);
+}
+
+bool WeatherForecastParser::Finish()
+{
+    if (!m_JsonStreamParser.Finish()) {
+        ESP_LOGW(TAG, "Json Parse Error.");
+        return false;
+    }
+    if (m_RootArraySize != ROOT_ARRAY_SIZE) {
+        ESP_LOGW(TAG, "Invalid Array Size root");
+        return false;
+    }
+    if (m_TimeSeriesArraySize != TIME_SERIES_WEATHER_NEAR_LENGTH) {
+        ESP_LOGW(TAG, "Invalid Array Size timeSeries");
+        return false;
+    }
+    if (!m_SeriesData[SERIES_NEAR_WEATHER].IsFound) {
+        ESP_LOGW(TAG, "Not found weatherCode. localCode:%d", m_LocalCode);
+        return false;
+    }
+    if (!m_SeriesData[SERIES_NEAR_TEMPERATURE].IsFound) {
+        ESP_LOGW(TAG, "Not found temperature. AMeDAS:%d", m_AMeDASPoint);
+        return false;
+    }
+    if (!m_SeriesData[SERIES_WEEK_WEATHER].IsFound || !m_SeriesData[SERIES_WEEK_TEMPERATURE].IsFound) {
+        // The near-term forecast alone is still usable
+        ESP_LOGI(TAG, "Weekly forecast is not found. localCode:%d AMeDAS:%d", m_LocalCode, m_AMeDASPoint);
+    }
+
+    BuildDaily();
+    if (m_Daily.DayCount == 0) {
+        ESP_LOGW(TAG, "Invalid timeDefines");
+        return false;
+    }
+    return true;
+}
+
+const WeatherForecastDaily& WeatherForecastParser::GetDaily() const
+{
+    return m_Daily;
+}
+
+void WeatherForecastParser::OnBeginContainer(const JsonStreamParser& parser, const JsonStreamParser::ContainerType type)
+{
+    const std::size_t depth = parser.GetDepth();
+    if (depth == DEPTH_ROOT_ITEM + 1) {
+        // Root array element
+        m_RootArraySize = parser.GetIndex(DEPTH_ROOT_ITEM) + 1;
+    } else if (depth == DEPTH_TIME_SERIES_ITEM + 1 &&
+               parser.IsIndex(DEPTH_ROOT_ITEM, JSON_FORECAST_NEAR_IDX) &&
+               parser.IsKey(DEPTH_TIME_SERIES, "timeSeries")) {
+        m_TimeSeriesArraySize = parser.GetIndex(DEPTH_TIME_SERIES_ITEM) + 1;
+    } else if (depth == DEPTH_AREA_ITEM + 1 && IsAreaPath(parser)) {
+        // Begin area element
+        m_AreaCode = 0;
+        m_AreaValueMask = 0;
+    }
+}
+
+void WeatherForecastParser::OnEndContainer(const JsonStreamParser& parser, const JsonStreamParser::ContainerType type)
+{
+    if (parser.GetDepth() != DEPTH_AREA_ITEM + 1 || !IsAreaPath(parser)) {
+        return;
+    }
+    const Series series = GetSeries(parser);
+    if (series == SERIES_NONE) {
+        return;
+    }
+
+    // End area element. (The order of the members is not guaranteed)
+    const bool isWeather = (series == SERIES_NEAR_WEATHER || series == SERIES_WEEK_WEATHER);
+    const std::int32_t targetCode = isWeather ? m_LocalCode : m_AMeDASPoint;
+    SeriesData& seriesData = m_SeriesData[series];
+    if (m_AreaCode == targetCode && (!seriesData.IsFound || seriesData.IsFallback)) {
+        seriesData.IsFallback = false;
+    } else if (series == SERIES_WEEK_WEATHER && !seriesData.IsFound && parser.IsIndex(DEPTH_AREA_ITEM, 0)) {
+        // The weekly forecast is divided into wider areas. Use the first one unless the local code is found
+        seriesData.IsFallback = true;
+    } else {
+        return;
+    }
+    seriesData.IsFound = true;
+    seriesData.ValueMask = m_AreaValueMask;
+    for (std::size_t i = 0; i < MAX_SERIES_LENGTH; ++i) {
+        seriesData.Value[i] = m_AreaValue[i];
+    }
+}
+
+void WeatherForecastParser::OnValue(const JsonStreamParser& parser, const JsonStreamParser::ValueType type, const char *const pValue)
+{
+    if (type != JsonStreamParser::VALUE_STRING) {
+        return;
+    }
+    const Series series = GetSeries(parser);
+    if (series == SERIES_NONE) {
+        return;
+    }
+
+    const std::size_t depth = parser.GetDepth();
+    if (depth == DEPTH_TIME_DEFINE_ITEM + 1 && parser.IsKey(DEPTH_TIME_SERIES_MEMBER, "timeDefines")) {
+        const std::int32_t index = parser.GetIndex(DEPTH_TIME_DEFINE_ITEM);
+        if (index < 0 || static_cast<std::int32_t>(MAX_SERIES_LENGTH) <= index) {
+            return;
+        }
+        SeriesData& seriesData = m_SeriesData[series];
+        if (StrToDay(pValue, seriesData.Day[index])) {
+            seriesData.DayMask |= (1 << index);
+        }
+        return;
+    }
+
+    if (depth != DEPTH_AREA_MEMBER_ITEM + 1 || !IsAreaPath(parser)) {
+        return;
+    }
+    if (parser.IsKey(DEPTH_AREA_MEMBER, "area")) {
+        if (parser.IsKey(DEPTH_AREA_MEMBER_ITEM, "code")) {
+            StrToInt(pValue, m_AreaCode);
+        }
+    } else if (parser.IsKey(DEPTH_AREA_MEMBER, GetValueKey(series))) {
+        // Days without a forecast are empty strings and are skipped
+        const std::int32_t index = parser.GetIndex(DEPTH_AREA_MEMBER_ITEM);
+        int value = 0;
+        if (0 <= index && index < static_cast<std::int32_t>(MAX_SERIES_LENGTH) && StrToInt(pValue, value)) {
+            m_AreaValue[index] = static_cast<std::int16_t>(value);
+            m_AreaValueMask |= (1 << index);
+        }
+    }
+}
+
+void WeatherForecastParser::BuildDaily()
+{
+    m_Daily = WeatherForecastDaily();
+
+    // Index 0 is the first day of the near-term forecast (the day of the announcement)
+    const SeriesData& nearWeather = m_SeriesData[SERIES_NEAR_WEATHER];
+    bool isFoundBaseDay = false;
+    for (std::size_t i = 0; i < MAX_SERIES_LENGTH; ++i) {
+        if ((nearWeather.DayMask & (1 << i)) != 0 && (!isFoundBaseDay || nearWeather.Day[i] < m_Daily.BaseDay)) {
+            m_Daily.BaseDay = nearWeather.Day[i];
+            isFoundBaseDay = true;
+        }
+    }
+    if (!isFoundBaseDay) {
+        return;
+    }
+
+    for (std::size_t i = 0; i < MAX_SERIES_LENGTH; ++i) {
+        MergeSeries(SERIES_NEAR_WEATHER, i, WeatherForecastDaily::FLAG_WEATHER_CODE, true);
+        MergeSeries(SERIES_WEEK_WEATHER, i, WeatherForecastDaily::FLAG_WEATHER_CODE, false);
+        MergeSeries(SERIES_WEEK_TEMPERATURE, i, WeatherForecastDaily::FLAG_MAX_TEMPERATURE, false);
+    }
+    // The near-term temperatures are the minimum and the maximum of the next day
+    MergeSeries(SERIES_NEAR_TEMPERATURE, TEMPERATURE_MAX_INDEX, WeatherForecastDaily::FLAG_MAX_TEMPERATURE, true);
+}
+
+void WeatherForecastParser::MergeSeries(const Series series, const std::size_t index, const std::uint8_t flag, const bool isOverwrite)
+{
+    const SeriesData& seriesData = m_SeriesData[series];
+    const std::uint8_t bit = (1 << index);
+    if (!seriesData.IsFound || (seriesData.DayMask & bit) == 0 || (seriesData.ValueMask & bit) == 0) {
+        return;
+    }
+
+    const std::int32_t dayIndex = seriesData.Day[index] - m_Daily.BaseDay;
+    if (dayIndex < 0 || static_cast<std::int32_t>(WeatherForecastDaily::MAX_DAYS) <= dayIndex) {
+        return;
+    }
+    if (!isOverwrite && (m_Daily.Flags[dayIndex] & flag) != 0) {
+        return;
+    }
+
+    if (flag == WeatherForecastDaily::FLAG_WEATHER_CODE) {
+        m_Daily.WeatherCode[dayIndex] = seriesData.Value[index];
+    } else {
+        m_Daily.MaxTemperature[dayIndex] = static_cast<std::int8_t>(seriesData.Value[index]);
+    }
+    m_Daily.Flags[dayIndex] |= flag;
+    if (m_Daily.DayCount <= dayIndex) {
+        m_Daily.DayCount = static_cast<std::uint8_t>(dayIndex + 1);
+    }
+}
+
+WeatherForecastParser::Series WeatherForecastParser::GetSeries(const JsonStreamParser& parser)
+{
+    if (!parser.IsKey(DEPTH_TIME_SERIES, "timeSeries")) {
+        return SERIES_NONE;
+    }
+    const std::int32_t timeSeriesIndex = parser.GetIndex(DEPTH_TIME_SERIES_ITEM);
+    if (parser.IsIndex(DEPTH_ROOT_ITEM, JSON_FORECAST_NEAR_IDX)) {
+        if (timeSeriesIndex == TIME_SERIES_WEATHER_INDEX) {
+            return SERIES_NEAR_WEATHER;
+        } else if (timeSeriesIndex == TIME_SERIES_TEMPERATURE_INDEX) {
+            return SERIES_NEAR_TEMPERATURE;
+        }
+    } else if (parser.IsIndex(DEPTH_ROOT_ITEM, JSON_FORECAST_WEEK_IDX)) {
+        if (timeSeriesIndex == TIME_SERIES_WEEK_WEATHER_INDEX) {
+            return SERIES_WEEK_WEATHER;
+        } else if (timeSeriesIndex == TIME_SERIES_WEEK_TEMPERATURE_INDEX) {
+            return SERIES_WEEK_TEMPERATURE;
+        }
+    }
+    return SERIES_NONE;
+}
+
+bool WeatherForecastParser::IsAreaPath(const JsonStreamParser& parser)
+{
+    return parser.IsKey(DEPTH_TIME_SERIES, "timeSeries") &&
+           parser.IsKey(DEPTH_AREAS, "areas") &&
+           parser.GetIndex(DEPTH_AREA_ITEM) >= 0;
+}
+
+const char* WeatherForecastParser::GetValueKey(const Series series)
+{
+    switch (series) {
+    case SERIES_NEAR_WEATHER:
+    case SERIES_WEEK_WEATHER:
+        return "weatherCodes";
+    case SERIES_NEAR_TEMPERATURE:
+        return "temps";
+    case SERIES_WEEK_TEMPERATURE:
+        return "tempsMax";
+    default:
+        break;
+    }
+    return "";
+}
+
+bool WeatherForecastParser::StrToInt(const char *const pValue, int& value)
+{
+    char* pEnd = nullptr;
+    errno = 0;
+    const long result = std::strtol(pValue, &pEnd, 10);
+    if (pEnd == pValue || *pEnd != '\0' || errno == ERANGE || result < INT_MIN || INT_MAX < result) {
+        return false;
+    }
+    value = static_cast<int>(result);
+    return true;
+}
+
+bool WeatherForecastParser::StrToDay(const char *const pValue, std::int32_t& day)
+{
+    // The date part is JST as it is
+    int year = 0;
+    int month = 0;
+    int dayOfMonth = 0;
+    if (std::sscanf(pValue, "%4d-%2d-%2d", &year, &month, &dayOfMonth) != 3 ||
+        month < 1 || 12 < month || dayOfMonth < 1 || 31 < dayOfMonth) {
+        return false;
+    }
+    day = Util::DateToDayNumber(year, month, dayOfMonth);
+    return true;
+}
+
+} // IrrigationSystem
+
+// EOF
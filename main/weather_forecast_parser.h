@@ -0,0 +1,109 @@
+#ifndef WEATHER_FORECAST_PARSER_H_
+#define WEATHER_FORECAST_PARSER_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include <cstddef>
+#include <cstdint>
+
+#include "json_stream_parser.h"
+#include "weather_forecast_daily.h"
+
+namespace IrrigationSystem {
+
+/// JMA forecast json extractor
+/// It is fed with the response chunks and keeps only the values of the configured area.
+/// The near-term and the weekly series are merged into a daily forecast.
+class WeatherForecastParser final : public JsonStreamParser::Listener
+{
+private:
+    /// Extracted time series
+    enum Series : int {
+        SERIES_NEAR_WEATHER,
+        SERIES_NEAR_TEMPERATURE,
+        SERIES_WEEK_WEATHER,
+        SERIES_WEEK_TEMPERATURE,
+        MAX_SERIES,
+        SERIES_NONE = MAX_SERIES,
+    };
+
+    /// Longest series (weekly)
+    static constexpr std::size_t MAX_SERIES_LENGTH = 8;
+
+    /// Values of a series. (timeDefines and the area values are kept by index)
+    struct SeriesData
+    {
+        std::int32_t Day[MAX_SERIES_LENGTH];
+        std::int16_t Value[MAX_SERIES_LENGTH];
+        std::uint8_t DayMask;
+        std::uint8_t ValueMask;
+        bool IsFound;
+        bool IsFallback;
+    };
+
+public:
+    WeatherForecastParser(const std::int32_t localCode, const std::int32_t AMeDASPoint);
+
+    /// Feed a part of the response body
+    bool Feed(const char *const pData, const std::size_t length);
+
+    /// Notify the end of the response body. Return true if the near-term values have been found.
+    bool Finish();
+
+    /// Merged daily forecast (valid after Finish)
+    const WeatherForecastDaily& GetDaily() const;
+
+private:
+    /// (JsonStreamParser::Listener:override)
+    void OnBeginContainer(const JsonStreamParser& parser, const JsonStreamParser::ContainerType type) override;
+
+    /// (JsonStreamParser::Listener:override)
+    void OnEndContainer(const JsonStreamParser& parser, const JsonStreamParser::ContainerType type) override;
+
+    /// (JsonStreamParser::Listener:override)
+    void OnValue(const JsonStreamParser& parser, const JsonStreamParser::ValueType type, const char *const pValue) override;
+
+    /// Merge the series into m_Daily
+    void BuildDaily();
+
+    /// Put the series value into m_Daily. (Near-term values take precedence over weekly ones)
+    void MergeSeries(const Series series, const std::size_t index, const std::uint8_t flag, const bool isOverwrite);
+
+    /// timeSeries of the current location
+    static Series GetSeries(const JsonStreamParser& parser);
+
+    /// The current location is timeSeries[*].areas[*]
+    static bool IsAreaPath(const JsonStreamParser& parser);
+
+    /// Area value member of the series
+    static const char* GetValueKey(const Series series);
+
+    static bool StrToInt(const char *const pValue, int& value);
+
+    /// "2021-05-01T17:00:00+09:00" to the day number
+    static bool StrToDay(const char *const pValue, std::int32_t& day);
+
+private:
+    JsonStreamParser m_JsonStreamParser;
+
+    std::int32_t m_LocalCode;
+    std::int32_t m_AMeDASPoint;
+
+    std::int32_t m_RootArraySize;
+    std::int32_t m_TimeSeriesArraySize;
+
+    // Current area element
+    int m_AreaCode;
+    std::int16_t m_AreaValue[MAX_SERIES_LENGTH];
+    std::uint8_t m_AreaValueMask;
+
+    // Result
+    SeriesData m_SeriesData[MAX_SERIES];
+    WeatherForecastDaily m_Daily;
+};
+
+} // IrrigationSystem
+
+#endif // WEATHER_FORECAST_PARSER_H_
+// EOF
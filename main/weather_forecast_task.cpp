@@ -0,0 +1,195 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include "weather_forecast_task.h"
+
+#include <esp_timer.h>
+
+#include "logger.h"
+#include "util.h"
+#include "weather_forecast.h"
+#include "http_client_pool.h"
+#include "status_snapshot.h"
+#include "metrics.h"
+
+namespace IrrigationSystem {
+
+namespace {
+
+Metric s_ForecastSuccessMetric("irrigation_forecast_fetch_total", "Weather forecast fetches by outcome", Metric::TYPE_COUNTER, "outcome=\"success\"");
+Metric s_ForecastGiveUpMetric("irrigation_forecast_fetch_total", "Weather forecast fetches by outcome", Metric::TYPE_COUNTER, "outcome=\"give_up\"");
+Metric s_ForecastAttemptMetric("irrigation_forecast_attempt_total", "Weather forecast requests including retries", Metric::TYPE_COUNTER);
+Metric s_ForecastLatencySumMetric("irrigation_forecast_latency_milliseconds_sum", "Total latency of the weather forecast requests", Metric::TYPE_COUNTER);
+Metric s_ForecastLatencyMetric("irrigation_forecast_latency_milliseconds", "Latency of the last weather forecast request", Metric::TYPE_GAUGE);
+
+} // namespace
+
+WeatherForecastTask::WeatherForecastTask(const IrrigationInterfaceWeakPtr pIrrigationInterface)
+    :Task(TASK_NAME, PRIORITY, CORE_ID)
+    ,m_pIrrigationInterface(pIrrigationInterface)
+    ,m_EventGroup(xEventGroupCreate())
+    ,m_Mutex()
+    ,m_AreaPathCode(0)
+    ,m_LocalCode(0)
+    ,m_AMeDASPoint(0)
+    ,m_RetryDeadlineEpoch(0)
+    ,m_RetryBackoff(CONFIG_WEATHER_FORECAST_RETRY_BASE_SECOND, CONFIG_WEATHER_FORECAST_RETRY_MAX_SECOND)
+    ,m_IsRetryWaiting(false)
+    ,m_NextAttemptTime(0)
+    ,m_FetchStatistics()
+{}
+
+WeatherForecastTask::~WeatherForecastTask()
+{
+    if (m_EventGroup) {
+        vEventGroupDelete(m_EventGroup);
+    }
+}
+
+void WeatherForecastTask::Update()
+{
+    // Wake up periodically so that Stop() and the retry time are observed
+    static constexpr int WAIT_MILLISECOND = 1000;
+    const EventBits_t bits = xEventGroupWaitBits(m_EventGroup, FETCH_REQUEST_BIT, pdTRUE, pdFALSE, pdMS_TO_TICKS(WAIT_MILLISECOND));
+    if ((bits & FETCH_REQUEST_BIT) != 0) {
+        // A new request replaces the retry in progress
+        m_RetryBackoff.Reset();
+        m_IsRetryWaiting = false;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            ++m_FetchStatistics.FetchCount;
+            m_FetchStatistics.LastOutcome = WeatherForecastFetchStatistics::OUTCOME_IN_PROGRESS;
+        }
+        Attempt();
+    } else if (m_IsRetryWaiting && m_NextAttemptTime <= esp_timer_get_time()) {
+        m_IsRetryWaiting = false;
+        Attempt();
+    }
+
+    // Do not keep the TLS connection open between the fetches
+    HttpClientPool::GetInstance().CloseIdleConnections();
+}
+
+void WeatherForecastTask::RequestFetch(const std::int32_t areaPathCode, const std::int32_t localCode, const std::int32_t AMeDASPoint, const std::time_t retryDeadlineEpoch)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_AreaPathCode = areaPathCode;
+        m_LocalCode = localCode;
+        m_AMeDASPoint = AMeDASPoint;
+        m_RetryDeadlineEpoch = retryDeadlineEpoch;
+    }
+    xEventGroupClearBits(m_EventGroup, FETCH_COMPLETE_BIT);
+    xEventGroupSetBits(m_EventGroup, FETCH_REQUEST_BIT);
+}
+
+bool WeatherForecastTask::IsFetchComplete() const
+{
+    return (xEventGroupGetBits(m_EventGroup) & FETCH_COMPLETE_BIT) != 0;
+}
+
+WeatherForecastFetchStatistics WeatherForecastTask::GetFetchStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_FetchStatistics;
+}
+
+void WeatherForecastTask::Attempt()
+{
+    std::int32_t areaPathCode = 0;
+    std::int32_t localCode = 0;
+    std::int32_t AMeDASPoint = 0;
+    std::time_t retryDeadlineEpoch = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        areaPathCode = m_AreaPathCode;
+        localCode = m_LocalCode;
+        AMeDASPoint = m_AMeDASPoint;
+        retryDeadlineEpoch = m_RetryDeadlineEpoch;
+    }
+
+    const IrrigationInterfaceSharedPtr irrigationInterface = m_pIrrigationInterface.lock();
+    if (!irrigationInterface) {
+        ESP_LOGE(TAG, "Failed IrrigationInterface is null");
+        Complete(WeatherForecastFetchStatistics::OUTCOME_GIVE_UP);
+        return;
+    }
+
+    const std::int64_t beginTime = esp_timer_get_time();
+
+    WeatherForecast& weatherForecast = irrigationInterface->GetWeatherForecast();
+    weatherForecast.SetJMAParamter(areaPathCode, localCode, AMeDASPoint);
+    weatherForecast.Request();
+
+    static constexpr std::int64_t MICRO_TO_MILLI = 1000;
+    const std::uint32_t latency = static_cast<std::uint32_t>((esp_timer_get_time() - beginTime) / MICRO_TO_MILLI);
+    const bool isSuccess = (weatherForecast.GetRequestStatus() == WeatherForecast::ACQUIRED);
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        ++m_FetchStatistics.AttemptCount;
+        s_ForecastAttemptMetric.Add();
+        s_ForecastLatencySumMetric.Add(latency);
+        s_ForecastLatencyMetric.Set(latency);
+        m_FetchStatistics.LastLatencyMillisecond = latency;
+        if (m_FetchStatistics.MaxLatencyMillisecond < latency) {
+            m_FetchStatistics.MaxLatencyMillisecond = latency;
+        }
+    }
+    ESP_LOGI(TAG, "WeatherForecast fetch. result:%s retry:%u elapsed:%ums",
+        isSuccess ? "OK" : "NG", m_RetryBackoff.GetRetryCount(), latency);
+
+    if (isSuccess) {
+        Complete(WeatherForecastFetchStatistics::OUTCOME_SUCCESS);
+        return;
+    }
+
+    // Retry unless the next attempt is beyond the deadline
+    const std::uint32_t delaySecond = m_RetryBackoff.NextDelaySecond();
+    if (retryDeadlineEpoch < Util::GetEpoch() + static_cast<std::time_t>(delaySecond)) {
+        ESP_LOGW(TAG, "WeatherForecast fetch give up. Deadline:%s", Util::TimeToStr(Util::EpochToLocalTime(retryDeadlineEpoch)).c_str());
+        Complete(WeatherForecastFetchStatistics::OUTCOME_GIVE_UP);
+        return;
+    }
+
+    static constexpr std::int64_t SECOND_TO_MICRO = 1000 * 1000;
+    m_NextAttemptTime = esp_timer_get_time() + delaySecond * SECOND_TO_MICRO;
+    m_IsRetryWaiting = true;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        ++m_FetchStatistics.RetryCount;
+    }
+    ESP_LOGI(TAG, "WeatherForecast fetch retry after %us", delaySecond);
+}
+
+void WeatherForecastTask::Complete(const WeatherForecastFetchStatistics::Outcome outcome)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_FetchStatistics.LastOutcome = outcome;
+        if (outcome == WeatherForecastFetchStatistics::OUTCOME_SUCCESS) {
+            ++m_FetchStatistics.SuccessCount;
+            s_ForecastSuccessMetric.Add();
+            if (0 < m_RetryBackoff.GetRetryCount()) {
+                ++m_FetchStatistics.RetrySuccessCount;
+            }
+        } else {
+            ++m_FetchStatistics.GiveUpCount;
+            s_ForecastGiveUpMetric.Add();
+        }
+    }
+
+    const IrrigationInterfaceSharedPtr irrigationInterface = m_pIrrigationInterface.lock();
+    if (irrigationInterface) {
+        irrigationInterface->GetStatusSnapshot().Invalidate();
+    }
+
+    // A new request may have arrived during the fetch. It is handled by the next Update
+    if ((xEventGroupGetBits(m_EventGroup) & FETCH_REQUEST_BIT) == 0) {
+        xEventGroupSetBits(m_EventGroup, FETCH_COMPLETE_BIT);
+    }
+}
+
+} // IrrigationSystem
+
+// EOF
@@ -0,0 +1,112 @@
+#ifndef WEATHER_FORECAST_TASK_H_
+#define WEATHER_FORECAST_TASK_H_
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+
+// Include ----------------------
+#include <soc/soc.h>
+#include <esp_bit_defs.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+
+#include "task.h"
+#include "retry_backoff.h"
+#include "irrigation_interface.h"
+
+namespace IrrigationSystem {
+
+/// Weather forecast acquisition statistics
+struct WeatherForecastFetchStatistics
+{
+    enum Outcome : int {
+        OUTCOME_NONE,
+        OUTCOME_IN_PROGRESS,
+        OUTCOME_SUCCESS,
+        OUTCOME_GIVE_UP,
+    };
+
+    /// Number of requested fetches
+    std::uint32_t FetchCount;
+    /// Number of requests including retries
+    std::uint32_t AttemptCount;
+    /// Number of retries
+    std::uint32_t RetryCount;
+    /// Number of fetches that finally succeeded
+    std::uint32_t SuccessCount;
+    /// Number of fetches that succeeded only after a retry
+    std::uint32_t RetrySuccessCount;
+    /// Number of fetches abandoned at the deadline (watering without a forecast)
+    std::uint32_t GiveUpCount;
+    /// Latency of the last request
+    std::uint32_t LastLatencyMillisecond;
+    /// Maximum latency of a request
+    std::uint32_t MaxLatencyMillisecond;
+    /// Result of the last fetch
+    Outcome LastOutcome;
+};
+
+/// Weather forecast fetcher
+/// The blocking JMA request runs here so that the ManagementTask never waits for the network.
+class WeatherForecastTask final : public Task
+{
+public:
+    static constexpr char *const TASK_NAME = (char*)"WeatherForecastTask";
+    static constexpr int PRIORITY = Task::PRIORITY_NORMAL;
+    static constexpr int CORE_ID = APP_CPU_NUM;
+
+    /// Event bits
+    static constexpr EventBits_t FETCH_REQUEST_BIT = BIT0;
+    static constexpr EventBits_t FETCH_COMPLETE_BIT = BIT1;
+
+public:
+    explicit WeatherForecastTask(const IrrigationInterfaceWeakPtr pIrrigationInterface);
+    ~WeatherForecastTask();
+
+    void Update() override;
+
+    /// Start fetching (not blocking). Failed requests are retried until retryDeadlineEpoch.
+    /// The completion is published by FETCH_COMPLETE_BIT
+    void RequestFetch(const std::int32_t areaPathCode, const std::int32_t localCode, const std::int32_t AMeDASPoint, const std::time_t retryDeadlineEpoch);
+
+    /// The last requested fetch has finished (succeeded or gave up)
+    bool IsFetchComplete() const;
+
+    WeatherForecastFetchStatistics GetFetchStatistics() const;
+
+private:
+    /// Request once and schedule the retry on failure
+    void Attempt();
+
+    /// Publish FETCH_COMPLETE_BIT (unless a new request is waiting)
+    void Complete(const WeatherForecastFetchStatistics::Outcome outcome);
+
+private:
+    const IrrigationInterfaceWeakPtr m_pIrrigationInterface;
+    EventGroupHandle_t m_EventGroup;
+
+    /// Requested parameters
+    mutable std::mutex m_Mutex;
+    std::int32_t m_AreaPathCode;
+    std::int32_t m_LocalCode;
+    std::int32_t m_AMeDASPoint;
+    std::time_t m_RetryDeadlineEpoch;
+
+    /// Retry state (Task only)
+    RetryBackoff m_RetryBackoff;
+    bool m_IsRetryWaiting;
+    std::int64_t m_NextAttemptTime;
+
+    WeatherForecastFetchStatistics m_FetchStatistics;
+};
+
+using WeatherForecastTaskUniquePtr = std::unique_ptr<WeatherForecastTask>;
+
+} // IrrigationSystem
+
+#endif // WEATHER_FORECAST_TASK_H_
+// EOF
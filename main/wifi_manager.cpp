@@ -6,11 +6,18 @@
 
 #include "logger.h"
 #include "util.h"
+#include "metrics.h"
 
 #include <cstring>
 
 namespace IrrigationSystem {
 
+namespace {
+
+Metric s_WifiReconnectMetric("irrigation_wifi_reconnect_total", "Wi-Fi reconnect attempts after a disconnection", Metric::TYPE_COUNTER);
+
+} // namespace
+
 // EventHandler
 static void eventHandler(void* callbackObject, esp_event_base_t eventBase, int32_t eventId, void* eventData)
 {
@@ -83,6 +90,7 @@ void WifiManager::EventHandler(const esp_event_base_t eventBase, const int32_t e
                 esp_restart();
             } else { 
                 ++m_RetryNum;
+                s_WifiReconnectMetric.Add();
                 ESP_LOGW(TAG, "Disconnect Wi-Fi. retry to connect. try:%d", m_RetryNum);
                 esp_wifi_connect();
             }
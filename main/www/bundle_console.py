@@ -0,0 +1,21 @@
+# ESP32 Irrigation System
+# (C)2021 bekki.jp
+# Inline the stylesheet and script into the single page console and compress it for embedding.
+# /*@inline file*/ in the page is replaced by the file of the same directory. (mtime is fixed as gzip_asset.py)
+import gzip
+import os
+import re
+import sys
+
+src_dir = os.path.dirname(os.path.abspath(sys.argv[1]))
+
+def inline(match):
+    with open(os.path.join(src_dir, match.group(1)), 'r', encoding='utf-8') as src:
+        return src.read()
+
+with open(sys.argv[1], 'r', encoding='utf-8') as src:
+    page = re.sub(r'/\*@inline ([\w.]+)\*/', inline, src.read())
+
+with open(sys.argv[2], 'wb') as dst:
+    with gzip.GzipFile(filename='', mode='wb', fileobj=dst, compresslevel=9, mtime=0) as gz:
+        gz.write(page.encode('utf-8'))
@@ -0,0 +1,106 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+var checkSubmit = function(msg) { return confirm(msg); };
+
+var SCHEDULE_STYLE = {'None': 'schedule_none', 'Wait': 'schedule_wait', 'Executed': 'schedule_executable', 'Disable': 'schedule_disable'};
+var language = (navigator.language || 'en').slice(0, 2) === 'ja' ? 'ja' : 'en';
+
+var pad2 = function(value) { return ('0' + value).slice(-2); };
+var escapeHtml = function(text) {
+  return String(text).replace(/[&<>"']/g, function(c) {
+    return {'&': '&amp;', '<': '&lt;', '>': '&gt;', '"': '&quot;', "'": '&#39;'}[c];
+  });
+};
+var formatDate = function(date) { return pad2(date.getMonth() + 1) + '/' + pad2(date.getDate()); };
+var formatDateTime = function(epoch) {
+  var date = new Date(epoch * 1000);
+  return date.getFullYear() + '/' + formatDate(date) + ' ' + pad2(date.getHours()) + ':' + pad2(date.getMinutes()) + ':' + pad2(date.getSeconds());
+};
+
+var setGauge = function(name, rate, text) {
+  var gauge = document.querySelector('[data-gauge="' + name + '"]');
+  if (!gauge) { return; }
+  gauge.querySelector('.inner').style.width = Math.max(0, Math.min(100, rate * 100)) + '%';
+  gauge.querySelector('.num').textContent = text;
+};
+
+// Patch the rendered page with /api/status (same markup as RootHandler)
+var renderSchedule = function(status, timeZone) {
+  if (!status.setting.active) {
+    return '<p><span style="background-color:yellow;">No settings have been made.</span></p>';
+  }
+  var schedule = status.schedule;
+  var html = '<p>System Time : ' + formatDateTime(status.updated_epoch) + ' TZ:' + escapeHtml(timeZone) + '</p>'
+    + '<p>Current Date : ' + pad2(schedule.month) + '/' + pad2(schedule.day)
+    + '&nbsp;&nbsp; Last Watering Date : ' + formatDate(new Date(schedule.last_watering_epoch * 1000)) + '</p>'
+    + '<table><thead><tr><th>ScheduleName</th><th>Time</th><th>Status</th></tr></thead><tbody>';
+  if (schedule.items.length === 0) {
+    html += '<tr><td colspan="3">Empty</td></tr>';
+  }
+  schedule.items.forEach(function(item) {
+    html += '<tr class="' + (SCHEDULE_STYLE[item.status] || '') + '"><td>' + escapeHtml(item.name) + '</td>'
+      + '<td>' + pad2(item.hour) + ':' + pad2(item.minute) + '</td><td>' + escapeHtml(item.status) + '</td></tr>';
+  });
+  html += '</tbody></table>';
+
+  // Watering plan of the coming days (advance mode)
+  if (0 < schedule.plan.length) {
+    var today = new Date(status.updated_epoch * 1000);
+    html += '<h3>Watering Plan</h3><table><thead><tr><th>Date</th><th>Type</th><th>Watering</th><th>Basis</th></tr></thead><tbody>';
+    schedule.plan.forEach(function(plan) {
+      var date = new Date(today.getFullYear(), today.getMonth(), today.getDate() + plan.day_offset);
+      html += '<tr><td>' + formatDate(date) + '</td><td>' + escapeHtml(plan.type) + '</td>'
+        + '<td>' + (plan.watering ? 'Yes' : '-') + '</td><td>' + (plan.forecast ? 'Forecast' : 'Monthly') + '</td></tr>';
+    });
+    html += '</tbody></table>';
+  }
+  return html;
+};
+
+var renderForecast = function(forecast) {
+  // WeatherForecast::RequestStatus
+  if (forecast.status === 0) {
+    return ' Not yet acquired.';
+  }
+  if (forecast.status !== 1) {
+    return ' <span style="background-color: yellow;">Failed to retrieve data</span>';
+  }
+  return ' Weather(' + escapeHtml(forecast.weather_name[language]) + ') MaxTemp(' + forecast.max_temperature + '°C)';
+};
+
+var render = function(status) {
+  var schedule = document.getElementById('schedule');
+  if (schedule) { schedule.innerHTML = renderSchedule(status, schedule.getAttribute('data-time-zone') || ''); }
+  var valve = document.getElementById('valve');
+  if (valve) {
+    valve.innerHTML = status.valve.open
+      ? '<span style="background:coral;">Open</span> &gt; Close At(' + formatDateTime(status.valve.close_epoch) + ')'
+      : 'Close';
+  }
+  var forecast = document.getElementById('forecast');
+  if (forecast) { forecast.innerHTML = renderForecast(status.forecast); }
+};
+
+// The browser revalidates with the ETag, so an unchanged status is a 304
+var loadStatus = function() {
+  return fetch('/api/status', {cache: 'no-cache'})
+    .then(function(response) { return response.json(); })
+    .then(render);
+};
+
+// Server-Sent Events (/api/events)
+window.addEventListener('load', function() {
+  if (!window.EventSource) { return; }
+  var events = new EventSource('/api/events');
+  events.addEventListener('valve', loadStatus);
+  events.addEventListener('schedule', loadStatus);
+  events.addEventListener('reload', loadStatus);
+  events.addEventListener('voltage', function(e) {
+    var voltage = JSON.parse(e.data).voltage;
+    setGauge('voltage', (voltage - 10.0) / (15.0 - 10.0), voltage.toFixed(2) + '[V]');
+  });
+  events.addEventListener('water_level', function(e) {
+    var level = JSON.parse(e.data).water_level;
+    setGauge('water_level', level, Math.round(level * 100) + '%');
+  });
+});
@@ -0,0 +1,171 @@
+// ESP32 Irrigation System
+// (C)2021 bekki.jp
+// Single page console. The page is rendered here from /api/info and /api/status
+
+var SCHEDULE_STYLE = {'None': 'schedule_none', 'Wait': 'schedule_wait', 'Executed': 'schedule_executable', 'Disable': 'schedule_disable'};
+var info = null;
+var language = (navigator.language || 'en').slice(0, 2) === 'ja' ? 'ja' : 'en';
+
+var element = function(id) { return document.getElementById(id); };
+var pad2 = function(value) { return ('0' + value).slice(-2); };
+var escapeHtml = function(text) {
+  return String(text).replace(/[&<>"']/g, function(c) {
+    return {'&': '&amp;', '<': '&lt;', '>': '&gt;', '"': '&quot;', "'": '&#39;'}[c];
+  });
+};
+var formatDate = function(date) { return pad2(date.getMonth() + 1) + '/' + pad2(date.getDate()); };
+var formatDateTime = function(epoch) {
+  var date = new Date(epoch * 1000);
+  return date.getFullYear() + '/' + formatDate(date) + ' ' + pad2(date.getHours()) + ':' + pad2(date.getMinutes()) + ':' + pad2(date.getSeconds());
+};
+
+// Gauge
+var voltageToColorName = function(voltage) {
+  if (12.5 <= voltage) { return 'lime'; }
+  if (12.0 <= voltage) { return 'chartreuse'; }
+  if (11.8 <= voltage) { return 'yellow'; }
+  if (11.5 <= voltage) { return 'coral'; }
+  return 'darkgray';
+};
+var waterLevelToColorName = function(percent) {
+  if (60 <= percent) { return 'steelblue'; }
+  if (25 <= percent) { return 'lightseagreen'; }
+  return 'yellow';
+};
+var setGauge = function(name, rate, text, color) {
+  var gauge = document.querySelector('[data-gauge="' + name + '"]');
+  if (!gauge) { return; }
+  var inner = gauge.querySelector('.inner');
+  inner.style.width = Math.max(0, Math.min(100, rate * 100)) + '%';
+  inner.style.backgroundColor = color;
+  gauge.querySelector('.num').textContent = text;
+};
+var setVoltage = function(voltage) {
+  setGauge('voltage', (voltage - 10.0) / (15.0 - 10.0), voltage.toFixed(2) + '[V]', voltageToColorName(voltage));
+};
+var setWaterLevel = function(level) {
+  var percent = Math.round(level * 100);
+  setGauge('water_level', level, percent + '%', waterLevelToColorName(percent));
+};
+
+// Render
+var renderSchedule = function(status) {
+  if (!status.setting.active) {
+    return '<p><span style="background-color:yellow;">No settings have been made.</span></p>';
+  }
+  var schedule = status.schedule;
+  var html = '<p>System Time : ' + formatDateTime(status.updated_epoch) + ' TZ:' + escapeHtml(info ? info.time_zone : '') + '</p>'
+    + '<p>Current Date : ' + pad2(schedule.month) + '/' + pad2(schedule.day)
+    + '&nbsp;&nbsp; Last Watering Date : ' + formatDate(new Date(schedule.last_watering_epoch * 1000)) + '</p>'
+    + '<table><thead><tr><th>ScheduleName</th><th>Time</th><th>Status</th></tr></thead><tbody>';
+  if (schedule.items.length === 0) {
+    html += '<tr><td colspan="3">Empty</td></tr>';
+  }
+  schedule.items.forEach(function(item) {
+    html += '<tr class="' + (SCHEDULE_STYLE[item.status] || '') + '"><td>' + escapeHtml(item.name) + '</td>'
+      + '<td>' + pad2(item.hour) + ':' + pad2(item.minute) + '</td><td>' + escapeHtml(item.status) + '</td></tr>';
+  });
+  html += '</tbody></table>';
+
+  // Watering plan of the coming days (advance mode)
+  if (0 < schedule.plan.length) {
+    var today = new Date(status.updated_epoch * 1000);
+    html += '<h3>Watering Plan</h3><table><thead><tr><th>Date</th><th>Type</th><th>Watering</th><th>Basis</th></tr></thead><tbody>';
+    schedule.plan.forEach(function(plan) {
+      var date = new Date(today.getFullYear(), today.getMonth(), today.getDate() + plan.day_offset);
+      html += '<tr><td>' + formatDate(date) + '</td><td>' + escapeHtml(plan.type) + '</td>'
+        + '<td>' + (plan.watering ? 'Yes' : '-') + '</td><td>' + (plan.forecast ? 'Forecast' : 'Monthly') + '</td></tr>';
+    });
+    html += '</tbody></table>';
+  }
+  return html;
+};
+
+var renderForecast = function(forecast) {
+  // WeatherForecast::RequestStatus
+  if (forecast.status === 0) {
+    return ' Not yet acquired.';
+  }
+  if (forecast.status !== 1) {
+    return ' <span style="background-color: yellow;">Failed to retrieve data</span>';
+  }
+  var html = ' Weather(' + escapeHtml(forecast.weather_name[language]) + ') MaxTemp(' + forecast.max_temperature + '°C)';
+  var statistics = info ? info.forecast_statistics : null;
+  if (statistics && 0 < statistics.cache_request) {
+    html += ' Cache Hit(' + statistics.cache_hit + '/' + statistics.cache_request + ')';
+  }
+  if (statistics && 0 < statistics.fetch) {
+    html += ' Fetch(success:' + statistics.success + ' retry:' + statistics.retry + ' give up:' + statistics.give_up
+      + ' latency:' + statistics.latency_ms + 'ms max:' + statistics.max_latency_ms + 'ms)';
+  }
+  return html;
+};
+
+var render = function(status) {
+  element('schedule').innerHTML = renderSchedule(status);
+  element('valve').innerHTML = status.valve.open
+    ? '<span style="background:coral;">Open</span> &gt; Close At(' + formatDateTime(status.valve.close_epoch) + ')'
+    : 'Close';
+  element('forecast').innerHTML = renderForecast(status.forecast);
+  element('setting_operation').hidden = !status.setting.active;
+  if (info && info.features.voltage) { setVoltage(status.voltage); }
+  if (info && info.features.water_level) { setWaterLevel(status.water_level); }
+};
+
+// Load (the browser revalidates with the ETag, so an unchanged status is a 304)
+var loadStatus = function() {
+  return fetch('/api/status', {cache: 'no-cache'})
+    .then(function(response) { return response.json(); })
+    .then(render);
+};
+var loadInfo = function() {
+  return fetch('/api/info', {cache: 'no-cache'})
+    .then(function(response) { return response.json(); })
+    .then(function(result) {
+      info = result;
+      var title = 'Irrigation System' + (info.debug ? ' (DEBUG)' : '');
+      document.title = title;
+      element('title').textContent = title;
+      document.body.className = info.debug ? 'debug' : '';
+      element('version').textContent = info.version;
+      element('voltage').hidden = !info.features.voltage;
+      element('water_level').hidden = !info.features.water_level;
+      document.querySelector('#manual_watering [name="second"]').max = info.manual_max_second;
+    });
+};
+
+// Operation (the device answers json instead of the redirect)
+var post = function(form, body) {
+  return fetch(form.action, {method: 'POST', body: body, headers: {'Accept': 'application/json'}})
+    .then(function(response) {
+      if (!response.ok) { return response.text().then(function(text) { alert(text || response.statusText); }); }
+    })
+    .then(loadStatus);
+};
+var bindForm = function(id, makeBody, message) {
+  element(id).addEventListener('submit', function(e) {
+    e.preventDefault();
+    if (message && !confirm(message)) { return; }
+    post(e.target, makeBody(e.target));
+  });
+};
+var urlEncoded = function(form) { return new URLSearchParams(new FormData(form)); };
+
+window.addEventListener('load', function() {
+  bindForm('manual_watering', urlEncoded);
+  bindForm('emergency_stop', urlEncoded);
+  bindForm('upload_setting', function(form) { return new FormData(form); });
+  bindForm('delete_setting', urlEncoded, 'Are you sure you want to delete setting?');
+
+  loadInfo().then(loadStatus);
+  setInterval(loadStatus, 60 * 1000);
+
+  // Server-Sent Events (/api/events)
+  if (!window.EventSource) { return; }
+  var events = new EventSource('/api/events');
+  events.addEventListener('valve', loadStatus);
+  events.addEventListener('schedule', loadStatus);
+  events.addEventListener('reload', function() { loadInfo().then(loadStatus); });
+  events.addEventListener('voltage', function(e) { setVoltage(JSON.parse(e.data).voltage); });
+  events.addEventListener('water_level', function(e) { setWaterLevel(JSON.parse(e.data).water_level); });
+});
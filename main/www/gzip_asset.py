@@ -0,0 +1,9 @@
+# ESP32 Irrigation System
+# (C)2021 bekki.jp
+# Compress a web console asset for embedding. (mtime is fixed so that the output and its ETag are reproducible)
+import gzip
+import sys
+
+with open(sys.argv[1], 'rb') as src, open(sys.argv[2], 'wb') as dst:
+    with gzip.GzipFile(filename='', mode='wb', fileobj=dst, compresslevel=9, mtime=0) as gz:
+        gz.write(src.read())